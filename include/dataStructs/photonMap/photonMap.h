@@ -23,9 +23,15 @@
 #pragma once
 
 #include <math/algebra/point/point3.h>
+#include <math/algebra/vector/vector3.h>
+#include <math/constants.h>
 #include <geometry/bounds/boundingBox.h>
 
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <malloc.h>
 
 namespace RenderLib {
 namespace DataStructures {
@@ -38,6 +44,60 @@ namespace DataStructures {
 		short		split;
 	};
 
+	/*
+	===============================================================================
+
+		Photon_t
+
+		Compact photon payload (6 bytes): the power is stored in Ward's shared 
+		exponent RGBE format and the incoming direction is quantized to a pair 
+		of spherical angles. 
+		
+		Any other payload type can be used with the PhotonMap density estimation 
+		queries as long as it provides the same getPower/getDirection accessors.
+
+	===============================================================================
+	*/
+	struct Photon_t {
+		unsigned char	power[4];	// RGBE
+		unsigned char	theta, phi;	// incoming direction
+
+		void setPower( const RenderLib::Math::Vector3f& rgb );
+		RenderLib::Math::Vector3f getPower() const;
+
+		void setDirection( const RenderLib::Math::Vector3f& dir ); // dir is expected to be normalized
+		RenderLib::Math::Vector3f getDirection() const;
+	};
+
+	// Filters used to weight the photons during the density estimation
+	enum PhotonFilter_t {
+		PHOTON_FILTER_NONE,		// constant weight
+		PHOTON_FILTER_CONE,		// w = 1 - d / ( k * r )
+		PHOTON_FILTER_GAUSSIAN	// normalized gaussian ( Pavicic )
+	};
+
+	/*
+	===============================================================================
+
+		PhotonMapStagingBuffer
+
+		Per-thread staging area for photons emitted while the map is being built 
+		progressively. Each emitting thread owns its own buffer, so appending 
+		requires no synchronization at all; the staged samples are handed over 
+		to the map with PhotonMap::commitSamples.
+
+	===============================================================================
+	*/
+	class PhotonMapStagingBuffer {
+	public:
+		void append( const RenderLib::Math::Point3f& sample ) { samples.push_back( sample ); }
+		size_t size() const { return samples.size(); }
+		void clear() { samples.clear(); }
+	private:
+		friend class PhotonMap;
+		::std::vector<RenderLib::Math::Point3f> samples;
+	};
+
 	/*
 	===============================================================================
 
@@ -46,32 +106,157 @@ namespace DataStructures {
 		Transforms an array of Point3d samples into a sorted flattened tree 
 		structure for fast nearest-neighbors query.
 
+		Samples may also be streamed into the map after construction: committed
+		samples are kept in a small unbalanced buffer which is scanned along with 
+		the tree by the queries. Once it grows past the rebalance threshold, a 
+		background thread merges it into a new balanced tree along with the younger 
+		trees no larger than it (Bentley and Saxe's logarithmic method), so that each 
+		sample is rebuilt into O(log n) trees overall, and the queries search O(log n) 
+		trees. The main tree is only rebuilt once the younger ones outgrow it.
+		
+		Sample indices follow the order in which samples were provided, that is the 
+		constructor samples first, followed by each committed batch in turn.
+
 	===============================================================================
 	*/
 	class PhotonMap {
 	public:
 		
-		PhotonMap( const ::std::vector<RenderLib::Math::Point3f>& samples );
+		explicit PhotonMap( size_t rebalanceThreshold = 4096 );
+		PhotonMap( const ::std::vector<RenderLib::Math::Point3f>& samples, size_t rebalanceThreshold = 4096 );
 		~PhotonMap();
 
+		// Moves the staged samples into the map, clearing the staging buffer, and returns the index assigned 
+		// to the first of them. Launches a background rebalance if the unbalanced buffer has grown past the 
+		// threshold, and installs the result of a previous one if it is done. 
+		// Several threads may commit concurrently, but commits are NOT synchronized with the queries: the 
+		// caller must make sure no query runs during a commit or a flush (debug builds assert it), typically 
+		// by alternating emission passes, which commit, and gathering passes, which query.
+		SampleIndex_t commitSamples( PhotonMapStagingBuffer& staging );
+
+		// Blocks until every committed sample has been merged into a single balanced tree. Same as 
+		// commitSamples, it must not overlap with queries.
+		void flush();
+
+		size_t size() const { return sampleMap.size() + levelsSize + pendingSamples.size(); }
+
 		void nearestSamples( const ::RenderLib::Math::Point3f& pos,	// in: center of the lookup query
 							 int maxSamples,						// in: maximum number of neighbors to fetch
 							 float searchRadius,					// in: maximum distance to neighbors
-							 SampleIndex_t* neighbors,				// in/out: user-allocated array of maxSamples elements where results will be stored.
-							 int& found								// out: number of nearest neighbors found
+							 SampleIndex_t* neighbors,				// in/out: user-allocated array of maxSamples elements where results will be stored. 
+																	// They come sorted by distance for maxSamples <= 32, and unsorted otherwise.
+							 int& found,							// out: number of nearest neighbors found
+							 float epsilon = 0.0f					// in: approximation bound. The distance to the i-th neighbor found is 
+																	// within a ( 1 + epsilon ) factor of the distance to the true i-th neighbor.
 							 );
+
+		// Rearranges per-sample data given in the order of the source samples array into the internal
+		// tree order (the balanced samples, followed by the unbalanced ones). Needs to be called again 
+		// whenever the map changes. Density estimation queries expect their payload arranged this way, so that photons 
+		// are fetched straight from the traversal indices without remapping them.
+		template< typename T >
+		void sortPayload( const ::std::vector< T >& payload, ::std::vector< T >& treeOrderedPayload ) const;
+
+		// Density estimation over the maxSamples nearest photons found within maxDist. The filter 
+		// is evaluated over the gathered heap once the final search radius is known, reading 
+		// the tree-ordered payload directly. Returns the filtered power density (divide by PI for 
+		// the outgoing radiance off a white lambertian surface). Photons arriving from behind
+		// the surface given by normal are ignored.
+		template< typename T >
+		RenderLib::Math::Vector3f radianceEstimate( const RenderLib::Math::Point3f& pos, 
+													const RenderLib::Math::Vector3f& normal,
+													int maxSamples, 
+													float maxDist,
+													const ::std::vector< T >& treeOrderedPayload,
+													PhotonFilter_t filter = PHOTON_FILTER_NONE,
+													float coneFilterK = 1.1f ) const;
+
+		// Same as above, but gathering every photon within maxDist. Since the radius is fixed
+		// beforehand, the photons are filtered and accumulated during the traversal itself.
+		template< typename T >
+		RenderLib::Math::Vector3f radianceEstimateFixedRadius(	const RenderLib::Math::Point3f& pos, 
+																const RenderLib::Math::Vector3f& normal,
+																float maxDist,
+																const ::std::vector< T >& treeOrderedPayload,
+																PhotonFilter_t filter = PHOTON_FILTER_NONE,
+																float coneFilterK = 1.1f ) const;
 	
 	private:
 		void balanceKDTree(); // arrange the point cloud as a kd-tree for fast kNN queries. Call this once we're done adding new samples
 		void balanceSubTree_r(PhotonMapSample_t** srcArray, const int idx, const int srcIdx, const int finalIdx, PhotonMapSample_t** balancedTree);
 		void medianPartition(PhotonMapSample_t** tree, const int begin, const int end, const int median, const int axis);
-		void nearestSamples_r(PhotonMapKNN* nearestSamples, SampleIndex_t indexArray ) const;
+		template< typename KNN >
+		void nearestSamples_r( KNN* nearestSamples, SampleIndex_t indexArray, SampleIndex_t offset ) const;
+		template< typename KNN >
+		void nearestPendingSamples( KNN* nearestSamples ) const;
+		template< int K >
+		int gatherNearestSorted( const RenderLib::Math::Point3f& pos, int maxSamples, float maxDist, float epsilon, SampleIndex_t* treeIndices, float* sqDistances ) const;
+		SampleIndex_t sourceIndex( SampleIndex_t internalIndex ) const;
+
+		void launchRebalance( bool mergeAll );
+		void installRebalance();
+		static void rebalance( PhotonMap* map, ::std::vector<RenderLib::Math::Point3f>* samples );
+
+		// Debug builds count the queries in flight, so that commits can assert none overlaps them
+		class QueryScope {
+		public:
+			explicit QueryScope( const PhotonMap& _map ) : map( _map ) {
+#if _DEBUG
+				map.activeQueries++;
+#endif
+			}
+			~QueryScope() {
+#if _DEBUG
+				map.activeQueries--;
+#endif
+			}
+		private:
+			const PhotonMap& map;
+			QueryScope& operator=( const QueryScope& );
+		};
+		
+		// kNN query returning internal tree indices (rather than source indices) and their squared distances.
+		// Small queries are gathered in a sorted buffer sized at compile time, larger ones in a max heap.
+		int gatherNearest( const RenderLib::Math::Point3f& pos, int maxSamples, float maxDist, float epsilon, SampleIndex_t* treeIndices, float* sqDistances ) const;
+
+		template< typename T >
+		void accumulateSamples_r( const RenderLib::Math::Point3f& pos, const RenderLib::Math::Vector3f& normal, float sqMaxDist, 
+								  const T* payload, PhotonFilter_t filter, float filterParam, 
+								  SampleIndex_t arrayIndex, RenderLib::Math::Vector3f& accum ) const;
+
+		static float filterWeight( PhotonFilter_t filter, float filterParam, float sqDist, float sqRadius );
+		static float filterNormalization( PhotonFilter_t filter, float filterParam ); // integral of the filter over the unit disk, divided by PI
 
 		::std::vector<PhotonMapSample_t>	sampleMap;	// Organized as an array first, and then balanced as a binary tree 
 														// where the i-th child is located at 2*i and its sibling at 2*i+1		
 		::std::vector<SampleIndex_t>		mapping;	// Transforms internal indices back to the original order, so that 
 														// ::nearestSamples index results match the provided samples array.
 		RenderLib::Geometry::BoundingBox	bbox;		// tree bounds
+
+		// streaming
+		::std::vector<PhotonMap*>				levels;			// younger balanced trees, from the oldest (and largest) to the newest. 
+																// Each one holds the samples committed right after the previous one, 
+																// and comes after it in the internal order. Their mapping holds 
+																// source indices too.
+		size_t									levelsSize;		// number of samples in the younger trees
+		::std::vector<RenderLib::Math::Point3f>	pendingSamples;	// committed samples not balanced yet. They always follow the 
+																// balanced ones in the source order, so their internal 
+																// index matches their source index.
+		size_t									rebalanceThreshold;
+		::std::mutex							commitMutex;
+		::std::thread							rebalanceThread;
+		::std::atomic<bool>						rebalanceDone;
+		size_t									rebalanceCount;	// pending samples being merged by the background rebalance
+		int										rebalanceLevel;	// first younger tree merged by the background rebalance, -1 if 
+																// the main tree is rebuilt along with all of them
+		PhotonMap*								rebalanced;		// result of the background rebalance
+		mutable ::std::atomic<int>				activeQueries;	// queries in flight, only counted by debug builds
+
+		// mark as uncopyable
+		PhotonMap( const PhotonMap& );
+		PhotonMap& operator=( const PhotonMap& );
 	};
+
+	#include "photonMap.inl"
 }
 }
\ No newline at end of file
@@ -0,0 +1,178 @@
+/*
+	================================================================================
+	This software is released under the LGPL-3.0 license: http://www.opensource.org/licenses/lgpl-3.0.html
+
+	Copyright (c) 2012, Jose Esteve. http://www.joesfer.com
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Lesser General Public
+	License as published by the Free Software Foundation; either
+	version 3.0 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public
+	License along with this library; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+	================================================================================
+*/
+
+/*
+===================
+PhotonMap::sortPayload
+===================
+*/
+template< typename T >
+void PhotonMap::sortPayload( const ::std::vector< T >& payload, ::std::vector< T >& treeOrderedPayload ) const {
+	assert( payload.size() == size() );
+	QueryScope scope( *this );
+	treeOrderedPayload.resize( payload.size() );
+	for( size_t i = 0; i < payload.size(); i++ ) {
+		treeOrderedPayload[ i ] = payload[ sourceIndex( (SampleIndex_t)i ) ];
+	}
+}
+
+/*
+===================
+PhotonMap::radianceEstimate
+===================
+*/
+template< typename T >
+RenderLib::Math::Vector3f PhotonMap::radianceEstimate( const RenderLib::Math::Point3f& pos, 
+													   const RenderLib::Math::Vector3f& normal,
+													   int maxSamples, 
+													   float maxDist,
+													   const ::std::vector< T >& treeOrderedPayload,
+													   PhotonFilter_t filter,
+													   float coneFilterK ) const {
+	using namespace RenderLib::Math;
+	assert( treeOrderedPayload.size() == size() );
+
+	if ( size() == 0 || maxSamples <= 0 ) {
+		return Vector3f( 0, 0, 0 );
+	}
+
+	SampleIndex_t* treeIndices = (SampleIndex_t*)alloca( maxSamples * sizeof( SampleIndex_t ) );
+	float* sqDistances = (float*)alloca( maxSamples * sizeof( float ) );
+	if ( treeIndices == NULL || sqDistances == NULL ) {
+		return Vector3f( 0, 0, 0 );
+	}
+
+	const int found = gatherNearest( pos, maxSamples, maxDist, 0.0f, treeIndices, sqDistances );
+	if ( found == 0 ) {
+		return Vector3f( 0, 0, 0 );
+	}
+
+	// the filter support is the distance to the farthest photon gathered
+	float sqRadius = 0;
+	for( int i = 0; i < found; i++ ) {
+		sqRadius = sqDistances[ i ] > sqRadius ? sqDistances[ i ] : sqRadius;
+	}
+	if ( sqRadius <= 0 ) {
+		return Vector3f( 0, 0, 0 );
+	}
+
+	Vector3f accum( 0, 0, 0 );
+	for( int i = 0; i < found; i++ ) {
+		const T& photon = treeOrderedPayload[ treeIndices[ i ] ];
+		if ( Vector3f::dot( photon.getDirection(), normal ) > 0 ) {
+			continue; // the photon hits the surface from behind
+		}
+		accum += photon.getPower() * filterWeight( filter, coneFilterK, sqDistances[ i ], sqRadius );
+	}
+
+	const float area = (float)RenderLib::Math::PI * sqRadius * filterNormalization( filter, coneFilterK );
+	return accum / area;
+}
+
+/*
+===================
+PhotonMap::radianceEstimateFixedRadius
+===================
+*/
+template< typename T >
+RenderLib::Math::Vector3f PhotonMap::radianceEstimateFixedRadius( const RenderLib::Math::Point3f& pos, 
+																  const RenderLib::Math::Vector3f& normal,
+																  float maxDist,
+																  const ::std::vector< T >& treeOrderedPayload,
+																  PhotonFilter_t filter,
+																  float coneFilterK ) const {
+	using namespace RenderLib::Math;
+	assert( treeOrderedPayload.size() == size() );
+
+	if ( size() == 0 || maxDist <= 0 ) {
+		return Vector3f( 0, 0, 0 );
+	}
+
+	QueryScope scope( *this );
+	const float sqMaxDist = maxDist * maxDist;
+	Vector3f accum( 0, 0, 0 );
+	if ( !sampleMap.empty() ) {
+		accumulateSamples_r( pos, normal, sqMaxDist, &treeOrderedPayload[ 0 ], filter, coneFilterK, 0, accum );
+	}
+
+	// younger trees, whose payload follows the main tree's
+	size_t offset = sampleMap.size();
+	for( size_t l = 0; l < levels.size(); l++ ) {
+		if ( !levels[ l ]->sampleMap.empty() ) {
+			levels[ l ]->accumulateSamples_r( pos, normal, sqMaxDist, &treeOrderedPayload[ offset ], filter, coneFilterK, 0, accum );
+		}
+		offset += levels[ l ]->sampleMap.size();
+	}
+
+	// unbalanced samples
+	for( size_t i = 0; i < pendingSamples.size(); i++ ) {
+		const float dist2 = ( pendingSamples[ i ] - pos ).lengthSquared();
+		if ( dist2 < sqMaxDist ) {
+			const T& photon = treeOrderedPayload[ offset + i ];
+			if ( Vector3f::dot( photon.getDirection(), normal ) <= 0 ) {
+				accum += photon.getPower() * filterWeight( filter, coneFilterK, dist2, sqMaxDist );
+			}
+		}
+	}
+
+	const float area = (float)RenderLib::Math::PI * maxDist * maxDist * filterNormalization( filter, coneFilterK );
+	return accum / area;
+}
+
+/*
+===================
+PhotonMap::accumulateSamples_r
+===================
+*/
+template< typename T >
+void PhotonMap::accumulateSamples_r( const RenderLib::Math::Point3f& pos, const RenderLib::Math::Vector3f& normal, float sqMaxDist, 
+									 const T* payload, PhotonFilter_t filter, float filterParam, 
+									 SampleIndex_t arrayIndex, RenderLib::Math::Vector3f& accum ) const {
+	using namespace RenderLib::Math;
+
+	const PhotonMapSample_t& sample = sampleMap[ arrayIndex ];
+
+	const size_t leftChild = 2 * (size_t)arrayIndex + 1;
+	if ( leftChild < sampleMap.size() ) {
+		// internal node: visit the side containing pos first, and the other one 
+		// only if the split plane lies within the search radius
+		const size_t rightChild = leftChild + 1;
+		const int splitPlane = sample.split;
+		const float distance = pos[ splitPlane ] - sample.position[ splitPlane ];
+		const size_t nearChild = distance > 0.0f ? rightChild : leftChild;
+		const size_t farChild = distance > 0.0f ? leftChild : rightChild;
+		if ( nearChild < sampleMap.size() ) {
+			accumulateSamples_r( pos, normal, sqMaxDist, payload, filter, filterParam, (SampleIndex_t)nearChild, accum );
+		}
+		if ( distance * distance < sqMaxDist && farChild < sampleMap.size() ) {
+			accumulateSamples_r( pos, normal, sqMaxDist, payload, filter, filterParam, (SampleIndex_t)farChild, accum );
+		}
+	}
+
+	const float dist2 = ( sample.position - pos ).lengthSquared();
+	if ( dist2 < sqMaxDist ) {
+		const T& photon = payload[ arrayIndex ];
+		if ( Vector3f::dot( photon.getDirection(), normal ) <= 0 ) {
+			accum += photon.getPower() * filterWeight( filter, filterParam, dist2, sqMaxDist );
+		}
+	}
+}
@@ -22,6 +22,7 @@
 
 #pragma once
 #include <math/algebra/point/point3.h>
+#include <assert.h>
 
 namespace RenderLib {
 namespace DataStructures {
@@ -38,17 +39,21 @@ namespace DataStructures {
 	*/
 	class PhotonMapKNN {
 	public:
-		PhotonMapKNN( int _maxSamples, float _searchRadius ) : 
+		PhotonMapKNN( int _maxSamples, float _searchRadius, float _epsilon = 0.0f ) : 
 			maxSamples( _maxSamples ), 
 			sqMaxSearchRadius( _searchRadius * _searchRadius ), 
+			sqPruneScale( ( 1.0f + _epsilon ) * ( 1.0f + _epsilon ) ),
 			found(0), heapBuilt(false), squaredDist(NULL), index(NULL) {} 
 
 		void BuildMaxHeap();
 		void AddSample( SampleIndex_t s, float squaredDist);
+		void AddCandidate( SampleIndex_t s, float squaredDist ); // keeps the sample if it is closer than the current search radius
+		float SquaredRadius() const { return squaredDist[0]; }
 
 		// search delimiters
 		const int	maxSamples; 
 		const float	sqMaxSearchRadius;	// squared max search radius
+		const float	sqPruneScale;		// squared ( 1 + epsilon ) factor applied to the split plane distances for approximate queries
 
 		int			found;				// samples actually found in the search radius (may be < maxSamples)
 		bool		heapBuilt;			// At the end of the search, the squaredDist array will be arranged as a max heap. This flag will tell us when this is done.
@@ -61,5 +66,64 @@ namespace DataStructures {
 		PhotonMapKNN(const PhotonMapKNN&);
 		PhotonMapKNN& operator=(const PhotonMapKNN&);
 	};
+
+	/*
+	===============================================================================
+
+		PhotonMapKNNSorted
+
+		Replaces PhotonMapKNN for small queries (maxSamples <= K): results are 
+		kept in a fixed size array sorted by distance, where new samples are 
+		placed by insertion. For small K this beats the heap, as everything 
+		lives in a couple of cache lines and there is no index bookkeeping.
+
+	===============================================================================
+	*/
+	template< int K >
+	class PhotonMapKNNSorted {
+	public:
+		PhotonMapKNNSorted( int _maxSamples, float _searchRadius, float _epsilon = 0.0f ) : 
+			maxSamples( _maxSamples ), 
+			sqMaxSearchRadius( _searchRadius * _searchRadius ), 
+			sqPruneScale( ( 1.0f + _epsilon ) * ( 1.0f + _epsilon ) ),
+			found( 0 ), sqRadius( _searchRadius * _searchRadius ) {
+			assert( maxSamples > 0 && maxSamples <= K );
+		}
+
+		void AddCandidate( SampleIndex_t s, float sqDist ) {
+			if ( sqDist >= sqRadius ) {
+				return;
+			}
+			// drop the farthest sample if we're full, and shift the farther ones to make room
+			int i = found < maxSamples ? found++ : found - 1;
+			for( ; i > 0 && squaredDist[ i - 1 ] > sqDist; i-- ) {
+				squaredDist[ i ] = squaredDist[ i - 1 ];
+				index[ i ] = index[ i - 1 ];
+			}
+			squaredDist[ i ] = sqDist;
+			index[ i ] = s;
+			if ( found == maxSamples ) {
+				sqRadius = squaredDist[ found - 1 ];
+			}
+		}
+		float SquaredRadius() const { return sqRadius; }
+
+		// search delimiters
+		const int	maxSamples; 
+		const float	sqMaxSearchRadius;
+		const float	sqPruneScale;
+
+		int			found;
+
+		RenderLib::Math::Point3f	pos;
+		float			squaredDist[ K ];	// sorted by increasing distance
+		SampleIndex_t	index[ K ];			// index inside of the tree array
+	private:
+		float		sqRadius;				// current search radius: the max radius until the buffer is full, the farthest sample afterwards
+
+		// mark as uncopyable
+		PhotonMapKNNSorted( const PhotonMapKNNSorted& );
+		PhotonMapKNNSorted& operator=( const PhotonMapKNNSorted& );
+	};
 }
 }
\ No newline at end of file
@@ -0,0 +1,124 @@
+/*
+	================================================================================
+	This software is released under the LGPL-3.0 license: http://www.opensource.org/licenses/lgpl-3.0.html
+
+	Copyright (c) 2012, Jose Esteve. http://www.joesfer.com
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Lesser General Public
+	License as published by the Free Software Foundation; either
+	version 3.0 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public
+	License along with this library; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+	================================================================================
+*/
+
+#pragma once
+
+#include <parallel/parallelFor.h>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <malloc.h>
+#include <assert.h>
+
+namespace RenderLib {
+namespace DataStructures {
+
+	/*
+	===============================================================================
+
+		PointKdTree
+
+		Left-balanced kd-tree over a static cloud of Dim-dimensional points, 
+		flattened into an array where the children of the i-th node are located
+		at 2i+1 and 2i+2 (the same layout PhotonMap uses). Each node splits along
+		the longest axis of its own bounds.
+
+		Points may be of any type exposing their coordinates through operator[] 
+		(Point2, Point3...). Query results are indices into the source array.
+		Once built, the tree is read-only, so it can be queried concurrently.
+
+	===============================================================================
+	*/
+	template< int Dim, typename Scalar >
+	class PointKdTree {
+	public:
+		typedef unsigned int Index_t;
+
+		PointKdTree() {}
+
+		// Builds the tree from scratch. The top levels of the tree are split across threads if parallel is set.
+		template< typename P >
+		void build( const P* points, size_t count, bool parallel = true );
+		template< typename P >
+		void build( const ::std::vector< P >& points, bool parallel = true ) { build( points.empty() ? NULL : &points[ 0 ], points.size(), parallel ); }
+
+		size_t size() const { return nodes.size(); }
+
+		// Fetches the maxSamples nearest points within maxDist, sorted by increasing distance, and returns how many 
+		// were found. sqDistances is optional. With epsilon > 0, the distance to the i-th neighbor returned is only 
+		// guaranteed to be within a ( 1 + epsilon ) factor of the distance to the true i-th neighbor.
+		template< typename P >
+		int nearest( const P& pos, int maxSamples, Scalar maxDist, Index_t* indices, Scalar* sqDistances = NULL, Scalar epsilon = 0 ) const;
+
+		// Appends every point within radius to indices (in no particular order), returns how many were added
+		template< typename P >
+		size_t withinRadius( const P& pos, Scalar radius, ::std::vector< Index_t >& indices ) const;
+
+		// Batched queries, spread across threads. 
+		// nearestBatch stores the results of the i-th query at indices[ i * maxSamples ], and their count at found[ i ].
+		template< typename P >
+		void nearestBatch( const P* queries, size_t count, int maxSamples, Scalar maxDist, Index_t* indices, int* found, Scalar epsilon = 0 ) const;
+		// withinRadiusBatch returns the results in compressed rows: the i-th query results are 
+		// indices[ offsets[ i ] ] to indices[ offsets[ i + 1 ] - 1 ]
+		template< typename P >
+		void withinRadiusBatch( const P* queries, size_t count, Scalar radius, ::std::vector< size_t >& offsets, ::std::vector< Index_t >& indices ) const;
+
+	private:
+		struct Node_t {
+			Scalar			pos[ Dim ];
+			Index_t			source;		// index in the source points array
+			unsigned char	split;		// split axis
+		};
+
+		struct Neighbor_t {
+			Scalar	sqDist;
+			Index_t	index;
+			bool operator<( const Neighbor_t& other ) const { return sqDist < other.sqDist; }
+		};
+
+		// Gathers the kNN results. Small queries are kept sorted by insertion, larger ones in a max heap.
+		struct KNNQuery_t {
+			enum { SORTED_THRESHOLD = 32 };
+
+			Scalar		pos[ Dim ];
+			int			maxSamples;
+			int			found;
+			Scalar		sqRadius;		// current search radius: max distance until full, farthest neighbor afterwards
+			Scalar		sqPruneScale;	// ( 1 + epsilon )^2
+			Neighbor_t*	neighbors;
+
+			void add( Index_t index, Scalar sqDist );
+		};
+
+		template< typename P >
+		void buildSubTree_r( const P* points, Index_t* order, size_t begin, size_t end, size_t nodeIndex, const Scalar* boundsMin, const Scalar* boundsMax, int parallelDepth );
+		static size_t leftSubTreeSize( size_t count );
+
+		void nearest_r( KNNQuery_t& query, size_t nodeIndex ) const;
+		void withinRadius_r( const Scalar* pos, Scalar sqRadius, size_t nodeIndex, ::std::vector< Index_t >& indices ) const;
+
+		::std::vector< Node_t >	nodes;
+	};
+
+	#include "pointKdTree.inl"
+}
+}
@@ -0,0 +1,350 @@
+/*
+	================================================================================
+	This software is released under the LGPL-3.0 license: http://www.opensource.org/licenses/lgpl-3.0.html
+
+	Copyright (c) 2012, Jose Esteve. http://www.joesfer.com
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Lesser General Public
+	License as published by the Free Software Foundation; either
+	version 3.0 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public
+	License along with this library; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+	================================================================================
+*/
+
+/*
+===================
+PointKdTree::build
+===================
+*/
+template< int Dim, typename Scalar >
+template< typename P >
+void PointKdTree< Dim, Scalar >::build( const P* points, size_t count, bool parallel ) {
+	nodes.clear();
+	if ( count == 0 ) {
+		return;
+	}
+	nodes.resize( count );
+
+	::std::vector< Index_t > order( count );
+	Scalar boundsMin[ Dim ], boundsMax[ Dim ];
+	for( int axis = 0; axis < Dim; axis++ ) {
+		boundsMin[ axis ] = boundsMax[ axis ] = (Scalar)points[ 0 ][ axis ];
+	}
+	for( size_t i = 0; i < count; i++ ) {
+		order[ i ] = (Index_t)i;
+		for( int axis = 0; axis < Dim; axis++ ) {
+			const Scalar v = (Scalar)points[ i ][ axis ];
+			boundsMin[ axis ] = v < boundsMin[ axis ] ? v : boundsMin[ axis ];
+			boundsMax[ axis ] = v > boundsMax[ axis ] ? v : boundsMax[ axis ];
+		}
+	}
+
+	// subtrees are handed over to new threads down to the depth where there's one per core
+	int parallelDepth = 0;
+	if ( parallel ) {
+		for( unsigned int n = 1; n < RenderLib::Parallel::numThreads(); n *= 2 ) {
+			parallelDepth++;
+		}
+	}
+
+	buildSubTree_r( points, &order[ 0 ], 0, count, 0, boundsMin, boundsMax, parallelDepth );
+}
+
+/*
+===================
+PointKdTree::leftSubTreeSize
+
+Number of nodes to the left of the median so that the subtree is left-balanced
+(every level full but the last one, which fills up from the left)
+===================
+*/
+template< int Dim, typename Scalar >
+size_t PointKdTree< Dim, Scalar >::leftSubTreeSize( size_t count ) {
+	if ( count <= 1 ) {
+		return 0;
+	}
+	size_t lastLevel = 1; // capacity of the last level
+	while( lastLevel * 2 <= count ) {
+		lastLevel *= 2;
+	}
+	const size_t lastLevelNodes = count - ( lastLevel - 1 );
+	const size_t half = lastLevel / 2;
+	return ( half - 1 ) + ( lastLevelNodes < half ? lastLevelNodes : half );
+}
+
+/*
+===================
+PointKdTree::buildSubTree_r
+===================
+*/
+template< int Dim, typename Scalar >
+template< typename P >
+void PointKdTree< Dim, Scalar >::buildSubTree_r( const P* points, Index_t* order, size_t begin, size_t end, size_t nodeIndex, 
+												 const Scalar* boundsMin, const Scalar* boundsMax, int parallelDepth ) {
+	// split along the longest axis of the node bounds
+	int axis = 0;
+	for( int i = 1; i < Dim; i++ ) {
+		if ( boundsMax[ i ] - boundsMin[ i ] > boundsMax[ axis ] - boundsMin[ axis ] ) {
+			axis = i;
+		}
+	}
+
+	const size_t median = begin + leftSubTreeSize( end - begin );
+	::std::nth_element( order + begin, order + median, order + end, 
+		[ points, axis ]( Index_t a, Index_t b ) { return points[ a ][ axis ] < points[ b ][ axis ]; } );
+
+	Node_t& node = nodes[ nodeIndex ];
+	const P& p = points[ order[ median ] ];
+	for( int i = 0; i < Dim; i++ ) {
+		node.pos[ i ] = (Scalar)p[ i ];
+	}
+	node.source = order[ median ];
+	node.split = (unsigned char)axis;
+
+	const size_t leftChild = 2 * nodeIndex + 1;
+	const size_t rightChild = leftChild + 1;
+	
+	Scalar leftMax[ Dim ], rightMin[ Dim ];
+	for( int i = 0; i < Dim; i++ ) {
+		leftMax[ i ] = boundsMax[ i ];
+		rightMin[ i ] = boundsMin[ i ];
+	}
+	leftMax[ axis ] = rightMin[ axis ] = node.pos[ axis ];
+
+	const size_t minParallelCount = 16384; // not worth spawning a thread for small subtrees
+	::std::thread leftThread;
+	if ( median > begin ) {
+		if ( parallelDepth > 0 && end - begin >= minParallelCount ) {
+			leftThread = ::std::thread( [ = ]() { 
+				buildSubTree_r( points, order, begin, median, leftChild, boundsMin, leftMax, parallelDepth - 1 ); 
+			} );
+		} else {
+			buildSubTree_r( points, order, begin, median, leftChild, boundsMin, leftMax, parallelDepth - 1 );
+		}
+	}
+	if ( median + 1 < end ) {
+		buildSubTree_r( points, order, median + 1, end, rightChild, rightMin, boundsMax, parallelDepth - 1 );
+	}
+	if ( leftThread.joinable() ) {
+		leftThread.join();
+	}
+}
+
+/*
+===================
+PointKdTree::KNNQuery_t::add
+===================
+*/
+template< int Dim, typename Scalar >
+void PointKdTree< Dim, Scalar >::KNNQuery_t::add( Index_t index, Scalar sqDist ) {
+	if ( sqDist >= sqRadius ) {
+		return;
+	}
+	if ( maxSamples <= SORTED_THRESHOLD ) {
+		// drop the farthest neighbor if we're full, and shift the farther ones to make room
+		int i = found < maxSamples ? found++ : found - 1;
+		for( ; i > 0 && sqDist < neighbors[ i - 1 ].sqDist; i-- ) {
+			neighbors[ i ] = neighbors[ i - 1 ];
+		}
+		neighbors[ i ].sqDist = sqDist;
+		neighbors[ i ].index = index;
+		if ( found == maxSamples ) {
+			sqRadius = neighbors[ found - 1 ].sqDist;
+		}
+	} else {
+		if ( found == maxSamples ) {
+			::std::pop_heap( neighbors, neighbors + found );
+			found--;
+		}
+		neighbors[ found ].sqDist = sqDist;
+		neighbors[ found ].index = index;
+		::std::push_heap( neighbors, neighbors + ++found );
+		if ( found == maxSamples ) {
+			sqRadius = neighbors[ 0 ].sqDist;
+		}
+	}
+}
+
+/*
+===================
+PointKdTree::nearest
+===================
+*/
+template< int Dim, typename Scalar >
+template< typename P >
+int PointKdTree< Dim, Scalar >::nearest( const P& pos, int maxSamples, Scalar maxDist, Index_t* indices, Scalar* sqDistances, Scalar epsilon ) const {
+	if ( nodes.empty() || maxSamples <= 0 ) {
+		return 0;
+	}
+
+	KNNQuery_t query;
+	for( int i = 0; i < Dim; i++ ) {
+		query.pos[ i ] = (Scalar)pos[ i ];
+	}
+	query.maxSamples	= maxSamples;
+	query.found			= 0;
+	query.sqRadius		= maxDist * maxDist;
+	query.sqPruneScale	= ( 1 + epsilon ) * ( 1 + epsilon );
+	query.neighbors		= (Neighbor_t*)alloca( maxSamples * sizeof( Neighbor_t ) );
+	if ( query.neighbors == NULL ) {
+		return 0;
+	}
+
+	nearest_r( query, 0 );
+
+	if ( maxSamples > KNNQuery_t::SORTED_THRESHOLD ) {
+		::std::sort_heap( query.neighbors, query.neighbors + query.found );
+	}
+	for( int i = 0; i < query.found; i++ ) {
+		indices[ i ] = query.neighbors[ i ].index;
+		if ( sqDistances != NULL ) {
+			sqDistances[ i ] = query.neighbors[ i ].sqDist;
+		}
+	}
+	return query.found;
+}
+
+/*
+===================
+PointKdTree::nearest_r
+===================
+*/
+template< int Dim, typename Scalar >
+void PointKdTree< Dim, Scalar >::nearest_r( KNNQuery_t& query, size_t nodeIndex ) const {
+	const Node_t& node = nodes[ nodeIndex ];
+	const size_t leftChild = 2 * nodeIndex + 1;
+	
+	Scalar sqDist = 0;
+	for( int i = 0; i < Dim; i++ ) {
+		const Scalar d = node.pos[ i ] - query.pos[ i ];
+		sqDist += d * d;
+	}
+
+	if ( leftChild >= nodes.size() ) {
+		// leaf
+		query.add( node.source, sqDist );
+		return;
+	}
+
+	// visit the side of the split plane containing the query point first, then 
+	// the node itself, and the other side only if it lies within the search radius 
+	const Scalar distance = query.pos[ node.split ] - node.pos[ node.split ];
+	const size_t nearChild = distance > 0 ? leftChild + 1 : leftChild;
+	const size_t farChild = distance > 0 ? leftChild : leftChild + 1;
+	if ( nearChild < nodes.size() ) {
+		nearest_r( query, nearChild );
+	}
+	query.add( node.source, sqDist );
+	if ( farChild < nodes.size() && distance * distance * query.sqPruneScale < query.sqRadius ) {
+		nearest_r( query, farChild );
+	}
+}
+
+/*
+===================
+PointKdTree::withinRadius
+===================
+*/
+template< int Dim, typename Scalar >
+template< typename P >
+size_t PointKdTree< Dim, Scalar >::withinRadius( const P& pos, Scalar radius, ::std::vector< Index_t >& indices ) const {
+	if ( nodes.empty() ) {
+		return 0;
+	}
+	Scalar p[ Dim ];
+	for( int i = 0; i < Dim; i++ ) {
+		p[ i ] = (Scalar)pos[ i ];
+	}
+	const size_t prevSize = indices.size();
+	withinRadius_r( p, radius * radius, 0, indices );
+	return indices.size() - prevSize;
+}
+
+/*
+===================
+PointKdTree::withinRadius_r
+===================
+*/
+template< int Dim, typename Scalar >
+void PointKdTree< Dim, Scalar >::withinRadius_r( const Scalar* pos, Scalar sqRadius, size_t nodeIndex, ::std::vector< Index_t >& indices ) const {
+	const Node_t& node = nodes[ nodeIndex ];
+
+	Scalar sqDist = 0;
+	for( int i = 0; i < Dim; i++ ) {
+		const Scalar d = node.pos[ i ] - pos[ i ];
+		sqDist += d * d;
+	}
+	if ( sqDist < sqRadius ) {
+		indices.push_back( node.source );
+	}
+
+	const size_t leftChild = 2 * nodeIndex + 1;
+	if ( leftChild < nodes.size() ) {
+		const Scalar distance = pos[ node.split ] - node.pos[ node.split ];
+		if ( distance <= 0 || distance * distance < sqRadius ) {
+			withinRadius_r( pos, sqRadius, leftChild, indices );
+		}
+		if ( leftChild + 1 < nodes.size() && ( distance > 0 || distance * distance < sqRadius ) ) {
+			withinRadius_r( pos, sqRadius, leftChild + 1, indices );
+		}
+	}
+}
+
+/*
+===================
+PointKdTree::nearestBatch
+===================
+*/
+template< int Dim, typename Scalar >
+template< typename P >
+void PointKdTree< Dim, Scalar >::nearestBatch( const P* queries, size_t count, int maxSamples, Scalar maxDist, Index_t* indices, int* found, Scalar epsilon ) const {
+	RenderLib::Parallel::parallelFor( 0, count, 256, [ & ]( size_t begin, size_t end ) {
+		for( size_t i = begin; i < end; i++ ) {
+			found[ i ] = nearest( queries[ i ], maxSamples, maxDist, indices + i * maxSamples, NULL, epsilon );
+		}
+	} );
+}
+
+/*
+===================
+PointKdTree::withinRadiusBatch
+===================
+*/
+template< int Dim, typename Scalar >
+template< typename P >
+void PointKdTree< Dim, Scalar >::withinRadiusBatch( const P* queries, size_t count, Scalar radius, ::std::vector< size_t >& offsets, ::std::vector< Index_t >& indices ) const {
+	offsets.assign( count + 1, 0 );
+	indices.clear();
+	if ( count == 0 ) {
+		return;
+	}
+
+	// each chunk of queries gathers its results separately, then they're laid out contiguously
+	const size_t grainSize = 256;
+	::std::vector< ::std::vector< Index_t > > chunkResults( ( count + grainSize - 1 ) / grainSize );
+	RenderLib::Parallel::parallelFor( 0, count, grainSize, [ & ]( size_t begin, size_t end ) {
+		::std::vector< Index_t >& results = chunkResults[ begin / grainSize ];
+		for( size_t i = begin; i < end; i++ ) {
+			offsets[ i + 1 ] = withinRadius( queries[ i ], radius, results );
+		}
+	} );
+
+	for( size_t i = 0; i < count; i++ ) {
+		offsets[ i + 1 ] += offsets[ i ];
+	}
+	indices.resize( offsets[ count ] );
+	RenderLib::Parallel::parallelFor( 0, chunkResults.size(), 1, [ & ]( size_t begin, size_t end ) {
+		for( size_t chunk = begin; chunk < end; chunk++ ) {
+			::std::copy( chunkResults[ chunk ].begin(), chunkResults[ chunk ].end(), indices.begin() + offsets[ chunk * grainSize ] );
+		}
+	} );
+}
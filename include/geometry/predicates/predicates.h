@@ -0,0 +1,100 @@
+/*
+	================================================================================
+	This software is released under the LGPL-3.0 license: http://www.opensource.org/licenses/lgpl-3.0.html
+
+	Copyright (c) 2012, Jose Esteve. http://www.joesfer.com
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Lesser General Public
+	License as published by the Free Software Foundation; either
+	version 3.0 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public
+	License along with this library; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+	================================================================================
+*/
+
+#pragma once
+
+#include <math/algebra/point/point3.h>
+#include <math/algebra/vector/vector2.h>
+
+namespace RenderLib {
+namespace Geometry {
+
+	/*
+	===============================================================================
+
+		Robust geometric predicates
+
+		Adaptive precision orientation, in-circle and in-sphere tests, following
+		"Adaptive Precision Floating-Point Arithmetic and Fast Robust Geometric
+		Predicates", Jonathan R. Shewchuk, 1997.
+
+		The determinants are first evaluated in plain floating point on
+		coordinates translated to the last point, and the result is trusted
+		when its magnitude exceeds a forward error bound. Otherwise they are
+		re-evaluated exactly with floating-point expansions. The returned sign
+		is always exact, the magnitude is only an approximation.
+
+		Overflow and underflow are not handled.
+
+	===============================================================================
+	*/
+
+	// Returns > 0 if a, b, c appear counterclockwise, < 0 if clockwise, 0 if collinear.
+	// Equals the determinant | a 1 ; b 1 ; c 1 |, i.e. twice the signed area of abc.
+	double orient2D( const RenderLib::Math::Vector2< double >& a, 
+					 const RenderLib::Math::Vector2< double >& b, 
+					 const RenderLib::Math::Vector2< double >& c );
+
+	// Returns > 0 if d lies inside the circle through a, b, c, < 0 outside, 0 if the 
+	// 4 points are cocircular. The sign is reversed when orient2D( a, b, c ) < 0.
+	// Equals the determinant | a |a|^2 1 ; b |b|^2 1 ; c |c|^2 1 ; d |d|^2 1 |.
+	double inCircle2D( const RenderLib::Math::Vector2< double >& a, 
+					   const RenderLib::Math::Vector2< double >& b, 
+					   const RenderLib::Math::Vector2< double >& c, 
+					   const RenderLib::Math::Vector2< double >& d );
+
+	// single precision points are promoted, which is exact
+	inline double orient2D( const RenderLib::Math::Vector2f& a, 
+							const RenderLib::Math::Vector2f& b, 
+							const RenderLib::Math::Vector2f& c ) {
+		using RenderLib::Math::Vector2;
+		return orient2D( Vector2< double >( a.x, a.y ), Vector2< double >( b.x, b.y ), Vector2< double >( c.x, c.y ) );
+	}
+
+	inline double inCircle2D( const RenderLib::Math::Vector2f& a, 
+							  const RenderLib::Math::Vector2f& b, 
+							  const RenderLib::Math::Vector2f& c, 
+							  const RenderLib::Math::Vector2f& d ) {
+		using RenderLib::Math::Vector2;
+		return inCircle2D( Vector2< double >( a.x, a.y ), Vector2< double >( b.x, b.y ), 
+						   Vector2< double >( c.x, c.y ), Vector2< double >( d.x, d.y ) );
+	}
+
+	// Returns > 0 if d lies above the plane through a, b, c (a, b, c appear clockwise 
+	// seen from d), < 0 if below, 0 if the 4 points are coplanar.
+	// Equals the determinant | a 1 ; b 1 ; c 1 ; d 1 |, i.e. 6 times the signed volume of abcd.
+	double orient3D( const RenderLib::Math::Point3< double >& a, 
+					 const RenderLib::Math::Point3< double >& b, 
+					 const RenderLib::Math::Point3< double >& c, 
+					 const RenderLib::Math::Point3< double >& d );
+
+	// Returns > 0 if e lies inside the sphere through a, b, c, d, < 0 outside, 0 if the
+	// 5 points are cospherical. The sign is reversed when orient3D( a, b, c, d ) < 0.
+	// Equals the determinant | a |a|^2 1 ; b |b|^2 1 ; c |c|^2 1 ; d |d|^2 1 ; e |e|^2 1 |.
+	double inSphere( const RenderLib::Math::Point3< double >& a, 
+					 const RenderLib::Math::Point3< double >& b, 
+					 const RenderLib::Math::Point3< double >& c, 
+					 const RenderLib::Math::Point3< double >& d, 
+					 const RenderLib::Math::Point3< double >& e );
+
+} // namespace Geometry
+} // namespace RenderLib
@@ -0,0 +1,62 @@
+/*
+	================================================================================
+	This software is released under the LGPL-3.0 license: http://www.opensource.org/licenses/lgpl-3.0.html
+
+	Copyright (c) 2012, Jose Esteve. http://www.joesfer.com
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Lesser General Public
+	License as published by the Free Software Foundation; either
+	version 3.0 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public
+	License along with this library; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+	================================================================================
+*/
+
+#pragma once
+
+#include <math/algebra/point/point3.h>
+#include <coreLib.h>
+#include <vector>
+#include <algorithm>
+
+namespace RenderLib {
+namespace Geometry {
+
+	/*
+	===============================================================================
+
+		Spatial sorting
+
+		Orderings of point sets preserving spatial locality, used to speed up 
+		incremental constructions where each new point is located starting 
+		from the previous one (Delaunay tessellations...)
+
+	===============================================================================
+	*/
+
+	// Position of a point along a 3D Hilbert curve filling the given bounds, quantized to 2^21 cells per axis
+	template< typename T >
+	unsigned long long hilbertKey( const RenderLib::Math::Point3< T >& p, const RenderLib::Math::Point3< T >& boundsMin, const RenderLib::Math::Point3< T >& boundsMax );
+
+	// Sorts the given point indices along a Hilbert curve filling the bounds of the points they refer to
+	template< typename T >
+	void hilbertSort( const RenderLib::Math::Point3< T >* points, unsigned int* indices, size_t count );
+
+	// Biased Randomized Insertion Order (Amenta, Choi & Rote): the points are shuffled and split in rounds 
+	// of geometrically increasing size (each round holds about half of the remaining points), and each 
+	// round is then sorted along a Hilbert curve. Returns the point indices in insertion order.
+	template< typename T >
+	void brioSort( const RenderLib::Math::Point3< T >* points, size_t count, CoreLib::List< unsigned int >& order, unsigned int seed = 1 );
+
+	#include "spatialSort.inl"
+
+} // namespace Geometry
+} // namespace RenderLib
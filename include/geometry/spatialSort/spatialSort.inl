@@ -0,0 +1,144 @@
+/*
+	================================================================================
+	This software is released under the LGPL-3.0 license: http://www.opensource.org/licenses/lgpl-3.0.html
+
+	Copyright (c) 2012, Jose Esteve. http://www.joesfer.com
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Lesser General Public
+	License as published by the Free Software Foundation; either
+	version 3.0 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public
+	License along with this library; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+	================================================================================
+*/
+
+/*
+================
+hilbertKey
+
+Skilling's transform ("Programming the Hilbert curve", AIP 2004): the cell 
+coordinates are turned into the transposed Hilbert index in place, and 
+then their bits are interleaved into the final key.
+================
+*/
+template< typename T >
+unsigned long long hilbertKey( const RenderLib::Math::Point3< T >& p, const RenderLib::Math::Point3< T >& boundsMin, const RenderLib::Math::Point3< T >& boundsMax ) {
+	const int bits = 21;
+	const unsigned int cells = 1u << bits;
+
+	unsigned int X[ 3 ];
+	for( int i = 0; i < 3; i++ ) {
+		const T extent = boundsMax[ i ] - boundsMin[ i ];
+		const T t = extent > 0 ? ( p[ i ] - boundsMin[ i ] ) / extent : 0;
+		const T cell = t * cells;
+		X[ i ] = cell <= 0 ? 0 : ( cell >= cells ? cells - 1 : (unsigned int)cell );
+	}
+
+	// inverse undo
+	for( unsigned int Q = 1u << ( bits - 1 ); Q > 1; Q >>= 1 ) {
+		const unsigned int P = Q - 1;
+		for( int i = 0; i < 3; i++ ) {
+			if ( X[ i ] & Q ) {
+				X[ 0 ] ^= P; // invert
+			} else {
+				const unsigned int t = ( X[ 0 ] ^ X[ i ] ) & P; // exchange
+				X[ 0 ] ^= t;
+				X[ i ] ^= t;
+			}
+		}
+	}
+	// Gray encode
+	X[ 1 ] ^= X[ 0 ];
+	X[ 2 ] ^= X[ 1 ];
+	unsigned int t = 0;
+	for( unsigned int Q = 1u << ( bits - 1 ); Q > 1; Q >>= 1 ) {
+		if ( X[ 2 ] & Q ) {
+			t ^= Q - 1;
+		}
+	}
+	for( int i = 0; i < 3; i++ ) {
+		X[ i ] ^= t;
+	}
+
+	unsigned long long key = 0;
+	for( int b = bits - 1; b >= 0; b-- ) {
+		for( int i = 0; i < 3; i++ ) {
+			key = ( key << 1 ) | ( ( X[ i ] >> b ) & 1 );
+		}
+	}
+	return key;
+}
+
+/*
+================
+hilbertSort
+================
+*/
+template< typename T >
+void hilbertSort( const RenderLib::Math::Point3< T >* points, unsigned int* indices, size_t count ) {
+	if ( count < 2 ) {
+		return;
+	}
+
+	RenderLib::Math::Point3< T > boundsMin = points[ indices[ 0 ] ];
+	RenderLib::Math::Point3< T > boundsMax = boundsMin;
+	for( size_t i = 1; i < count; i++ ) {
+		const RenderLib::Math::Point3< T >& p = points[ indices[ i ] ];
+		for( int axis = 0; axis < 3; axis++ ) {
+			boundsMin[ axis ] = std::min( boundsMin[ axis ], p[ axis ] );
+			boundsMax[ axis ] = std::max( boundsMax[ axis ], p[ axis ] );
+		}
+	}
+
+	std::vector< std::pair< unsigned long long, unsigned int > > keys( count );
+	for( size_t i = 0; i < count; i++ ) {
+		keys[ i ].first = hilbertKey( points[ indices[ i ] ], boundsMin, boundsMax );
+		keys[ i ].second = indices[ i ];
+	}
+	std::sort( keys.begin(), keys.end() );
+	for( size_t i = 0; i < count; i++ ) {
+		indices[ i ] = keys[ i ].second;
+	}
+}
+
+/*
+================
+brioSort
+================
+*/
+template< typename T >
+void brioSort( const RenderLib::Math::Point3< T >* points, size_t count, CoreLib::List< unsigned int >& order, unsigned int seed ) {
+	order.resize( count, true );
+	for( size_t i = 0; i < count; i++ ) {
+		order[ (unsigned int)i ] = (unsigned int)i;
+	}
+	if ( count < 2 ) {
+		return;
+	}
+
+	// Fisher-Yates shuffle
+	unsigned int state = seed;
+	for( size_t i = count - 1; i > 0; i-- ) {
+		state = state * 1664525u + 1013904223u;
+		const size_t j = ( ( (unsigned long long)state * ( i + 1 ) ) >> 32 );
+		std::swap( order[ (unsigned int)i ], order[ (unsigned int)j ] );
+	}
+
+	// Rounds, from the last (largest) one backwards: each takes half of the points left, 
+	// until the first one, small enough not to be worth splitting any further
+	const size_t minRoundSize = 64;
+	size_t end = count;
+	while( end > 0 ) {
+		const size_t begin = end > minRoundSize ? end / 2 : 0;
+		hilbertSort( points, &order[ (unsigned int)begin ], end - begin );
+		end = begin;
+	}
+}
@@ -24,6 +24,7 @@
 
 #include <coreLib.h>
 #include <assert.h>
+#include <climits>
 #include <stack>
 #include <math/algebra/point/point2.h>
 #include <math/algebra/vector/vector2.h>
@@ -37,7 +38,18 @@ namespace RenderLib {
 namespace Geometry {
 namespace Delaunay {
 
+	// Lists allocate from a StaticMemoryPool shared by every list of the type, which 
+	// isn't known to be safe to use from several threads at once. Setting 
+	// DELAUNAY_2D_CONCURRENT_LISTS gives each list its own storage instead, and lets 
+	// constrainedDelaunay2DBatch triangulate its inputs concurrently.
+	#ifndef DELAUNAY_2D_CONCURRENT_LISTS
+	#define DELAUNAY_2D_CONCURRENT_LISTS 0
+	#endif
+	#if DELAUNAY_2D_CONCURRENT_LISTS
+	#define LIST( type ) CoreLib::List< type >
+	#else
 	#define LIST( type ) CoreLib::List< type, CoreLib::Memory::StaticMemoryPool< type > >
+	#endif
 	
 	bool isTriOutside( RenderLib::Math::Vector2f centroid, 
 					const float diagonal, 
@@ -45,23 +57,44 @@ namespace Delaunay {
 					const LIST( RenderLib::Math::Vector2f )& vertices, 
 					int triIdx );
 
+	class AdjacencyInfo;
+
+	// Flags the triangles of a constrained triangulation (indexed as adjacency.triangles) 
+	// lying outside of the regions enclosed by the constraint edges, in linear time. 
+	// Destroyed triangles are flagged as outside.
+	bool trianglesOutside( const AdjacencyInfo& adjacency, 
+						   const LIST( int )& edges, 
+						   LIST( bool )& outside );
 
 
 	////////////////////////////////////////////////////////////////////////////
 	// AdjacencyInfo:
 	// Auxiliary class containing topology information, used to store
 	// information between calls to Delaunay2D and ConstrainedDelaunay2D
+	//
+	// Edges are stored explicitly and referenced by index from the triangles, 
+	// rather than derived from triangle neighbour links: constraint recovery, 
+	// refinement, trianglesOutside and unrecoveredEdges all work on edge indices.
+	// This costs about 150 bytes per point (triangles 56, edges 48, edge table 33).
 	////////////////////////////////////////////////////////////////////////////
 	class AdjacencyInfo {
 	public:
 		AdjacencyInfo();
 
+		// empties the triangulation, keeping the memory allocated for reuse
+		void clear();
+		// reserves room for the triangulation of numVertices points, 2 triangles and 3 edges 
+		// per point, so that the lists aren't regrown nor the edge table rehashed as it's built
+		void preAllocate( size_t numVertices );
+
 		int createTriangle( unsigned int a, unsigned int b, unsigned int c );
 		void removeTriangle( unsigned int t );
 		bool flipTriangles( int tri1, int tri2, int result[2] );
 
 		// returns the triangle index of the triangle containing p
 		int pointInTriangle( const RenderLib::Math::Vector2f& p ) const;
+		// same, walking from startTriangle towards p across the triangle edges
+		int pointInTriangle( const RenderLib::Math::Vector2f& p, const int startTriangle ) const;
 		int pointInTriangleEdge( const RenderLib::Math::Vector2f& p, const int t ) const;
 
 		void splitEdge( int edgeIndex, const RenderLib::Math::Vector2f& p, int result[ 4 ] );
@@ -75,21 +108,33 @@ namespace Delaunay {
 
 		bool buildVertexTriangleAdjacencyInfo();
 
-		unsigned int deleteTrianglesIntersectingSegment_r( const int vIdx0, const int vIdx1, 
-															LIST( int )& upperVertices,
-															LIST( int )& lowerVertices );
+		// scratch buffers for recoverSegment, reused from one segment to the next
+		struct SegmentRecovery_t {
+			typedef LIST( int ) vertexList_t;
 
-		bool triangulateSubPolygon_r( const LIST( int )& indices );
+			LIST( int )	vertexTriangle;	// per vertex, one of the triangles around it, or -1
+			LIST( int )	crossed;		// triangles crossed by the segment
+			LIST( int )	upper;			// vertices on the left of the segment, in order along it
+			LIST( int )	lower;			// same, on the right
+			LIST( int )	ranges;			// pending ranges of the cavity chain being filled
+			LIST( vertexList_t ) constraintEnds;	// per vertex, the other ends of the constraint edges in place
 
-		int findEdge( int v1, int v2 ) const;
+			void addConstraint( const int v0, const int v1 );
+			bool isConstraint( const int v0, const int v1 ) const;
+		};
 
-		float segmentVertexSide( const RenderLib::Math::Vector2f& A, 
-								 const RenderLib::Math::Vector2f& B, 
-								 const RenderLib::Math::Vector2f& P ) const;
+		// makes the segment vIdx0-vIdx1 a chain of edges of the triangulation, 
+		// retriangulating the triangles it crosses, and lists its edges in the 
+		// scratch constraints. Fails, leaving the triangles as they are, if it 
+		// crosses one of those constraints
+		bool recoverSegment( const int vIdx0, const int vIdx1, SegmentRecovery_t& scratch );
+		bool fillCavity( const LIST( int )& chain, const bool leftSide, SegmentRecovery_t& scratch );
+
+		int findEdge( int v1, int v2 ) const;
 
 	public:
 		struct Edge_t {
-			int vertices[2]; // endpoints
+			int vertices[2]; // endpoints, -1 if the edge is free
 			int triangles[2]; // triangles on the positive side [0], and negative side [1]
 
 			Edge_t();
@@ -100,8 +145,6 @@ namespace Delaunay {
 			int vertices[3];
 			int edges[3]; // signed, 1-based
 			bool valid;
-			RenderLib::Math::Point2f	cirumcircleCenter;
-			float							circumcircleRadius;
 
 			Triangle_t();
 			
@@ -111,7 +154,7 @@ namespace Delaunay {
 
 			int localEdgeIndex( int globalEdgeIndex ) const;			
 
-			float insideCircumcircle( const RenderLib::Math::Vector2f& p, const LIST( RenderLib::Math::Vector2f )& verts ) const;
+			double insideCircumcircle( const RenderLib::Math::Vector2f& p, const LIST( RenderLib::Math::Vector2f )& verts ) const;
 		};			
 
 	public:
@@ -120,14 +163,34 @@ namespace Delaunay {
 		LIST( Triangle_t )			triangles;
 		LIST( RenderLib::Math::Vector2f ) vertices;
 		LIST( unsigned int )		invalidTriangles;
+		LIST( int )					freeEdges;		// edges no longer bounding any triangle, to be reused
+		LIST( int )					mergedVertices;	// per input vertex, the one it was merged into for being coincident, or itself
+		LIST( int )					unrecoveredEdges;	// constraints left out by constrainedDelaunay2D, as indices of their pairs in edges
 		
 		typedef LIST( int ) triList_t;
 		LIST( triList_t )	vertexTriangleAdjacencyInfo;
 
+		// open addressing table of edge indices, hashed by their endpoints, -1 if empty
+		LIST( int )			edgeTable;
+
 	//private:
 		unsigned int createEdge( int v1, int v2 );
+		// same as the public one, edgeHints giving per side the index of the edge likely 
+		// joining its vertices, checked before falling back to looking it up, or -1
+		int createTriangle( unsigned int a, unsigned int b, unsigned int c, const int edgeHints[ 3 ] );
+		// index of the edge of t joining v1 and v2, or -1
+		int edgeOf( const Triangle_t& t, int v1, int v2 ) const;
+
+		unsigned int edgeTableSlot( int v1, int v2 ) const;
+		void insertEdgeInTable( int edgeIndex );
+		void removeEdgeFromTable( int edgeIndex );
+		// to be called whenever the edge endpoints are renumbered. The table is sized 
+		// for at least numEdges edges
+		void rebuildEdgeTable( size_t numEdges = 0 );
 
 		int commonEdge( const Triangle_t& tri1, const Triangle_t& tri2 ) const;
+		// whether p lies inside the (counterclockwise) triangle or on its border
+		bool containsPoint( const Triangle_t& t, const RenderLib::Math::Vector2f& p ) const;
 
 	};
 
@@ -151,14 +214,82 @@ namespace Delaunay {
 	// 	moves on, inserting another vertex from V until they have all been triangulated into a mesh, then,
 	// 	like before the super triangle and its edge are removed.
 	/////////////////////////////////////////////////////////////////////////////////////
+	enum Delaunay2DAlgorithm_t {
+		DELAUNAY_2D_LAWSON,				// incremental insertion described above
+		DELAUNAY_2D_DIVIDE_AND_CONQUER	// Guibas-Stolfi: O(n log n), the halves being triangulated concurrently in parallel
+	};
+
+	// Vertices closer to an earlier one than coincidentTolerance times the extent of their 
+	// bounding box are merged into it (see AdjacencyInfo::mergedVertices). The default is a 
+	// few ulps, and 0 merges exact duplicates only.
+	const float DELAUNAY_2D_COINCIDENT_TOLERANCE = 1e-6f;
+
+	// With parallel, the work is spread among the worker threads; no thread is used otherwise.
 	bool delaunay2D( const LIST( RenderLib::Math::Vector2f )& vertices, 
 					 LIST(int)* outTriangles = NULL, 
-					 AdjacencyInfo* adjacencyInfo = NULL );
-
+					 AdjacencyInfo* adjacencyInfo = NULL,
+					 Delaunay2DAlgorithm_t algorithm = DELAUNAY_2D_LAWSON,
+					 bool parallel = false,
+					 float coincidentTolerance = DELAUNAY_2D_COINCIDENT_TOLERANCE );
+
+	// Triangulates the vertices with the edges, given as pairs of vertex indices, forced 
+	// into the triangulation. Constraints crossing each other can't be all recovered: the 
+	// ones crossing a constraint already in place are left out, possibly in part, and so 
+	// are those failing to be recovered. They're listed in unrecoveredEdges of the 
+	// adjacency, and false is returned, though the triangulation is still complete.
+	// The unconstrained triangulation is built with algorithm, as by delaunay2D.
 	bool constrainedDelaunay2D( const LIST( RenderLib::Math::Vector2f )& vertices, 
 								const LIST( int )& edges, 
 								LIST(int)* outTriangles = NULL, 
-								AdjacencyInfo* adjacencyInfo = NULL );
+								AdjacencyInfo* adjacencyInfo = NULL,
+								Delaunay2DAlgorithm_t algorithm = DELAUNAY_2D_LAWSON,
+								float coincidentTolerance = DELAUNAY_2D_COINCIDENT_TOLERANCE );
+
+	/////////////////////////////////////////////////////////////////////////////////////
+	// refineDelaunay2D:
+	// Ruppert's Delaunay refinement of a triangulation built by delaunay2D or 
+	// constrainedDelaunay2D, inserting vertices until no triangle has an angle below 
+	// minAngleDegrees, nor an area above maxArea when it is positive. Up to about 
+	// 20 degrees this terminates, except near input segments meeting at small angles, 
+	// maxSteinerPoints bounding the number of vertices inserted.
+	// The constraint edges, and the border of the triangulation, are split but never 
+	// flipped. On return, edges lists the pieces the constraints were split into, so 
+	// that it can be passed on to trianglesOutside. Returns false when stopped by 
+	// maxSteinerPoints, or when triangles are left below the bounds because they 
+	// couldn't be refined any further, such as next to small input angles or at the 
+	// limit of floating point precision; numUnresolved, if given, receives how many.
+	/////////////////////////////////////////////////////////////////////////////////////
+	bool refineDelaunay2D( AdjacencyInfo& adjacency, 
+						   LIST( int )& edges, 
+						   const float minAngleDegrees = 20.0f, 
+						   const float maxArea = 0.0f, 
+						   const unsigned int maxSteinerPoints = UINT_MAX,
+						   unsigned int* numUnresolved = NULL );
+
+	/////////////////////////////////////////////////////////////////////////////////////
+	// constrainedDelaunay2DBatch:
+	// Triangulates many small independent inputs at once, such as glyph or tile 
+	// outlines. Input i is made of the 
+	// vertices [ vertexOffsets[ i ], vertexOffsets[ i + 1 ] ) and the constraint edges 
+	// [ edgeOffsets[ i ], edgeOffsets[ i + 1 ] ), which index its own vertices from 0; 
+	// both offset lists hold one entry per input plus a last one closing the ranges. 
+	// Its triangles are written to [ triangleOffsets[ i ], triangleOffsets[ i + 1 ] ) 
+	// of outTriangles, indexing the whole vertices list, and with removeOutside only 
+	// those enclosed by the constraints are kept (see trianglesOutside). 
+	// The inputs are spread among the worker threads with DELAUNAY_2D_CONCURRENT_LISTS 
+	// set, and triangulated in turn otherwise. Each thread triangulates its inputs in 
+	// the same AdjacencyInfo and scratch lists, cleared between inputs. Returns false 
+	// if any input couldn't be triangulated, its range being left empty, or had some 
+	// of its constraints left out, as by constrainedDelaunay2D, its triangles being 
+	// kept all the same.
+	/////////////////////////////////////////////////////////////////////////////////////
+	bool constrainedDelaunay2DBatch( const LIST( RenderLib::Math::Vector2f )& vertices, 
+									 const LIST( int )& vertexOffsets, 
+									 const LIST( int )& edges, 
+									 const LIST( int )& edgeOffsets, 
+									 LIST( int )& outTriangles, 
+									 LIST( int )& triangleOffsets, 
+									 const bool removeOutside = false );
 		
 } // namespace Delaunay
 } // namespace Geometry	
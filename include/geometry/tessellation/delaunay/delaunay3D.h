@@ -43,18 +43,44 @@ namespace Delaunay {
 	// struct tetrahedron_t
 	//////////////////////////////////////////////////////////////////////////
 
+	// The faces are given by a constant table over v: [v0 v1 v2] [v0 v3 v1] [v1 v3 v2] [v2 v3 v0],
+	// opposed to v3, v2, v0 and v1 respectively. The vertices are ordered so that all faces
+	// wind outwards.
 	struct tetrahedron_t {
 		int					v[ 4 ];	// vertex indices
-		int			neighbors[ 4 ]; // tetrahedron index adjacent to the i-th face
-		int			face[ 4 ][ 3 ]; // vertex indices for each face
+		int			neighbors[ 4 ]; // adjacent tetrahedron through the i-th face, as ( index << 2 ) | face index in it, or -1
 
 		tetrahedron_t();
 		tetrahedron_t( const tetrahedron_t& other );
 		bool isValid() const;
 		bool containsVertex( const int vert ) const;
 		void getFaceVertices( const int f, int& a, int& b, int& c ) const;
+		int neighbor( const int f ) const { return neighbors[ f ] < 0 ? -1 : neighbors[ f ] >> 2; }
+		int neighborFace( const int f ) const { return neighbors[ f ] & 3; }
 	};
 
+	//////////////////////////////////////////////////////////////////////////
+	// class ITetrahedronSink
+	//
+	// Receives the tetrahedra of a tessellation one at a time, leaving their 
+	// storage up to the caller. Vertex indices refer to the source points, or to 
+	// the vertices of a persistent tessellation, and neighbors to the tetrahedra 
+	// in the order they are received.
+	//////////////////////////////////////////////////////////////////////////
+
+	class ITetrahedronSink {
+	public:
+		virtual			~ITetrahedronSink() {}
+
+		// called once, before any tetrahedron is added
+		virtual void	begin( const size_t numTetrahedra ) = 0;
+		virtual void	add( const tetrahedron_t& t ) = 0;
+	};
+
+	namespace internal {
+		struct persistentState_t;
+	}
+
 	//////////////////////////////////////////////////////////////////////////
 	// class Delaunay3D
 	//
@@ -69,17 +95,69 @@ namespace Delaunay {
 	
 	class Delaunay3D {
 	public:
+		Delaunay3D();
+		~Delaunay3D();
+
+		enum InsertionOrder_t {
+			INSERTION_ORDER_INPUT,	// points are inserted in the order they are given
+			INSERTION_ORDER_BRIO	// biased randomized insertion order: random rounds sorted along a Hilbert curve
+		};
+
+		enum InsertionKernel_t {
+			INSERTION_KERNEL_FLIPS,		// split the tetrahedra holding the point and restore the Delaunay condition with bistellar flips
+			INSERTION_KERNEL_CAVITY		// Bowyer-Watson: remove the tetrahedra in conflict and join the cavity boundary to the point
+		};
+
+		// The resulting list holds no destroyed tetrahedra. In parallel, the points are split into 
+		// cells tessellated concurrently and the cell borders are then tessellated again, resulting 
+		// in the same tetrahedra as the sequential mode, though listed in a different order.
 #if LEAVE_CONTAINING_TETRAHEDRON 
 		bool tetrahedralize( CoreLib::List< Point >& points, 
-							 CoreLib::List< tetrahedron_t >& tetrahedra );
+							 CoreLib::List< tetrahedron_t >& tetrahedra,
+							 InsertionOrder_t insertionOrder = INSERTION_ORDER_INPUT,
+							 bool parallel = false,
+							 InsertionKernel_t kernel = INSERTION_KERNEL_FLIPS );
 #else
 		bool tetrahedralize( const CoreLib::List< Point >& points, 
-							 CoreLib::List< tetrahedron_t >& tetrahedra );
+							 CoreLib::List< tetrahedron_t >& tetrahedra,
+							 InsertionOrder_t insertionOrder = INSERTION_ORDER_INPUT,
+							 bool parallel = false,
+							 InsertionKernel_t kernel = INSERTION_KERNEL_FLIPS );
 #endif
 
+		// Streams the tetrahedra into the sink, leaving out those touching the containing 
+		// tetrahedron whatever LEAVE_CONTAINING_TETRAHEDRON is. The points are not copied.
+		bool tetrahedralize( const CoreLib::List< Point >& points, 
+							 ITetrahedronSink& sink,
+							 InsertionOrder_t insertionOrder = INSERTION_ORDER_INPUT,
+							 bool parallel = false,
+							 InsertionKernel_t kernel = INSERTION_KERNEL_FLIPS );
+
+		// Persistent tessellation. build() keeps the tessellation, which the following
+		// operations then update locally, at a cost depending on the tetrahedra around 
+		// the affected vertex only. Vertex indices are stable: vertex i is getVertices()[ i ] 
+		// until removed, after which the index may be handed out again by an insertion.
+
+		// Tessellates the points, vertex i being points[ i ]. Duplicated points are left out.
+		bool	build( const CoreLib::List< Point >& points );
+		// Returns the index of the new vertex, or -1 if p duplicates an existing one
+		int		insert( const Point& p );
+		bool	remove( const int vertex );
+		// Keeps the vertex index. If p duplicates another vertex, the vertex is removed and false returned.
+		bool	move( const int vertex, const Point& p );
+
+		bool	isVertex( const int vertex ) const;
+		// every vertex index, including the containing and removed ones
+		const CoreLib::List< Point >& getVertices() const;
+		// Streams the current tetrahedra, leaving out those touching the containing tetrahedron
+		void	getTetrahedra( ITetrahedronSink& sink ) const;
+
 	private:	
+		Delaunay3D( const Delaunay3D& );
+		Delaunay3D& operator=( const Delaunay3D& );
 
 		CoreLib::List< REAL > tempVertices;
+		internal::persistentState_t* state;
 
 	};
 
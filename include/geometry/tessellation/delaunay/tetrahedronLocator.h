@@ -0,0 +1,79 @@
+/*
+	================================================================================
+	This software is released under the LGPL-3.0 license: http://www.opensource.org/licenses/lgpl-3.0.html
+
+	Copyright (c) 2012, Jose Esteve. http://www.joesfer.com
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Lesser General Public
+	License as published by the Free Software Foundation; either
+	version 3.0 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public
+	License along with this library; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+	================================================================================
+*/
+
+#pragma once
+
+#include <coreLib.h>
+#include <geometry/bounds/boundingBox.h>
+#include <geometry/tessellation/delaunay/delaunay3D.h>
+
+namespace RenderLib {
+namespace Geometry {
+namespace Delaunay {
+
+	//////////////////////////////////////////////////////////////////////////
+	// class TetrahedronLocator
+	//
+	// Finds the tetrahedron of a finished tessellation containing a point. A 
+	// coarse uniform grid over the tetrahedra holds, per cell, one close to 
+	// it to start from, and a stochastic walk through the neighbors leads 
+	// from there to the one containing the point, in a few steps. Queries 
+	// don't modify the locator, so any number of threads may run them at 
+	// once.
+	//////////////////////////////////////////////////////////////////////////
+
+	class TetrahedronLocator {
+	public:
+		struct location_t {
+			int		tetrahedron;		// -1 if outside of the tessellation
+			REAL	barycentric[ 4 ];	// weights of the vertices of the tetrahedron, adding up to 1
+		};
+
+		TetrahedronLocator();
+
+		// The lists are referenced, not copied: they must outlive the locator and 
+		// remain unchanged. Destroyed tetrahedra, if any, are skipped. The grid spans 
+		// the region given, or all the points if none is: when the tessellation keeps 
+		// its containing tetrahedron, pass the bounds of the input points, or the grid 
+		// would stretch over the far away containing vertices.
+		bool	build( const CoreLib::List< Point >& points, const CoreLib::List< tetrahedron_t >& tetrahedra, const BoundingBox* region = NULL );
+
+		// Returns the tetrahedron containing p, or -1 if it lies outside of the 
+		// tessellation, which is assumed to cover a convex region (as it does 
+		// when keeping the containing tetrahedron)
+		int		locate( const Point& p, REAL barycentric[ 4 ] ) const;
+		void	locate( const CoreLib::List< Point >& queries, CoreLib::List< location_t >& results, bool parallel = true ) const;
+
+	private:
+		int		gridCell( const Point& p ) const;
+
+		const CoreLib::List< Point >*			points;
+		const CoreLib::List< tetrahedron_t >*	tetrahedra;
+		CoreLib::List< int >					grid;			// per cell, a tetrahedron close to it
+		Point									gridMin;
+		REAL									invCellSize;
+		int										resolution[ 3 ];
+	};
+
+} // namespace Delaunay
+} // namespace Geometry
+} // namespace RenderLib
@@ -0,0 +1,64 @@
+/*
+	================================================================================
+	This software is released under the LGPL-3.0 license: http://www.opensource.org/licenses/lgpl-3.0.html
+
+	Copyright (c) 2012, Jose Esteve. http://www.joesfer.com
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Lesser General Public
+	License as published by the Free Software Foundation; either
+	version 3.0 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public
+	License along with this library; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+	================================================================================
+*/
+
+#pragma once
+
+#include <coreLib.h>
+#include <geometry/tessellation/delaunay/delaunay3D.h>
+
+namespace RenderLib {
+namespace Geometry {
+namespace Delaunay {
+
+	//////////////////////////////////////////////////////////////////////////
+	// struct voronoiCells_t
+	//
+	// Voronoi diagram dual to a 3D Delaunay tessellation, in a flat layout. 
+	// Its vertices are the circumcentres of the tetrahedra, and every point 
+	// gets a cell bounded by a face per Delaunay edge leaving it, whose 
+	// vertices are the circumcentres of the tetrahedra around the edge.
+	//////////////////////////////////////////////////////////////////////////
+
+	struct voronoiCells_t {
+		CoreLib::List< Point >			vertices;		// circumcentre of each tetrahedron, by tetrahedron index
+		CoreLib::List< unsigned int >	cellFaces;		// cell i owns faces cellFaces[ i ] to cellFaces[ i + 1 ] - 1
+		CoreLib::List< bool >			bounded;		// per cell, false if some of its faces reach infinity and were left out
+		CoreLib::List< int >			faceSites;		// per face, the point on the other side
+		CoreLib::List< unsigned int >	faceIndices;	// face j owns indices faceIndices[ j ] to faceIndices[ j + 1 ] - 1
+		CoreLib::List< int >			indices;		// face vertices, counter-clockwise seen from outside the cell
+
+		size_t	numCells() const { return bounded.size(); }
+		size_t	numFaces() const { return faceSites.size(); }
+	};
+
+	// Extracts the Voronoi cells of the points from their tessellation, as output by 
+	// Delaunay3D, in parallel if requested. Points on the hull of the tessellation, such 
+	// as the containing vertices when it is kept, get unbounded cells. Destroyed 
+	// tetrahedra, if any, are skipped.
+	bool voronoiCells( const CoreLib::List< Point >& points, 
+					   const CoreLib::List< tetrahedron_t >& tetrahedra, 
+					   voronoiCells_t& cells, 
+					   bool parallel = true );
+
+} // namespace Delaunay
+} // namespace Geometry
+} // namespace RenderLib
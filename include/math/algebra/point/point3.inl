@@ -115,11 +115,11 @@ inline T Point3<T>::distanceToOrigin() const {
 
 template< typename T >
 inline T Point3<T>::distanceSquaredTo( const Point3<T>& p2 ) const { 
-	return DistanceSquared( *this, p2 ); }
+	return distanceSquared( *this, p2 ); }
 
 template< typename T >
 inline T Point3<T>::distanceSquaredToOrigin() const { 
-	return DistanceSquared( *this, Point3<T>() ); 
+	return distanceSquared( *this, Point3<T>() ); 
 }
 
 template< typename T >
@@ -0,0 +1,81 @@
+/*
+	================================================================================
+	This software is released under the LGPL-3.0 license: http://www.opensource.org/licenses/lgpl-3.0.html
+
+	Copyright (c) 2012, Jose Esteve. http://www.joesfer.com
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Lesser General Public
+	License as published by the Free Software Foundation; either
+	version 3.0 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public
+	License along with this library; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+	================================================================================
+*/
+
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+namespace RenderLib {
+namespace Parallel {
+
+	// Number of threads the parallel loops will use, the calling thread included
+	inline unsigned int numThreads() {
+		const unsigned int n = ::std::thread::hardware_concurrency();
+		return n > 0 ? n : 1;
+	}
+
+	/*
+	===================
+	parallelFor
+
+	Splits [begin, end) into chunks of grainSize elements which are handed over to
+	up to numThreads() threads (the calling one included) as they become idle. 
+	func( chunkBegin, chunkEnd ) is called once per chunk, and must be safe to run 
+	concurrently over disjoint ranges. Returns once every chunk has been processed.
+	===================
+	*/
+	template< typename F >
+	void parallelFor( size_t begin, size_t end, size_t grainSize, const F& func ) {
+		if ( end <= begin ) {
+			return;
+		}
+		grainSize = grainSize > 0 ? grainSize : 1;
+		const size_t numChunks = ( end - begin + grainSize - 1 ) / grainSize;
+		const size_t threads = ::std::min( (size_t)numThreads(), numChunks );
+		if ( threads <= 1 ) {
+			func( begin, end );
+			return;
+		}
+
+		::std::atomic< size_t > nextChunk( 0 );
+		auto worker = [ & ]() {
+			for( size_t chunk = nextChunk++; chunk < numChunks; chunk = nextChunk++ ) {
+				const size_t chunkBegin = begin + chunk * grainSize;
+				func( chunkBegin, ::std::min( end, chunkBegin + grainSize ) );
+			}
+		};
+
+		::std::vector< ::std::thread > pool;
+		for( size_t i = 1; i < threads; i++ ) {
+			pool.push_back( ::std::thread( worker ) );
+		}
+		worker();
+		for( size_t i = 0; i < pool.size(); i++ ) {
+			pool[ i ].join();
+		}
+	}
+
+} // namespace Parallel
+} // namespace RenderLib
@@ -43,12 +43,17 @@
 #include <geometry/bounds/boundingBox.h>
 #include <geometry/bounds/bounds2D.h>
 #include <geometry/intersection/intersection.h>
+#include <geometry/predicates/predicates.h>
+#include <geometry/spatialSort/spatialSort.h>
 #include <geometry/utils.h>
 #include <geometry/tessellation/delaunay/delaunay2D.h>
 #include <geometry/tessellation/delaunay/delaunay3D.h>
+#include <geometry/tessellation/delaunay/voronoi3D.h>
+#include <geometry/tessellation/delaunay/tetrahedronLocator.h>
 #include <geometry/topology/halfedge.h>
 
 #include <dataStructs/photonMap/photonMap.h>
+#include <dataStructs/pointKdTree/pointKdTree.h>
 #include <dataStructs/triangleSoup/triangleSoup.h>
 #include <dataStructs/kdtree/kdTree.h>
 #include <dataStructs/bvh/bvh.h>
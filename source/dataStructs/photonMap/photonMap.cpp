@@ -24,6 +24,7 @@
 #include <dataStructs/photonMap/photonMapKNN.h>
 #include <memory.h>
 #include <malloc.h>
+#include <math.h>
 
 namespace RenderLib {
 namespace DataStructures {
@@ -38,7 +39,24 @@ namespace DataStructures {
 	===================
 	*/
 
-	PhotonMap::PhotonMap( const std::vector<RenderLib::Math::Point3f>& samples ) {
+	PhotonMap::PhotonMap( size_t _rebalanceThreshold ) : 
+		levelsSize( 0 ), 
+		rebalanceThreshold( _rebalanceThreshold ), 
+		rebalanceDone( false ), 
+		rebalanceCount( 0 ), 
+		rebalanceLevel( -1 ), 
+		rebalanced( NULL ), 
+		activeQueries( 0 ) {
+	}
+
+	PhotonMap::PhotonMap( const std::vector<RenderLib::Math::Point3f>& samples, size_t _rebalanceThreshold ) : 
+		levelsSize( 0 ), 
+		rebalanceThreshold( _rebalanceThreshold ), 
+		rebalanceDone( false ), 
+		rebalanceCount( 0 ), 
+		rebalanceLevel( -1 ), 
+		rebalanced( NULL ), 
+		activeQueries( 0 ) {
 		
 		sampleMap.resize(samples.size());
 		for( size_t i = 0; i < samples.size(); i++ ) {
@@ -58,6 +76,174 @@ namespace DataStructures {
 	===================
 	*/
 	PhotonMap::~PhotonMap() {
+		if ( rebalanceThread.joinable() ) {
+			rebalanceThread.join();
+		}
+		delete rebalanced;
+		for( size_t i = 0; i < levels.size(); i++ ) {
+			delete levels[ i ];
+		}
+	}
+
+	/*
+	===================
+	PhotonMap::commitSamples
+	===================
+	*/
+	SampleIndex_t PhotonMap::commitSamples( PhotonMapStagingBuffer& staging ) {
+		std::lock_guard< std::mutex > lock( commitMutex );
+		assert( activeQueries == 0 ); // commits must not overlap with queries
+
+		const SampleIndex_t first = (SampleIndex_t)size();
+		pendingSamples.insert( pendingSamples.end(), staging.samples.begin(), staging.samples.end() );
+		staging.clear();
+
+		if ( rebalanceDone ) {
+			installRebalance();
+		}
+		if ( !rebalanceThread.joinable() && pendingSamples.size() >= rebalanceThreshold ) {
+			launchRebalance( false );
+		}
+		return first;
+	}
+
+	/*
+	===================
+	PhotonMap::flush
+	===================
+	*/
+	void PhotonMap::flush() {
+		std::lock_guard< std::mutex > lock( commitMutex );
+		assert( activeQueries == 0 ); // flushes must not overlap with queries
+
+		if ( rebalanceThread.joinable() ) {
+			installRebalance();
+		}
+		if ( !pendingSamples.empty() || !levels.empty() ) {
+			launchRebalance( true );
+			installRebalance();
+		}
+	}
+
+	/*
+	===================
+	PhotonMap::launchRebalance
+
+	The worker builds a new balanced tree from the current pending samples and the 
+	younger trees no larger than the result, as in incrementing a binary counter. 
+	The main tree is rebuilt too once it's no larger either, or when mergeAll is set.
+	The live trees are only read meanwhile (they aren't modified until the result 
+	is installed), but the pending buffer may grow under further commits, so its 
+	samples are copied here.
+	===================
+	*/
+	void PhotonMap::launchRebalance( bool mergeAll ) {
+		assert( !rebalanceThread.joinable() && rebalanced == NULL );
+		rebalanceCount = pendingSamples.size();
+		size_t merged = rebalanceCount;
+		rebalanceLevel = (int)levels.size();
+		while( rebalanceLevel > 0 && levels[ rebalanceLevel - 1 ]->sampleMap.size() <= merged ) {
+			rebalanceLevel--;
+			merged += levels[ rebalanceLevel ]->sampleMap.size();
+		}
+		if ( mergeAll || ( rebalanceLevel == 0 && sampleMap.size() <= merged ) ) {
+			rebalanceLevel = -1;
+		}
+		rebalanceDone = false;
+		std::vector<RenderLib::Math::Point3f>* samples = new std::vector<RenderLib::Math::Point3f>( pendingSamples );
+		rebalanceThread = std::thread( rebalance, this, samples );
+	}
+
+	/*
+	===================
+	PhotonMap::rebalance
+	===================
+	*/
+	void PhotonMap::rebalance( PhotonMap* map, std::vector<RenderLib::Math::Point3f>* pending ) {
+		// gather the samples in internal order: the merged trees first, pending ones afterwards
+		std::vector<RenderLib::Math::Point3f> samples;
+		size_t rangeStart = map->sampleMap.size();
+		if ( map->rebalanceLevel < 0 ) {
+			rangeStart = 0;
+			for( size_t i = 0; i < map->sampleMap.size(); i++ ) {
+				samples.push_back( map->sampleMap[ i ].position );
+			}
+		}
+		for( size_t l = 0; l < map->levels.size(); l++ ) {
+			const PhotonMap* level = map->levels[ l ];
+			if ( (int)l < map->rebalanceLevel ) {
+				rangeStart += level->sampleMap.size();
+				continue;
+			}
+			for( size_t i = 0; i < level->sampleMap.size(); i++ ) {
+				samples.push_back( level->sampleMap[ i ].position );
+			}
+		}
+		samples.insert( samples.end(), pending->begin(), pending->end() );
+		delete pending;
+
+		PhotonMap* result = new PhotonMap( samples );
+
+		// the new mapping points into the internal order of the merged range, turn it into source order
+		for( size_t i = 0; i < result->mapping.size(); i++ ) {
+			result->mapping[ i ] = map->sourceIndex( (SampleIndex_t)rangeStart + result->mapping[ i ] );
+		}
+
+		map->rebalanced = result;
+		map->rebalanceDone = true;
+	}
+
+	/*
+	===================
+	PhotonMap::installRebalance
+	===================
+	*/
+	void PhotonMap::installRebalance() {
+		rebalanceThread.join();
+		assert( rebalanced != NULL );
+
+		const size_t firstMerged = rebalanceLevel < 0 ? 0 : (size_t)rebalanceLevel;
+		for( size_t l = firstMerged; l < levels.size(); l++ ) {
+			delete levels[ l ];
+		}
+		levels.resize( firstMerged );
+		if ( rebalanceLevel < 0 ) {
+			sampleMap.swap( rebalanced->sampleMap );
+			mapping.swap( rebalanced->mapping );
+			bbox = rebalanced->bbox;
+			delete rebalanced;
+		} else {
+			levels.push_back( rebalanced );
+		}
+		levelsSize = 0;
+		for( size_t l = 0; l < levels.size(); l++ ) {
+			levelsSize += levels[ l ]->sampleMap.size();
+		}
+		pendingSamples.erase( pendingSamples.begin(), pendingSamples.begin() + rebalanceCount );
+
+		rebalanced = NULL;
+		rebalanceCount = 0;
+		rebalanceLevel = -1;
+		rebalanceDone = false;
+	}
+
+	/*
+	===================
+	PhotonMap::sourceIndex
+	===================
+	*/
+	SampleIndex_t PhotonMap::sourceIndex( SampleIndex_t internalIndex ) const {
+		if ( internalIndex < mapping.size() ) {
+			return mapping[ internalIndex ];
+		}
+		SampleIndex_t local = internalIndex - (SampleIndex_t)mapping.size();
+		for( size_t l = 0; l < levels.size(); l++ ) {
+			if ( local < levels[ l ]->mapping.size() ) {
+				return levels[ l ]->mapping[ local ];
+			}
+			local -= (SampleIndex_t)levels[ l ]->mapping.size();
+		}
+		return internalIndex; // pending samples are in source order
 	}
 
 	/*
@@ -68,33 +254,143 @@ namespace DataStructures {
 
 	void PhotonMap::nearestSamples( const ::RenderLib::Math::Point3f& pos, int maxSamples, float maxDist, 
 									SampleIndex_t* neighbors, // out: array of "maxSamples" size of pointers to T
-									int& found			 // out: number of samples found
+									int& found,			 // out: number of samples found
+									float epsilon		 // in: approximation bound, 0 for an exact query
 								   ) {
-		if ( sampleMap.size() == 0 ) {
+		found = 0;
+		if ( size() == 0 || maxSamples <= 0 ) {
 			return;
 		}
 
-		PhotonMapKNN ns( maxSamples, maxDist );
+		float* sqDistances = (float*)alloca( maxSamples * sizeof( float ) );
+		if ( sqDistances == NULL ) {
+			return;
+		}
 
-		memset( neighbors, 0, maxSamples * sizeof( SampleIndex_t ) );
+		found = gatherNearest( pos, maxSamples, maxDist, epsilon, neighbors, sqDistances );
+		for( int i = 0; i < found; i++ ) {
+			neighbors[ i ] = sourceIndex( neighbors[ i ] );
+		}
+	}
+
+	/*
+	===================
+	PhotonMap::gatherNearest
+	===================
+	*/
+
+	int PhotonMap::gatherNearest( const RenderLib::Math::Point3f& pos, int maxSamples, float maxDist, float epsilon,
+								  SampleIndex_t* treeIndices, float* sqDistances ) const {
+		if ( size() == 0 || maxSamples <= 0 ) {
+			return 0;
+		}
+		QueryScope scope( *this );
+
+		// pick the smallest sorted buffer fitting the query
+		if ( maxSamples <= 4 ) {
+			return gatherNearestSorted< 4 >( pos, maxSamples, maxDist, epsilon, treeIndices, sqDistances );
+		} else if ( maxSamples <= 8 ) {
+			return gatherNearestSorted< 8 >( pos, maxSamples, maxDist, epsilon, treeIndices, sqDistances );
+		} else if ( maxSamples <= 16 ) {
+			return gatherNearestSorted< 16 >( pos, maxSamples, maxDist, epsilon, treeIndices, sqDistances );
+		} else if ( maxSamples <= 32 ) {
+			return gatherNearestSorted< 32 >( pos, maxSamples, maxDist, epsilon, treeIndices, sqDistances );
+		}
+
+		PhotonMapKNN ns( maxSamples, maxDist, epsilon );
+
+		// the heap is 1-based
 		ns.squaredDist	= (float*)alloca( (maxSamples+1) * sizeof(float) );
-		if ( ns.squaredDist == NULL ) {
-			return;
+		ns.index		= (SampleIndex_t*)alloca( (maxSamples+1) * sizeof(SampleIndex_t) );
+		if ( ns.squaredDist == NULL || ns.index == NULL ) {
+			return 0;
 		}
-		ns.index		= neighbors;
 
 		ns.pos					= pos;
 		ns.found				= 0;
 		ns.heapBuilt			= false;
 		ns.squaredDist[0]		= maxDist * maxDist;
 
-		// Fetch the nearest N samples, searching the whole tree (idx = 0 = root)
-		nearestSamples_r( &ns, 0 );
+		// Fetch the nearest N samples, searching the whole tree (idx = 0 = root) and the unbalanced samples
+		if ( !sampleMap.empty() ) {
+			nearestSamples_r( &ns, 0, 0 );
+		}
+		nearestPendingSamples( &ns );
+
+		memcpy( treeIndices, ns.index + 1, ns.found * sizeof( SampleIndex_t ) );
+		memcpy( sqDistances, ns.squaredDist + 1, ns.found * sizeof( float ) );
+		return ns.found;
+	}
 
-		for( int i = 1; i <= ns.found; i++ ) {
-			ns.index[i] = mapping[ns.index[i]];
+	/*
+	===================
+	PhotonMap::gatherNearestSorted
+	===================
+	*/
+
+	template< int K >
+	int PhotonMap::gatherNearestSorted( const RenderLib::Math::Point3f& pos, int maxSamples, float maxDist, float epsilon,
+										SampleIndex_t* treeIndices, float* sqDistances ) const {
+		PhotonMapKNNSorted< K > ns( maxSamples, maxDist, epsilon );
+		ns.pos = pos;
+
+		if ( !sampleMap.empty() ) {
+			nearestSamples_r( &ns, 0, 0 );
+		}
+		nearestPendingSamples( &ns );
+
+		memcpy( treeIndices, ns.index, ns.found * sizeof( SampleIndex_t ) );
+		memcpy( sqDistances, ns.squaredDist, ns.found * sizeof( float ) );
+		return ns.found;
+	}
+
+	/*
+	===================
+	PhotonMap::filterWeight
+	===================
+	*/
+
+	float PhotonMap::filterWeight( PhotonFilter_t filter, float filterParam, float sqDist, float sqRadius ) {
+		switch( filter ) {
+			case PHOTON_FILTER_CONE: 
+				{
+					// filterParam = k >= 1 
+					const float w = 1.0f - sqrtf( sqDist / sqRadius ) / filterParam;
+					return w > 0 ? w : 0;
+				}
+			case PHOTON_FILTER_GAUSSIAN:
+				{
+					// Pavicic's normalized gaussian filter, see Jensen's "Realistic Image Synthesis Using Photon Mapping"
+					const float alpha = 0.918f;
+					const float beta = 1.953f;
+					return alpha * ( 1.0f - ( 1.0f - expf( -beta * sqDist / ( 2.0f * sqRadius ) ) ) / ( 1.0f - expf( -beta ) ) );
+				}
+			case PHOTON_FILTER_NONE:
+			default:
+				return 1.0f;
+		}
+	}
+
+	/*
+	===================
+	PhotonMap::filterNormalization
+	===================
+	*/
+
+	float PhotonMap::filterNormalization( PhotonFilter_t filter, float filterParam ) {
+		switch( filter ) {
+			case PHOTON_FILTER_CONE: 
+				return 1.0f - 2.0f / ( 3.0f * filterParam );
+			case PHOTON_FILTER_GAUSSIAN:
+				{
+					const float alpha = 0.918f;
+					const float beta = 1.953f;
+					return alpha * ( 1.0f - ( 1.0f - 2.0f * ( 1.0f - expf( -0.5f * beta ) ) / beta ) / ( 1.0f - expf( -beta ) ) );
+				}
+			case PHOTON_FILTER_NONE:
+			default:
+				return 1.0f;
 		}
-		found = ns.found;
 	}
 
 	/*
@@ -103,35 +399,40 @@ namespace DataStructures {
 	===================
 	*/
 
-	void PhotonMap::nearestSamples_r( PhotonMapKNN* nearestSamples, SampleIndex_t arrayIndex ) const {
+	template< typename KNN >
+	void PhotonMap::nearestSamples_r( KNN* nearestSamples, SampleIndex_t arrayIndex, SampleIndex_t offset ) const {
 		const PhotonMapSample_t& sample = sampleMap[arrayIndex];
 
 		float distance;
 
-		if ( arrayIndex < ( sampleMap.size() >> 1 ) - 1 ) {
-			// if we haven't surpassed half of the stored nodes, we're in an internal node of the tree
-			// (beyond that limit, everything is a leaf in the array), so we search recursively
+		const size_t leftChild = 2 * (size_t)arrayIndex + 1;
+		if ( leftChild < sampleMap.size() ) {
+			// if the node has children, we're in an internal node of the tree
+			// (beyond half of the stored nodes, everything is a leaf in the array), so we search recursively
 
 			// Split plane distance
 			int splitPlane = sample.split;
 			distance = nearestSamples->pos[splitPlane] - sample.position[ splitPlane ];
-			const int leftChild = 2 * ( arrayIndex + 1 ) - 1;
-			const int rightChild = leftChild + 1;
+			const size_t rightChild = leftChild + 1; // the last internal node may only have a left child
 			if (distance > 0.0f) {
 				// we're in the right-side leaf
-				nearestSamples_r( nearestSamples, rightChild ); // right child			
-				if ( distance * distance < nearestSamples->squaredDist[0] ) {
+				if ( rightChild < sampleMap.size() ) {
+					nearestSamples_r( nearestSamples, (SampleIndex_t)rightChild, offset ); // right child			
+				}
+				if ( distance * distance * nearestSamples->sqPruneScale < nearestSamples->SquaredRadius() ) {
 					// we can still keep searching, the split plane is closer than the max search radius
+					// (shrunk by 1 + epsilon on approximate queries)
 					// search in the left node
-					nearestSamples_r( nearestSamples, leftChild ); // left child
+					nearestSamples_r( nearestSamples, (SampleIndex_t)leftChild, offset ); // left child
 				};
 			} else {
 				// we're in the left-side leaf
-				nearestSamples_r( nearestSamples, leftChild ); //  left child
-				if ( distance * distance < nearestSamples->squaredDist[0] ) {
+				nearestSamples_r( nearestSamples, (SampleIndex_t)leftChild, offset ); //  left child
+				if ( distance * distance * nearestSamples->sqPruneScale < nearestSamples->SquaredRadius() && rightChild < sampleMap.size() ) {
 					// we can still keep searching, the split plane is closer than the max search radius
+					// (shrunk by 1 + epsilon on approximate queries)
 					// search in the right node
-					nearestSamples_r( nearestSamples, rightChild );
+					nearestSamples_r( nearestSamples, (SampleIndex_t)rightChild, offset );
 				}
 			}
 		}
@@ -140,22 +441,29 @@ namespace DataStructures {
 
 		// Calculate the squared distance from the requested position and the sample
 		float dist2 = ( sample.position - nearestSamples->pos ).lengthSquared( );
-		if ( dist2 < nearestSamples->squaredDist[0] ) {
-			// sample is inside the search radius
-			if ( nearestSamples->found < nearestSamples->maxSamples ) {
-				// we can keep this sample	
-				nearestSamples->found++;
-				nearestSamples->squaredDist[ nearestSamples->found ] = dist2;
-				nearestSamples->index[ nearestSamples->found ] = arrayIndex;
-			} else {
-				// The array is full, so we must use the heap to see if we accept or reject this new sample 
-				if ( nearestSamples->heapBuilt == false ) {
-					nearestSamples->BuildMaxHeap();
-				}
+		nearestSamples->AddCandidate( offset + arrayIndex, dist2 );
+	}
 
-				// Add the new sample into the max heap 
-				nearestSamples->AddSample( arrayIndex, dist2 );
+	/*
+	===================
+	PhotonMap::nearestPendingSamples
+	===================
+	*/
+
+	template< typename KNN >
+	void PhotonMap::nearestPendingSamples( KNN* nearestSamples ) const {
+		SampleIndex_t offset = (SampleIndex_t)sampleMap.size();
+		for( size_t l = 0; l < levels.size(); l++ ) {
+			if ( !levels[ l ]->sampleMap.empty() ) {
+				levels[ l ]->nearestSamples_r( nearestSamples, 0, offset );
 			}
+			offset += (SampleIndex_t)levels[ l ]->sampleMap.size();
+		}
+
+		// the unbalanced buffer is kept small, so a linear scan will do
+		for( size_t i = 0; i < pendingSamples.size(); i++ ) {
+			const float dist2 = ( pendingSamples[ i ] - nearestSamples->pos ).lengthSquared( );
+			nearestSamples->AddCandidate( offset + (SampleIndex_t)i, dist2 );
 		}
 	}
 
@@ -168,7 +476,10 @@ namespace DataStructures {
 
 	void PhotonMap::balanceKDTree() {
 		
-		if ( sampleMap.size() > 1) {
+		if ( sampleMap.size() == 1 ) {
+			mapping.resize( 1, 0 );
+			sampleMap[ 0 ].split = 0;
+		} else if ( sampleMap.size() > 1) {
 			// temp arrays for sorting
 			using namespace std;
 			vector<PhotonMapSample_t*> balancedAux;
@@ -325,6 +636,86 @@ namespace DataStructures {
 		}
 	}
 		
+	//////////////////////////////////////////////////////////////////////////
+	// Photon_t
+	//////////////////////////////////////////////////////////////////////////
+
+	// decoding tables for the quantized photon directions
+	struct photonDirectionTables_t {
+		float cosTheta[ 256 ], sinTheta[ 256 ];
+		float cosPhi[ 256 ], sinPhi[ 256 ];
+
+		photonDirectionTables_t() {
+			for( int i = 0; i < 256; i++ ) {
+				const double angle = ( i + 0.5 ) * ( 1.0 / 256.0 ) * RenderLib::Math::PI;
+				cosTheta[ i ] = (float)cos( angle );
+				sinTheta[ i ] = (float)sin( angle );
+				cosPhi[ i ] = (float)cos( 2.0 * angle );
+				sinPhi[ i ] = (float)sin( 2.0 * angle );
+			}
+		}
+	};
+	static const photonDirectionTables_t photonDirectionTables;
+
+	/*
+	===================
+	Photon_t::setPower
+
+	Ward's RGBE encoding: the three components share the exponent of the largest one
+	===================
+	*/
+	void Photon_t::setPower( const RenderLib::Math::Vector3f& rgb ) {
+		float v = rgb.x > rgb.y ? rgb.x : rgb.y;
+		v = rgb.z > v ? rgb.z : v;
+		if ( v < 1e-32f ) {
+			power[ 0 ] = power[ 1 ] = power[ 2 ] = power[ 3 ] = 0;
+			return;
+		}
+		int e;
+		const float scale = frexpf( v, &e ) * 256.0f / v;
+		power[ 0 ] = (unsigned char)( rgb.x > 0 ? rgb.x * scale : 0 );
+		power[ 1 ] = (unsigned char)( rgb.y > 0 ? rgb.y * scale : 0 );
+		power[ 2 ] = (unsigned char)( rgb.z > 0 ? rgb.z * scale : 0 );
+		power[ 3 ] = (unsigned char)( e + 128 );
+	}
+
+	/*
+	===================
+	Photon_t::getPower
+	===================
+	*/
+	RenderLib::Math::Vector3f Photon_t::getPower() const {
+		if ( power[ 3 ] == 0 ) {
+			return RenderLib::Math::Vector3f( 0, 0, 0 );
+		}
+		const float f = ldexpf( 1.0f, (int)power[ 3 ] - ( 128 + 8 ) );
+		return RenderLib::Math::Vector3f( ( power[ 0 ] + 0.5f ) * f, ( power[ 1 ] + 0.5f ) * f, ( power[ 2 ] + 0.5f ) * f );
+	}
+
+	/*
+	===================
+	Photon_t::setDirection
+	===================
+	*/
+	void Photon_t::setDirection( const RenderLib::Math::Vector3f& dir ) {
+		const float z = dir.z < -1.0f ? -1.0f : ( dir.z > 1.0f ? 1.0f : dir.z );
+		const int t = (int)( acosf( z ) * ( 256.0f / (float)RenderLib::Math::PI ) );
+		const int p = (int)floorf( atan2f( dir.y, dir.x ) * ( 256.0f / ( 2.0f * (float)RenderLib::Math::PI ) ) );
+		theta = (unsigned char)( t > 255 ? 255 : t );
+		phi = (unsigned char)( p & 255 );
+	}
+
+	/*
+	===================
+	Photon_t::getDirection
+	===================
+	*/
+	RenderLib::Math::Vector3f Photon_t::getDirection() const {
+		return RenderLib::Math::Vector3f( photonDirectionTables.sinTheta[ theta ] * photonDirectionTables.cosPhi[ phi ],
+										  photonDirectionTables.sinTheta[ theta ] * photonDirectionTables.sinPhi[ phi ],
+										  photonDirectionTables.cosTheta[ theta ] );
+	}
+
 	//////////////////////////////////////////////////////////////////////////
 	// PhotonMapKNN
 	//////////////////////////////////////////////////////////////////////////
@@ -359,9 +750,37 @@ namespace DataStructures {
 			squaredDist[parent] = dst2;
 			index[parent] = sample;
 		}
+		squaredDist[0] = squaredDist[1];
 		heapBuilt = true;
 	}
 
+	/*
+	===================
+	PhotonMapKNN::AddCandidate
+	===================
+	*/
+	void PhotonMapKNN::AddCandidate( SampleIndex_t s, float sqDist ) {
+		if ( sqDist >= squaredDist[0] ) {
+			return; // outside of the search radius
+		}
+		if ( found < maxSamples ) {
+			// we can keep this sample	
+			found++;
+			squaredDist[ found ] = sqDist;
+			index[ found ] = s;
+		} else {
+			// The array is full, so we must use the heap to see if we accept or reject this new sample 
+			if ( heapBuilt == false ) {
+				BuildMaxHeap(); // shrinks the search radius to the farthest sample kept
+			}
+
+			// Add the new sample into the max heap 
+			if ( sqDist < squaredDist[0] ) {
+				AddSample( s, sqDist );
+			}
+		}
+	}
+
 	/*
 	===================
 	PhotonMapKNN::AddSample
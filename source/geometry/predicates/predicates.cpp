@@ -0,0 +1,579 @@
+/*
+	================================================================================
+	This software is released under the LGPL-3.0 license: http://www.opensource.org/licenses/lgpl-3.0.html
+
+	Copyright (c) 2012, Jose Esteve. http://www.joesfer.com
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Lesser General Public
+	License as published by the Free Software Foundation; either
+	version 3.0 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public
+	License along with this library; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+	================================================================================
+*/
+
+#include <geometry/predicates/predicates.h>
+#include <math.h>
+#include <vector>
+
+namespace RenderLib {
+namespace Geometry {
+
+namespace internal {
+
+	//////////////////////////////////////////////////////////////////////////
+	// Floating-point expansions
+	//
+	// An expansion represents a number as the exact sum of nonoverlapping 
+	// doubles stored by increasing magnitude, so its sign is the sign of 
+	// the last (largest) component. Rounding to nearest even is assumed.
+	//////////////////////////////////////////////////////////////////////////
+
+	const double epsilon = 1.1102230246251565e-16; // 2^-53, half an ulp of 1
+	const double orient2DErrorBound = ( 3.0 + 16.0 * epsilon ) * epsilon;
+	const double inCircle2DErrorBound = ( 10.0 + 96.0 * epsilon ) * epsilon;
+	const double orient3DErrorBound = ( 7.0 + 56.0 * epsilon ) * epsilon;
+	const double inSphereErrorBound = ( 16.0 + 224.0 * epsilon ) * epsilon;
+
+	// x + y = a + b exactly, requires |a| >= |b|
+	inline void fastTwoSum( const double a, const double b, double& x, double& y ) {
+		x = a + b;
+		const double bVirtual = x - a;
+		y = b - bVirtual;
+	}
+
+	// x + y = a + b exactly
+	inline void twoSum( const double a, const double b, double& x, double& y ) {
+		x = a + b;
+		const double bVirtual = x - a;
+		const double aVirtual = x - bVirtual;
+		const double bRoundoff = b - bVirtual;
+		const double aRoundoff = a - aVirtual;
+		y = aRoundoff + bRoundoff;
+	}
+
+	// x + y = a - b exactly
+	inline void twoDiff( const double a, const double b, double& x, double& y ) {
+		x = a - b;
+		const double bVirtual = a - x;
+		const double aVirtual = x + bVirtual;
+		const double bRoundoff = bVirtual - b;
+		const double aRoundoff = a - aVirtual;
+		y = aRoundoff + bRoundoff;
+	}
+
+	// x + y = a * b exactly
+	inline void twoProduct( const double a, const double b, double& x, double& y ) {
+		x = a * b;
+		y = fma( a, b, -x );
+	}
+
+	class Expansion {
+	public:
+		Expansion() : components( 1, 0.0 ) {}
+		Expansion( const double a ) : components( 1, a ) {}
+		// exact difference a - b
+		static Expansion difference( const double a, const double b );
+
+		int sign() const;
+		double estimate() const;
+
+		Expansion operator+( const Expansion& other ) const;
+		Expansion operator-( const Expansion& other ) const;
+		Expansion operator*( const Expansion& other ) const;
+
+	private:
+		Expansion scale( const double b ) const;
+		// pops the smaller in magnitude of the next components of e and f
+		static double nextSmallest( const std::vector< double >& e, size_t& ei, const std::vector< double >& f, size_t& fi );
+
+		std::vector< double > components; // never empty, zero components removed
+	};
+
+	/*
+	================
+	Expansion::difference
+	================
+	*/
+	Expansion Expansion::difference( const double a, const double b ) {
+		double x, y;
+		twoDiff( a, b, x, y );
+		Expansion e( y );
+		if ( y == 0.0 ) {
+			e.components[ 0 ] = x;
+		} else if ( x != 0.0 ) {
+			e.components.push_back( x );
+		}
+		return e;
+	}
+
+	/*
+	================
+	Expansion::sign
+	================
+	*/
+	int Expansion::sign() const {
+		const double top = components.back();
+		return top > 0.0 ? 1 : ( top < 0.0 ? -1 : 0 );
+	}
+
+	/*
+	================
+	Expansion::estimate
+	================
+	*/
+	double Expansion::estimate() const {
+		double sum = 0;
+		for( size_t i = 0; i < components.size(); i++ ) {
+			sum += components[ i ];
+		}
+		return sum;
+	}
+
+	/*
+	================
+	Expansion::nextSmallest
+	================
+	*/
+	double Expansion::nextSmallest( const std::vector< double >& e, size_t& ei, const std::vector< double >& f, size_t& fi ) {
+		if ( fi == f.size() || ( ei < e.size() && ( ( f[ fi ] > e[ ei ] ) == ( f[ fi ] > -e[ ei ] ) ) ) ) {
+			return e[ ei++ ];
+		}
+		return f[ fi++ ];
+	}
+
+	/*
+	================
+	Expansion::operator+
+
+	Merges both component lists by magnitude while accumulating 
+	(Shewchuk's fast_expansion_sum_zeroelim)
+	================
+	*/
+	Expansion Expansion::operator+( const Expansion& other ) const {
+		const std::vector< double >& e = components;
+		const std::vector< double >& f = other.components;
+		const size_t eLen = e.size();
+		const size_t fLen = f.size();
+
+		Expansion h;
+		h.components.clear();
+		h.components.reserve( eLen + fLen );
+
+		size_t ei = 0, fi = 0;
+		double Q, Qnew, hh;
+		Q = nextSmallest( e, ei, f, fi );
+		if ( ei + fi < eLen + fLen ) {
+			fastTwoSum( nextSmallest( e, ei, f, fi ), Q, Qnew, hh );
+			Q = Qnew;
+			if ( hh != 0.0 ) {
+				h.components.push_back( hh );
+			}
+			while( ei + fi < eLen + fLen ) {
+				twoSum( Q, nextSmallest( e, ei, f, fi ), Qnew, hh );
+				Q = Qnew;
+				if ( hh != 0.0 ) {
+					h.components.push_back( hh );
+				}
+			}
+		}
+		if ( Q != 0.0 || h.components.empty() ) {
+			h.components.push_back( Q );
+		}
+		return h;
+	}
+
+	/*
+	================
+	Expansion::operator-
+	================
+	*/
+	Expansion Expansion::operator-( const Expansion& other ) const {
+		Expansion negated( other );
+		for( size_t i = 0; i < negated.components.size(); i++ ) {
+			negated.components[ i ] = -negated.components[ i ];
+		}
+		return *this + negated;
+	}
+
+	/*
+	================
+	Expansion::scale
+
+	Multiplies the expansion by a double (Shewchuk's scale_expansion_zeroelim)
+	================
+	*/
+	Expansion Expansion::scale( const double b ) const {
+		Expansion h;
+		h.components.clear();
+		h.components.reserve( 2 * components.size() );
+
+		double Q, hh;
+		twoProduct( components[ 0 ], b, Q, hh );
+		if ( hh != 0.0 ) {
+			h.components.push_back( hh );
+		}
+		for( size_t i = 1; i < components.size(); i++ ) {
+			double product1, product0, sum;
+			twoProduct( components[ i ], b, product1, product0 );
+			twoSum( Q, product0, sum, hh );
+			if ( hh != 0.0 ) {
+				h.components.push_back( hh );
+			}
+			fastTwoSum( product1, sum, Q, hh );
+			if ( hh != 0.0 ) {
+				h.components.push_back( hh );
+			}
+		}
+		if ( Q != 0.0 || h.components.empty() ) {
+			h.components.push_back( Q );
+		}
+		return h;
+	}
+
+	/*
+	================
+	Expansion::operator*
+	================
+	*/
+	Expansion Expansion::operator*( const Expansion& other ) const {
+		Expansion product = scale( other.components[ 0 ] );
+		for( size_t i = 1; i < other.components.size(); i++ ) {
+			product = product + scale( other.components[ i ] );
+		}
+		return product;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Exact evaluation
+	//
+	// Same determinant expansions as the floating-point filters, with the 
+	// translated coordinates represented exactly.
+	//////////////////////////////////////////////////////////////////////////
+
+	/*
+	================
+	orient2DExact
+	================
+	*/
+	double orient2DExact( const RenderLib::Math::Vector2< double >& a, 
+						  const RenderLib::Math::Vector2< double >& b, 
+						  const RenderLib::Math::Vector2< double >& c ) {
+		const Expansion acx = Expansion::difference( a.x, c.x );
+		const Expansion acy = Expansion::difference( a.y, c.y );
+		const Expansion bcx = Expansion::difference( b.x, c.x );
+		const Expansion bcy = Expansion::difference( b.y, c.y );
+
+		const Expansion det = acx * bcy - acy * bcx;
+		return det.estimate();
+	}
+
+	/*
+	================
+	inCircle2DExact
+	================
+	*/
+	double inCircle2DExact( const RenderLib::Math::Vector2< double >& a, 
+							const RenderLib::Math::Vector2< double >& b, 
+							const RenderLib::Math::Vector2< double >& c, 
+							const RenderLib::Math::Vector2< double >& d ) {
+		const Expansion adx = Expansion::difference( a.x, d.x );
+		const Expansion ady = Expansion::difference( a.y, d.y );
+		const Expansion bdx = Expansion::difference( b.x, d.x );
+		const Expansion bdy = Expansion::difference( b.y, d.y );
+		const Expansion cdx = Expansion::difference( c.x, d.x );
+		const Expansion cdy = Expansion::difference( c.y, d.y );
+
+		const Expansion aLift = adx * adx + ady * ady;
+		const Expansion bLift = bdx * bdx + bdy * bdy;
+		const Expansion cLift = cdx * cdx + cdy * cdy;
+
+		const Expansion det = aLift * ( bdx * cdy - cdx * bdy ) 
+							+ bLift * ( cdx * ady - adx * cdy ) 
+							+ cLift * ( adx * bdy - bdx * ady );
+		return det.estimate();
+	}
+
+	/*
+	================
+	orient3DExact
+	================
+	*/
+	double orient3DExact( const RenderLib::Math::Point3< double >& a, 
+						  const RenderLib::Math::Point3< double >& b, 
+						  const RenderLib::Math::Point3< double >& c, 
+						  const RenderLib::Math::Point3< double >& d ) {
+		const Expansion adx = Expansion::difference( a.x, d.x );
+		const Expansion ady = Expansion::difference( a.y, d.y );
+		const Expansion adz = Expansion::difference( a.z, d.z );
+		const Expansion bdx = Expansion::difference( b.x, d.x );
+		const Expansion bdy = Expansion::difference( b.y, d.y );
+		const Expansion bdz = Expansion::difference( b.z, d.z );
+		const Expansion cdx = Expansion::difference( c.x, d.x );
+		const Expansion cdy = Expansion::difference( c.y, d.y );
+		const Expansion cdz = Expansion::difference( c.z, d.z );
+
+		const Expansion det = adz * ( bdx * cdy - cdx * bdy ) 
+							+ bdz * ( cdx * ady - adx * cdy ) 
+							+ cdz * ( adx * bdy - bdx * ady );
+		return det.estimate();
+	}
+
+	/*
+	================
+	inSphereExact
+	================
+	*/
+	double inSphereExact( const RenderLib::Math::Point3< double >& a, 
+						  const RenderLib::Math::Point3< double >& b, 
+						  const RenderLib::Math::Point3< double >& c, 
+						  const RenderLib::Math::Point3< double >& d, 
+						  const RenderLib::Math::Point3< double >& e ) {
+		const Expansion aex = Expansion::difference( a.x, e.x );
+		const Expansion aey = Expansion::difference( a.y, e.y );
+		const Expansion aez = Expansion::difference( a.z, e.z );
+		const Expansion bex = Expansion::difference( b.x, e.x );
+		const Expansion bey = Expansion::difference( b.y, e.y );
+		const Expansion bez = Expansion::difference( b.z, e.z );
+		const Expansion cex = Expansion::difference( c.x, e.x );
+		const Expansion cey = Expansion::difference( c.y, e.y );
+		const Expansion cez = Expansion::difference( c.z, e.z );
+		const Expansion dex = Expansion::difference( d.x, e.x );
+		const Expansion dey = Expansion::difference( d.y, e.y );
+		const Expansion dez = Expansion::difference( d.z, e.z );
+
+		const Expansion ab = aex * bey - bex * aey;
+		const Expansion bc = bex * cey - cex * bey;
+		const Expansion cd = cex * dey - dex * cey;
+		const Expansion da = dex * aey - aex * dey;
+		const Expansion ac = aex * cey - cex * aey;
+		const Expansion bd = bex * dey - dex * bey;
+
+		const Expansion abc = aez * bc - bez * ac + cez * ab;
+		const Expansion bcd = bez * cd - cez * bd + dez * bc;
+		const Expansion cda = cez * da + dez * ac + aez * cd;
+		const Expansion dab = dez * ab + aez * bd + bez * da;
+
+		const Expansion aLift = aex * aex + aey * aey + aez * aez;
+		const Expansion bLift = bex * bex + bey * bey + bez * bez;
+		const Expansion cLift = cex * cex + cey * cey + cez * cez;
+		const Expansion dLift = dex * dex + dey * dey + dez * dez;
+
+		const Expansion det = ( dLift * abc - cLift * dab ) + ( bLift * cda - aLift * bcd );
+		return det.estimate();
+	}
+
+} // namespace internal
+
+/*
+================
+orient2D
+================
+*/
+double orient2D( const RenderLib::Math::Vector2< double >& a, 
+				 const RenderLib::Math::Vector2< double >& b, 
+				 const RenderLib::Math::Vector2< double >& c ) {
+	const double detLeft = ( a.x - c.x ) * ( b.y - c.y );
+	const double detRight = ( a.y - c.y ) * ( b.x - c.x );
+	const double det = detLeft - detRight;
+
+	// the subtraction can't lose the sign unless both terms share theirs
+	double permanent;
+	if ( detLeft > 0.0 ) {
+		if ( detRight <= 0.0 ) {
+			return det;
+		}
+		permanent = detLeft + detRight;
+	} else if ( detLeft < 0.0 ) {
+		if ( detRight >= 0.0 ) {
+			return det;
+		}
+		permanent = -detLeft - detRight;
+	} else {
+		return det;
+	}
+	const double errorBound = internal::orient2DErrorBound * permanent;
+	if ( det > errorBound || -det > errorBound ) {
+		return det;
+	}
+	return internal::orient2DExact( a, b, c );
+}
+
+/*
+================
+inCircle2D
+================
+*/
+double inCircle2D( const RenderLib::Math::Vector2< double >& a, 
+				   const RenderLib::Math::Vector2< double >& b, 
+				   const RenderLib::Math::Vector2< double >& c, 
+				   const RenderLib::Math::Vector2< double >& d ) {
+	const double adx = a.x - d.x;
+	const double bdx = b.x - d.x;
+	const double cdx = c.x - d.x;
+	const double ady = a.y - d.y;
+	const double bdy = b.y - d.y;
+	const double cdy = c.y - d.y;
+
+	const double bdxcdy = bdx * cdy;
+	const double cdxbdy = cdx * bdy;
+	const double aLift = adx * adx + ady * ady;
+
+	const double cdxady = cdx * ady;
+	const double adxcdy = adx * cdy;
+	const double bLift = bdx * bdx + bdy * bdy;
+
+	const double adxbdy = adx * bdy;
+	const double bdxady = bdx * ady;
+	const double cLift = cdx * cdx + cdy * cdy;
+
+	const double det = aLift * ( bdxcdy - cdxbdy ) 
+					 + bLift * ( cdxady - adxcdy ) 
+					 + cLift * ( adxbdy - bdxady );
+
+	const double permanent = ( fabs( bdxcdy ) + fabs( cdxbdy ) ) * aLift 
+						   + ( fabs( cdxady ) + fabs( adxcdy ) ) * bLift 
+						   + ( fabs( adxbdy ) + fabs( bdxady ) ) * cLift;
+	const double errorBound = internal::inCircle2DErrorBound * permanent;
+	if ( det > errorBound || -det > errorBound ) {
+		return det;
+	}
+	if ( permanent == 0.0 ) {
+		// every product vanished without rounding, typically because d is one of 
+		// a, b, c, so the determinant is exactly zero
+		return 0.0;
+	}
+	return internal::inCircle2DExact( a, b, c, d );
+}
+
+/*
+================
+orient3D
+================
+*/
+double orient3D( const RenderLib::Math::Point3< double >& a, 
+				 const RenderLib::Math::Point3< double >& b, 
+				 const RenderLib::Math::Point3< double >& c, 
+				 const RenderLib::Math::Point3< double >& d ) {
+	const double adx = a.x - d.x;
+	const double bdx = b.x - d.x;
+	const double cdx = c.x - d.x;
+	const double ady = a.y - d.y;
+	const double bdy = b.y - d.y;
+	const double cdy = c.y - d.y;
+	const double adz = a.z - d.z;
+	const double bdz = b.z - d.z;
+	const double cdz = c.z - d.z;
+
+	const double bdxcdy = bdx * cdy;
+	const double cdxbdy = cdx * bdy;
+	const double cdxady = cdx * ady;
+	const double adxcdy = adx * cdy;
+	const double adxbdy = adx * bdy;
+	const double bdxady = bdx * ady;
+
+	const double det = adz * ( bdxcdy - cdxbdy ) 
+					 + bdz * ( cdxady - adxcdy ) 
+					 + cdz * ( adxbdy - bdxady );
+
+	const double permanent = ( fabs( bdxcdy ) + fabs( cdxbdy ) ) * fabs( adz ) 
+						   + ( fabs( cdxady ) + fabs( adxcdy ) ) * fabs( bdz ) 
+						   + ( fabs( adxbdy ) + fabs( bdxady ) ) * fabs( cdz );
+	const double errorBound = internal::orient3DErrorBound * permanent;
+	if ( det > errorBound || -det > errorBound ) {
+		return det;
+	}
+	return internal::orient3DExact( a, b, c, d );
+}
+
+/*
+================
+inSphere
+================
+*/
+double inSphere( const RenderLib::Math::Point3< double >& a, 
+				 const RenderLib::Math::Point3< double >& b, 
+				 const RenderLib::Math::Point3< double >& c, 
+				 const RenderLib::Math::Point3< double >& d, 
+				 const RenderLib::Math::Point3< double >& e ) {
+	const double aex = a.x - e.x;
+	const double bex = b.x - e.x;
+	const double cex = c.x - e.x;
+	const double dex = d.x - e.x;
+	const double aey = a.y - e.y;
+	const double bey = b.y - e.y;
+	const double cey = c.y - e.y;
+	const double dey = d.y - e.y;
+	const double aez = a.z - e.z;
+	const double bez = b.z - e.z;
+	const double cez = c.z - e.z;
+	const double dez = d.z - e.z;
+
+	const double aexbey = aex * bey;
+	const double bexaey = bex * aey;
+	const double ab = aexbey - bexaey;
+	const double bexcey = bex * cey;
+	const double cexbey = cex * bey;
+	const double bc = bexcey - cexbey;
+	const double cexdey = cex * dey;
+	const double dexcey = dex * cey;
+	const double cd = cexdey - dexcey;
+	const double dexaey = dex * aey;
+	const double aexdey = aex * dey;
+	const double da = dexaey - aexdey;
+	const double aexcey = aex * cey;
+	const double cexaey = cex * aey;
+	const double ac = aexcey - cexaey;
+	const double bexdey = bex * dey;
+	const double dexbey = dex * bey;
+	const double bd = bexdey - dexbey;
+
+	const double abc = aez * bc - bez * ac + cez * ab;
+	const double bcd = bez * cd - cez * bd + dez * bc;
+	const double cda = cez * da + dez * ac + aez * cd;
+	const double dab = dez * ab + aez * bd + bez * da;
+
+	const double aLift = aex * aex + aey * aey + aez * aez;
+	const double bLift = bex * bex + bey * bey + bez * bez;
+	const double cLift = cex * cex + cey * cey + cez * cez;
+	const double dLift = dex * dex + dey * dey + dez * dez;
+
+	const double det = ( dLift * abc - cLift * dab ) + ( bLift * cda - aLift * bcd );
+
+	const double aezPlus = fabs( aez );
+	const double bezPlus = fabs( bez );
+	const double cezPlus = fabs( cez );
+	const double dezPlus = fabs( dez );
+	const double aexbeyPlus = fabs( aexbey );
+	const double bexaeyPlus = fabs( bexaey );
+	const double bexceyPlus = fabs( bexcey );
+	const double cexbeyPlus = fabs( cexbey );
+	const double cexdeyPlus = fabs( cexdey );
+	const double dexceyPlus = fabs( dexcey );
+	const double dexaeyPlus = fabs( dexaey );
+	const double aexdeyPlus = fabs( aexdey );
+	const double aexceyPlus = fabs( aexcey );
+	const double cexaeyPlus = fabs( cexaey );
+	const double bexdeyPlus = fabs( bexdey );
+	const double dexbeyPlus = fabs( dexbey );
+	const double permanent = ( ( cexdeyPlus + dexceyPlus ) * bezPlus + ( dexbeyPlus + bexdeyPlus ) * cezPlus + ( bexceyPlus + cexbeyPlus ) * dezPlus ) * aLift 
+						   + ( ( dexaeyPlus + aexdeyPlus ) * cezPlus + ( aexceyPlus + cexaeyPlus ) * dezPlus + ( cexdeyPlus + dexceyPlus ) * aezPlus ) * bLift 
+						   + ( ( aexbeyPlus + bexaeyPlus ) * dezPlus + ( bexdeyPlus + dexbeyPlus ) * aezPlus + ( dexaeyPlus + aexdeyPlus ) * bezPlus ) * cLift 
+						   + ( ( bexceyPlus + cexbeyPlus ) * aezPlus + ( cexaeyPlus + aexceyPlus ) * bezPlus + ( aexbeyPlus + bexaeyPlus ) * cezPlus ) * dLift;
+	const double errorBound = internal::inSphereErrorBound * permanent;
+	if ( det > errorBound || -det > errorBound ) {
+		return det;
+	}
+	return internal::inSphereExact( a, b, c, d, e );
+}
+
+} // namespace Geometry
+} // namespace RenderLib
@@ -24,7 +24,14 @@
 #include <geometry/intersection/intersection.h>
 #include <geometry/bounds/bounds2D.h>
 #include <geometry/utils.h>
+#include <geometry/predicates/predicates.h>
+#include <parallel/parallelFor.h>
+#include <cfloat>
 #include <climits>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
 #define DEBUG_STEPS 0
 
 namespace RenderLib {
@@ -35,7 +42,88 @@ namespace internal {
 	const float POINT_ON_SEGMENT_DISTANCE_EPSILON	= 1e-4f;
 	const float POINT_ON_SEGMENT_PARAMETRIC_EPSILON = 1e-5f;
 	const float INSIDE_CIRCUMCIRCLE_EPSILON			= 1e-2f;
-	const float COINCIDENT_POINTS_DISTANCE_EPSILON	= 1e-1f;
+
+	// inserted points per cell of the grid seeding the point location walks
+	const size_t WALK_GRID_POINTS_PER_CELL			= 4;
+
+	// Coarse grids over the points to insert, each with 4 times fewer cells than the 
+	// one before, holding per cell the last triangle created there. Point location 
+	// starts walking from the triangle of the point's cell in the finest grid where it 
+	// has one, which is close to it, rather than from the last one created, which can 
+	// be anywhere when the points come in no particular order. While the finest cells 
+	// are still mostly empty, the coarser ones keep the walks short.
+	class walkGrid_t {
+	public:
+		walkGrid_t( const LIST( RenderLib::Math::Vector2f )& vertices ) {
+			RenderLib::Geometry::Bounds2D bounds;
+			for( size_t i = 0; i < vertices.size(); i++ ) {
+				bounds.expand( vertices[ (unsigned int)i ] );
+			}
+			origin = bounds.min();
+			const RenderLib::Math::Vector2f extents = bounds.extents();
+			const float numCells = (float)std::max( (size_t)1, vertices.size() / WALK_GRID_POINTS_PER_CELL );
+			const float area = std::max( extents.x, FLT_MIN ) * std::max( extents.y, FLT_MIN );
+			invCellSize = 1.0f / std::max( sqrtf( area / numCells ), FLT_MIN );
+			resolution[ 0 ] = std::max( 1, std::min( 1 << 12, (int)ceilf( extents.x * invCellSize ) ) );
+			resolution[ 1 ] = std::max( 1, std::min( 1 << 12, (int)ceilf( extents.y * invCellSize ) ) );
+			int levelResolution[ 2 ] = { resolution[ 0 ], resolution[ 1 ] };
+			for( ;; ) {
+				level_t& level = levels.append();
+				level.resolution = levelResolution[ 0 ];
+				level.cells.resize( levelResolution[ 0 ] * levelResolution[ 1 ] );
+				for( size_t i = 0; i < level.cells.size(); i++ ) {
+					level.cells[ (unsigned int)i ] = -1;
+				}
+				if ( levelResolution[ 0 ] == 1 && levelResolution[ 1 ] == 1 ) {
+					break;
+				}
+				levelResolution[ 0 ] = ( levelResolution[ 0 ] + 1 ) / 2;
+				levelResolution[ 1 ] = ( levelResolution[ 1 ] + 1 ) / 2;
+			}
+		}
+
+		// the triangle to start walking towards p from, or -1 if there's none yet
+		int find( const RenderLib::Math::Vector2f& p, const LIST( AdjacencyInfo::Triangle_t )& triangles ) const {
+			int cx, cy;
+			cell( p, cx, cy );
+			for( size_t i = 0; i < levels.size(); i++ ) {
+				const level_t& level = levels[ (unsigned int)i ];
+				const int t = level.cells[ ( cx >> i ) + ( cy >> i ) * level.resolution ];
+				if ( t >= 0 && triangles[ t ].valid ) {
+					return t;
+				}
+			}
+			return -1;
+		}
+
+		void set( const RenderLib::Math::Vector2f& p, const int triangle ) {
+			int cx, cy;
+			cell( p, cx, cy );
+			for( size_t i = 0; i < levels.size(); i++ ) {
+				level_t& level = levels[ (unsigned int)i ];
+				level.cells[ ( cx >> i ) + ( cy >> i ) * level.resolution ] = triangle;
+			}
+		}
+
+	private:
+		struct level_t {
+			LIST( int )	cells;
+			int			resolution;	// along x
+		};
+
+		// coordinates of the cell of p in the finest grid
+		void cell( const RenderLib::Math::Vector2f& p, int& cx, int& cy ) const {
+			const float x = ( p.x - origin.x ) * invCellSize;
+			const float y = ( p.y - origin.y ) * invCellSize;
+			cx = x <= 0 ? 0 : std::min( (int)x, resolution[ 0 ] - 1 );
+			cy = y <= 0 ? 0 : std::min( (int)y, resolution[ 1 ] - 1 );
+		}
+
+		LIST( level_t )				levels;	// finest first
+		RenderLib::Math::Point2f	origin;
+		float						invCellSize;
+		int							resolution[ 2 ];
+	};
 	
 	void delaunay2DRemoveSuperTriangle( AdjacencyInfo* adjacency, 
 										int stIdx1, 
@@ -70,38 +158,43 @@ namespace internal {
 			}
 		}
 
-		for( int i = 0; i < (int)adjacency->triangles.size(); i++ ) {
-			if ( !adjacency->triangles[ i ].valid ) {
-				const int remappedTriangle = (int)adjacency->triangles.size() - 1;
-				adjacency->triangles.removeIndexFast( i );
-
-				// remap edges pointing to this triangle
-				for( size_t e = 0; e < adjacency->edges.size(); e++ ) {
-					AdjacencyInfo::Edge_t& edge = adjacency->edges[ (unsigned int)e ];
-					if ( edge.triangles[ 0 ] == remappedTriangle ) {
-						edge.triangles[ 0 ] = i;
-					}
-					if ( edge.triangles[ 1 ] == remappedTriangle ) {
-						edge.triangles[ 1 ] = i;
-					}
-				}
-
-				i--;
-			} else {
-				AdjacencyInfo::Triangle_t& t = adjacency->triangles[ i ];
-				t.vertices[ 0 ] -= 3;
-				t.vertices[ 1 ] -= 3;
-				t.vertices[ 2 ] -= 3;
+		// compact the triangles left, in a single pass, and remap the edges pointing to them
+		LIST( int ) remap;
+		remap.resize( adjacency->triangles.size(), false );
+		unsigned int numTriangles = 0;
+		for( size_t i = 0; i < adjacency->triangles.size(); i++ ) {
+			if ( !adjacency->triangles[ (unsigned int)i ].valid ) {
+				remap[ (unsigned int)i ] = -1;
+				continue;
 			}
+			remap[ (unsigned int)i ] = (int)numTriangles;
+			AdjacencyInfo::Triangle_t& t = adjacency->triangles[ numTriangles++ ];
+			t = adjacency->triangles[ (unsigned int)i ];
+			t.vertices[ 0 ] -= 3;
+			t.vertices[ 1 ] -= 3;
+			t.vertices[ 2 ] -= 3;
 		}
+		adjacency->triangles.resize( numTriangles, false );
+
 		adjacency->vertices.resize( vertices.size(), false );
 		for( size_t i = 0; i < vertices.size(); i++ ) {
 			adjacency->vertices[ (unsigned int)i ] = vertices[ (unsigned int)i ];
 		}
 		for( size_t i = 0; i < adjacency->edges.size(); i++ ) {
-			adjacency->edges[ (unsigned int)i ].vertices[ 0 ] -= 3;
-			adjacency->edges[ (unsigned int)i ].vertices[ 1 ] -= 3;
+			AdjacencyInfo::Edge_t& edge = adjacency->edges[ (unsigned int)i ];
+			if ( edge.vertices[ 0 ] < 0 ) {
+				continue; // free
+			}
+			edge.vertices[ 0 ] -= 3;
+			edge.vertices[ 1 ] -= 3;
+			for( int j = 0; j < 2; j++ ) {
+				if ( edge.triangles[ j ] >= 0 ) {
+					assert( remap[ edge.triangles[ j ] ] >= 0 );
+					edge.triangles[ j ] = remap[ edge.triangles[ j ] ];
+				}
+			}
 		}
+		adjacency->rebuildEdgeTable();
 	}
 
 	void delaunay2DCreateSuperTriangle( const LIST( RenderLib::Math::Vector2f )& vertices, 
@@ -139,7 +232,223 @@ namespace internal {
 			adjacency->createTriangle( stIdx1, stIdx2, stIdx3 );
 	}
 
+	// below this number of points, the coincident points search is not split any further among threads
+	const size_t COINCIDENT_POINTS_GRAIN_SIZE		= 4096;
+
+	inline long long coincidentCell( const float x, const double cellSize ) {
+		return (long long)floor( (double)x / cellSize );
+	}
+
+	inline unsigned int coincidentBucket( const long long cx, const long long cy, const unsigned int mask ) {
+		const unsigned long long h = ( (unsigned long long)cx * 0x9E3779B97F4A7C15ull ) ^ ( (unsigned long long)cy * 0xC2B2AE3D27D4EB4Full );
+		return (unsigned int)( h >> 32 ) & mask;
+	}
+
+	/*
+	================
+	Delaunay2D::FindCoincidentPoints
+
+	For each vertex, the earlier vertex it's merged into for lying within 
+	tolerance times the extent of the bounding box from it, or itself if 
+	there's none. A tolerance of 0 merges exact duplicates only. The vertices 
+	are bucketed by hashing the cell of the grid they fall in, no smaller than 
+	the merging distance, so that the candidates of each vertex are those in 
+	the buckets of its cell and the 8 around it. Finding the candidates, the 
+	bulk of the work, runs in parallel if asked to; resolving them is 
+	sequential, as a vertex merged into another one can't have others merged 
+	into it.
+	================
+	*/
+	void delaunay2DFindCoincidentPoints( const LIST( RenderLib::Math::Vector2f )& vertices, const float tolerance, const bool parallel, LIST( int )& mergedInto ) {
+		using namespace RenderLib::Math;
+
+		const size_t numVertices = vertices.size();
+		mergedInto.resize( numVertices, false );
+		if ( numVertices == 0 ) {
+			return;
+		}
+
+		RenderLib::Geometry::Bounds2D bounds;
+		for( size_t i = 0; i < numVertices; i++ ) {
+			bounds.expand( vertices[ (unsigned int)i ] );
+		}
+		const Vector2f extents = bounds.extents();
+		const float extent = std::max( extents.x, extents.y );
+		const float distance = std::max( tolerance, 0.0f ) * extent;
+		// about one vertex per cell when the distance is smaller than that
+		double cellSize = std::max( (double)distance, (double)extent / sqrt( (double)numVertices ) );
+		if ( cellSize <= 0 ) {
+			cellSize = 1.0; // all the vertices are the same
+		}
+
+		// vertex indices sorted by bucket, in increasing order within each
+		unsigned int numBuckets = 1024;
+		while( numBuckets < 2 * numVertices ) {
+			numBuckets *= 2;
+		}
+		const unsigned int mask = numBuckets - 1;
+		LIST( unsigned int ) bucketStart;
+		bucketStart.resize( numBuckets + 1, false );
+		for( size_t i = 0; i <= numBuckets; i++ ) {
+			bucketStart[ (unsigned int)i ] = 0;
+		}
+		LIST( unsigned int ) buckets;
+		buckets.resize( numVertices, false );
+		for( size_t i = 0; i < numVertices; i++ ) {
+			const Vector2f& v = vertices[ (unsigned int)i ];
+			buckets[ (unsigned int)i ] = coincidentBucket( coincidentCell( v.x, cellSize ), coincidentCell( v.y, cellSize ), mask );
+			bucketStart[ buckets[ (unsigned int)i ] + 1 ]++;
+		}
+		for( size_t i = 0; i < numBuckets; i++ ) {
+			bucketStart[ (unsigned int)i + 1 ] += bucketStart[ (unsigned int)i ];
+		}
+		LIST( int ) sorted;
+		sorted.resize( numVertices, false );
+		{
+			LIST( unsigned int ) next;
+			next.resize( numBuckets, false );
+			for( size_t i = 0; i < numBuckets; i++ ) {
+				next[ (unsigned int)i ] = bucketStart[ (unsigned int)i ];
+			}
+			for( size_t i = 0; i < numVertices; i++ ) {
+				sorted[ next[ buckets[ (unsigned int)i ] ]++ ] = (int)i;
+			}
+		}
+
+		// the closest earlier candidate of each vertex, if any
+		LIST( int ) candidates;
+		candidates.resize( numVertices, false );
+		auto findCandidates = [ & ]( size_t begin, size_t end ) {
+			for( size_t i = begin; i < end; i++ ) {
+				const Vector2f& v = vertices[ (unsigned int)i ];
+				const long long cx = coincidentCell( v.x, cellSize );
+				const long long cy = coincidentCell( v.y, cellSize );
+				int closest = -1;
+				float closestDistance = distance;
+				for( int dy = -1; dy <= 1; dy++ ) {
+					for( int dx = -1; dx <= 1; dx++ ) {
+						const unsigned int bucket = coincidentBucket( cx + dx, cy + dy, mask );
+						for( unsigned int j = bucketStart[ bucket ]; j < bucketStart[ bucket + 1 ] && sorted[ j ] < (int)i; j++ ) {
+							const float distance = ( v - vertices[ sorted[ j ] ] ).length();
+							if ( distance <= closestDistance ) {
+								closest = sorted[ j ];
+								closestDistance = distance;
+							}
+						}
+					}
+				}
+				candidates[ (unsigned int)i ] = closest;
+			}
+		};
+		if ( parallel ) {
+			RenderLib::Parallel::parallelFor( 0, numVertices, COINCIDENT_POINTS_GRAIN_SIZE, findCandidates );
+		} else {
+			findCandidates( 0, numVertices );
+		}
+
+		for( size_t i = 0; i < numVertices; i++ ) {
+			int merged = (int)i;
+			const int candidate = candidates[ (unsigned int)i ];
+			if ( candidate >= 0 && mergedInto[ candidate ] == candidate ) {
+				merged = candidate;
+			} else if ( candidate >= 0 ) {
+				// the closest one was merged itself: look for any other surviving one
+				const Vector2f& v = vertices[ (unsigned int)i ];
+				const long long cx = coincidentCell( v.x, cellSize );
+				const long long cy = coincidentCell( v.y, cellSize );
+				for( int dy = -1; dy <= 1 && merged == (int)i; dy++ ) {
+					for( int dx = -1; dx <= 1 && merged == (int)i; dx++ ) {
+						const unsigned int bucket = coincidentBucket( cx + dx, cy + dy, mask );
+						for( unsigned int j = bucketStart[ bucket ]; j < bucketStart[ bucket + 1 ] && sorted[ j ] < (int)i; j++ ) {
+							const int other = sorted[ j ];
+							if ( mergedInto[ other ] == other && ( v - vertices[ other ] ).length() <= distance ) {
+								merged = other;
+								break;
+							}
+						}
+					}
+				}
+			}
+			mergedInto[ (unsigned int)i ] = merged;
+		}
+	}
+
+	typedef LIST( int ) vertexList_t;
+
+	inline bool vertexListContains( const vertexList_t& list, const int v ) {
+		for( size_t i = 0; i < list.size(); i++ ) {
+			if ( list[ (unsigned int)i ] == v ) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/*
+	================
+	delaunay2DLegalize
+
+	Flips the edges of the triangles in toCheck, and of those the flips create, 
+	until they all meet the Delaunay condition. Edges listed in constraintEnds 
+	(per vertex, the other end of its constrained edges) are never flipped. 
+	The triangles visited are appended to touched.
+	================
+	*/
+	void delaunay2DLegalize( AdjacencyInfo* adjacency, 
+							 LIST( int )& toCheck, 
+							 const LIST( vertexList_t )* constraintEnds = NULL, 
+							 LIST( int )* touched = NULL ) {
+		while( !toCheck.empty() ) {
+			int tri = toCheck[ (unsigned int)toCheck.size() - 1 ];
+			toCheck.resize( toCheck.size() - 1 , false );
+
+			AdjacencyInfo::Triangle_t& triangle = adjacency->triangles[ tri ];
+			if ( !triangle.valid ) {
+				continue;
+			}
+			if ( touched != NULL ) {
+				touched->append( tri );
+			}
+
+			// check delaunay condition
+			for( int e = 0; e < 3; e++ ) {
+				int globalEdgeIndex = abs( triangle.edges[ e ] ) - 1;
+				if ( constraintEnds != NULL ) {
+					const AdjacencyInfo::Edge_t& edge = adjacency->edges[ globalEdgeIndex ];
+					if ( vertexListContains( (*constraintEnds)[ edge.vertices[ 0 ] ], edge.vertices[ 1 ] ) ) {
+						continue;
+					}
+				}
+				int adjacentIdx = adjacency->adjacentTriangle( tri, e );
+				if ( adjacentIdx < 0 ) {
+					continue;
+				}
+				const AdjacencyInfo::Triangle_t& adjacent = adjacency->triangles[ adjacentIdx ];
+				if ( !adjacent.valid ) {
+					continue;
+				}
+				assert( adjacent.valid );
+				int edgeFromAdjacent = adjacent.localEdgeIndex( globalEdgeIndex );
+				assert( edgeFromAdjacent >= 0 );
+				const int v = adjacency->vertexOutOfTriEdge( adjacentIdx, edgeFromAdjacent );
+				assert( v >= 0 );
+				assert( !triangle.contains( v ) );
+
+				if ( triangle.insideCircumcircle( adjacency->vertices[ v ], adjacency->vertices ) > 0 ) {
+					int result[2];
+					if ( adjacency->flipTriangles( tri, adjacentIdx, result ) ) {
+						toCheck.addUnique( result[0] );
+						toCheck.addUnique( result[1] );
+						break;
+					}
+				}
+			}
+		}
+	}
+
 	bool delaunay2DInsertPoints( const LIST( RenderLib::Math::Vector2f )& vertices, 
+								 const bool parallel,
+								 const float coincidentTolerance,
 								 AdjacencyInfo* adjacency ) {
 
 		using namespace RenderLib::Math;
@@ -148,24 +457,27 @@ namespace internal {
 
 		LIST( int ) toCheck;		
 
+		delaunay2DFindCoincidentPoints( vertices, coincidentTolerance, parallel, adjacency->mergedVertices );
+		walkGrid_t walkGrid( vertices );
+		int lastTriangle = -1;
+
 		for( size_t i = 0; i < vertices.size(); i++ ) {
 
 			// Insert Vi
 			const Vector2f& Vi = vertices[ (unsigned int)i ];
 
-			bool skip = false;
-			for( size_t j = 0; j < adjacency->vertices.size(); j++ ) {
-				if ( ( Vi - adjacency->vertices[ (unsigned int)j ] ).length() <= Delaunay::internal::COINCIDENT_POINTS_DISTANCE_EPSILON ){
-					// the point has already been inserted. Skip it
-					skip = true;
-					break;
-				}
-			}
-			if ( skip ) {
-				//continue;
+			if ( adjacency->mergedVertices[ (unsigned int)i ] != (int)i ) {
+				// the point has already been inserted. Skip it, keeping its index in 
+				// the vertex list so that the following ones keep theirs
+				adjacency->vertices.append( Vi );
+				continue;
 			}
 
-			int tri = adjacency->pointInTriangle( Vi );
+			int start = walkGrid.find( Vi, adjacency->triangles );
+			if ( start < 0 ) {
+				start = lastTriangle;
+			}
+			int tri = adjacency->pointInTriangle( Vi, start );
 
 			if ( tri < 0 ) {
 				assert( false );
@@ -191,48 +503,993 @@ namespace internal {
 					toCheck.addUnique( result[ j ] );
 				}
 			}
+			// a triangle around Vi, unless the flips below replace it; a destroyed 
+			// one is likely to be handed out again to a triangle nearby anyway
+			if ( !toCheck.empty() ) {
+				lastTriangle = toCheck[ 0 ];
+				walkGrid.set( Vi, lastTriangle );
+			}
+
+			delaunay2DLegalize( adjacency, toCheck );
+		}
+		return true;
+	}
 
-			while( !toCheck.empty() ) {
-				int tri = toCheck[ (unsigned int)toCheck.size() - 1 ];
-				toCheck.resize( toCheck.size() - 1 , false );
+	//////////////////////////////////////////////////////////////////////////
+	// Divide and conquer
+	//
+	// Guibas and Stolfi, "Primitives for the manipulation of general 
+	// subdivisions and the computation of Voronoi diagrams": the points, 
+	// sorted, are split in halves which are triangulated recursively and then 
+	// merged, rising from the lower common tangent of both halves. 
+	//////////////////////////////////////////////////////////////////////////
+
+	// below this number of points, the halves are not triangulated in parallel
+	const size_t DIVIDE_AND_CONQUER_PARALLEL_SIZE	= 1 << 14;
+
+	// Quad-edge: the 4 directed edges of an edge and of its dual, an edge 
+	// reference being quad index * 4 + rotation
+	struct quadEdge_t {
+		int next[ 4 ];		// onext of each rotation; for a free quad, next[ 0 ] links the free list
+		int org[ 4 ];		// origin vertex of rotations 0 and 2, -1 for a free quad
+	};
+
+	inline int rot( const int e ) { return ( e & ~3 ) | ( ( e + 1 ) & 3 ); }
+	inline int sym( const int e ) { return ( e & ~3 ) | ( ( e + 2 ) & 3 ); }
+	inline int rotInv( const int e ) { return ( e & ~3 ) | ( ( e + 3 ) & 3 ); }
+
+	// Quads are taken from the free list of the arena first, and from its range 
+	// [ next, end ) after. Since the live edges of the points of an arena form a 
+	// planar graph, 3 quads per point are enough.
+	struct quadArena_t {
+		int		next;
+		int		end;
+		int		freeHead;	// -1 if empty
+	};
+
+	class quadEdgeMesh_t {
+	public:
+		quadEdgeMesh_t( const LIST( RenderLib::Math::Vector2f )& vertices, const size_t numQuads ) : vertices( vertices ) {
+			quads.resize( numQuads, false );
+			for( size_t i = 0; i < numQuads; i++ ) {
+				quads[ (unsigned int)i ].org[ 0 ] = -1;
+			}
+		}
 
-				AdjacencyInfo::Triangle_t& triangle = adjacency->triangles[ tri ];
-				if ( !triangle.valid ) {
+		int onext( const int e ) const { return quads[ e >> 2 ].next[ e & 3 ]; }
+		int oprev( const int e ) const { return rot( onext( rot( e ) ) ); }
+		int lnext( const int e ) const { return rot( onext( rotInv( e ) ) ); }
+		int rprev( const int e ) const { return onext( sym( e ) ); }
+		int org( const int e ) const { return quads[ e >> 2 ].org[ e & 3 ]; }
+		int dest( const int e ) const { return org( sym( e ) ); }
+		bool isFree( const int quad ) const { return quads[ quad ].org[ 0 ] < 0; }
+		size_t numQuads() const { return quads.size(); }
+
+		int makeEdge( quadArena_t& arena, const int a, const int b ) {
+			int q;
+			if ( arena.freeHead >= 0 ) {
+				q = arena.freeHead;
+				arena.freeHead = quads[ q ].next[ 0 ];
+			} else {
+				assert( arena.next < arena.end );
+				q = arena.next++;
+			}
+			quadEdge_t& quad = quads[ q ];
+			const int e = q << 2;
+			quad.next[ 0 ] = e;
+			quad.next[ 1 ] = e + 3;
+			quad.next[ 2 ] = e + 2;
+			quad.next[ 3 ] = e + 1;
+			quad.org[ 0 ] = a;
+			quad.org[ 2 ] = b;
+			quad.org[ 1 ] = quad.org[ 3 ] = -1;
+			return e;
+		}
+
+		void splice( const int a, const int b ) {
+			const int alpha = rot( onext( a ) );
+			const int beta = rot( onext( b ) );
+			std::swap( quads[ a >> 2 ].next[ a & 3 ], quads[ b >> 2 ].next[ b & 3 ] );
+			std::swap( quads[ alpha >> 2 ].next[ alpha & 3 ], quads[ beta >> 2 ].next[ beta & 3 ] );
+		}
+
+		// new edge from the destination of a to the origin of b, leaving the faces on the left of a and b joined
+		int connect( quadArena_t& arena, const int a, const int b ) {
+			const int e = makeEdge( arena, dest( a ), org( b ) );
+			splice( e, lnext( a ) );
+			splice( sym( e ), b );
+			return e;
+		}
+
+		void deleteEdge( quadArena_t& arena, const int e ) {
+			splice( e, oprev( e ) );
+			splice( sym( e ), oprev( sym( e ) ) );
+			freeQuad( arena, e >> 2 );
+		}
+
+		void freeQuad( quadArena_t& arena, const int q ) {
+			quads[ q ].org[ 0 ] = quads[ q ].org[ 2 ] = -1;
+			quads[ q ].next[ 0 ] = arena.freeHead;
+			arena.freeHead = q;
+		}
+
+		int nextFree( const int q ) const { return quads[ q ].next[ 0 ]; }
+
+		// whether a, b, c are strictly counterclockwise
+		bool ccw( const int a, const int b, const int c ) const {
+			return orient2D( vertices[ a ], vertices[ b ], vertices[ c ] ) > 0;
+		}
+
+		bool rightOf( const int v, const int e ) const { return ccw( v, dest( e ), org( e ) ); }
+		bool leftOf( const int v, const int e ) const { return ccw( v, org( e ), dest( e ) ); }
+
+		// whether d is strictly inside the circle through a, b, c, given counterclockwise
+		bool inCircle( const int a, const int b, const int c, const int d ) const {
+			return inCircle2D( vertices[ a ], vertices[ b ], vertices[ c ], vertices[ d ] ) > 0;
+		}
+
+	private:
+		const LIST( RenderLib::Math::Vector2f )&	vertices;
+		LIST( quadEdge_t )							quads;
+	};
+
+	/*
+	================
+	Delaunay2D::DivideAndConquer_r
+
+	Triangulates the sorted points [ begin, end ), returning the counterclockwise 
+	convex hull edge out of the leftmost point and the clockwise one out of the 
+	rightmost point. Above DIVIDE_AND_CONQUER_PARALLEL_SIZE points and up to 
+	parallelDepth levels, both halves are triangulated concurrently, each from 
+	its own part of the arena range; the free quads of both are then gathered 
+	for the merge.
+	================
+	*/
+	void delaunay2DDivideAndConquer_r( quadEdgeMesh_t& mesh, const LIST( int )& sorted, const size_t begin, const size_t end, 
+									   quadArena_t& arena, const int parallelDepth, int& leftOut, int& rightOut ) {
+		const size_t numPoints = end - begin;
+		assert( numPoints >= 2 );
+		if ( numPoints == 2 ) {
+			const int a = mesh.makeEdge( arena, sorted[ (unsigned int)begin ], sorted[ (unsigned int)begin + 1 ] );
+			leftOut = a;
+			rightOut = sym( a );
+			return;
+		}
+		if ( numPoints == 3 ) {
+			const int s0 = sorted[ (unsigned int)begin ], s1 = sorted[ (unsigned int)begin + 1 ], s2 = sorted[ (unsigned int)begin + 2 ];
+			const int a = mesh.makeEdge( arena, s0, s1 );
+			const int b = mesh.makeEdge( arena, s1, s2 );
+			mesh.splice( sym( a ), b );
+			if ( mesh.ccw( s0, s1, s2 ) ) {
+				mesh.connect( arena, b, a );
+				leftOut = a;
+				rightOut = sym( b );
+			} else if ( mesh.ccw( s0, s2, s1 ) ) {
+				const int c = mesh.connect( arena, b, a );
+				leftOut = sym( c );
+				rightOut = c;
+			} else {
+				// collinear
+				leftOut = a;
+				rightOut = sym( b );
+			}
+			return;
+		}
+
+		const size_t middle = begin + numPoints / 2;
+		int ldo, ldi, rdi, rdo;
+		if ( parallelDepth > 0 && numPoints >= DIVIDE_AND_CONQUER_PARALLEL_SIZE ) {
+			quadArena_t arenas[ 2 ];
+			arenas[ 0 ].next = arena.next;
+			arenas[ 0 ].end = arenas[ 1 ].next = arena.next + 3 * (int)( middle - begin );
+			arenas[ 1 ].end = arena.end;
+			arenas[ 0 ].freeHead = arenas[ 1 ].freeHead = -1;
+			RenderLib::Parallel::parallelFor( 0, 2, 1, [ & ]( size_t first, size_t last ) {
+				for( size_t half = first; half < last; half++ ) {
+					if ( half == 0 ) {
+						delaunay2DDivideAndConquer_r( mesh, sorted, begin, middle, arenas[ 0 ], parallelDepth - 1, ldo, ldi );
+					} else {
+						delaunay2DDivideAndConquer_r( mesh, sorted, middle, end, arenas[ 1 ], parallelDepth - 1, rdi, rdo );
+					}
+				}
+			} );
+			// go on from the range left in the second half, and free the rest
+			arena.next = arenas[ 1 ].next;
+			arena.end = arenas[ 1 ].end;
+			for( int q = arenas[ 0 ].next; q < arenas[ 0 ].end; q++ ) {
+				mesh.freeQuad( arena, q );
+			}
+			for( int i = 0; i < 2; i++ ) {
+				while( arenas[ i ].freeHead >= 0 ) {
+					const int q = arenas[ i ].freeHead;
+					arenas[ i ].freeHead = mesh.nextFree( q );
+					mesh.freeQuad( arena, q );
+				}
+			}
+		} else {
+			delaunay2DDivideAndConquer_r( mesh, sorted, begin, middle, arena, 0, ldo, ldi );
+			delaunay2DDivideAndConquer_r( mesh, sorted, middle, end, arena, 0, rdi, rdo );
+		}
+
+		// lower common tangent of both halves
+		for( ;; ) {
+			if ( mesh.leftOf( mesh.org( rdi ), ldi ) ) {
+				ldi = mesh.lnext( ldi );
+			} else if ( mesh.rightOf( mesh.org( ldi ), rdi ) ) {
+				rdi = mesh.rprev( rdi );
+			} else {
+				break;
+			}
+		}
+
+		int basel = mesh.connect( arena, sym( rdi ), ldi );
+		if ( mesh.org( ldi ) == mesh.org( ldo ) ) {
+			ldo = sym( basel );
+		}
+		if ( mesh.org( rdi ) == mesh.org( rdo ) ) {
+			rdo = basel;
+		}
+
+		// rise, connecting each time to the candidate of either side whose 
+		// circle through the base edge holds no other candidate
+		for( ;; ) {
+			int lcand = mesh.onext( sym( basel ) );
+			const bool validL = mesh.rightOf( mesh.dest( lcand ), basel );
+			if ( validL ) {
+				while( mesh.inCircle( mesh.dest( basel ), mesh.org( basel ), mesh.dest( lcand ), mesh.dest( mesh.onext( lcand ) ) ) ) {
+					const int t = mesh.onext( lcand );
+					mesh.deleteEdge( arena, lcand );
+					lcand = t;
+				}
+			}
+			int rcand = mesh.oprev( basel );
+			const bool validR = mesh.rightOf( mesh.dest( rcand ), basel );
+			if ( validR ) {
+				while( mesh.inCircle( mesh.dest( basel ), mesh.org( basel ), mesh.dest( rcand ), mesh.dest( mesh.oprev( rcand ) ) ) ) {
+					const int t = mesh.oprev( rcand );
+					mesh.deleteEdge( arena, rcand );
+					rcand = t;
+				}
+			}
+			if ( !validL && !validR ) {
+				break;
+			}
+			if ( !validL || ( validR && mesh.inCircle( mesh.dest( lcand ), mesh.org( lcand ), mesh.org( rcand ), mesh.dest( rcand ) ) ) ) {
+				basel = mesh.connect( arena, rcand, sym( basel ) );
+			} else {
+				basel = mesh.connect( arena, sym( basel ), sym( lcand ) );
+			}
+		}
+
+		leftOut = ldo;
+		rightOut = rdo;
+	}
+
+	/*
+	================
+	Delaunay2D::DivideAndConquer
+
+	Triangulates the vertices not merged into others, and builds the adjacency 
+	from the resulting triangles, in the same layout as the incremental path.
+	================
+	*/
+	bool delaunay2DDivideAndConquer( const LIST( RenderLib::Math::Vector2f )& vertices, 
+									 AdjacencyInfo* adjacency, 
+									 LIST( int )* outTriangles, 
+									 const bool parallel,
+									 const float coincidentTolerance ) {
+		using namespace RenderLib::Math;
+
+		delaunay2DFindCoincidentPoints( vertices, coincidentTolerance, parallel, adjacency->mergedVertices );
+
+		LIST( int ) sorted;
+		sorted.setGranularity( vertices.size() );
+		for( size_t i = 0; i < vertices.size(); i++ ) {
+			if ( adjacency->mergedVertices[ (unsigned int)i ] == (int)i ) {
+				sorted.append( (int)i );
+			}
+		}
+		std::sort( &sorted[ 0 ], &sorted[ 0 ] + sorted.size(), [ &vertices ]( const int a, const int b ) {
+			const Vector2f& pa = vertices[ a ];
+			const Vector2f& pb = vertices[ b ];
+			return pa.x < pb.x || ( pa.x == pb.x && pa.y < pb.y );
+		} );
+
+		adjacency->vertices.resize( vertices.size(), false );
+		for( size_t i = 0; i < vertices.size(); i++ ) {
+			adjacency->vertices[ (unsigned int)i ] = vertices[ (unsigned int)i ];
+		}
+		if ( sorted.size() < 2 ) {
+			return true;
+		}
+
+		adjacency->preAllocate( vertices.size() );
+		quadEdgeMesh_t mesh( vertices, 3 * sorted.size() );
+		quadArena_t arena;
+		arena.next = 0;
+		arena.end = 3 * (int)sorted.size();
+		arena.freeHead = -1;
+		int parallelDepth = 0;
+		if ( parallel ) {
+			// a few more tasks than threads, to balance them
+			while( ( 1u << parallelDepth ) < 2 * RenderLib::Parallel::numThreads() ) {
+				parallelDepth++;
+			}
+		}
+		int leftOut, rightOut;
+		delaunay2DDivideAndConquer_r( mesh, sorted, 0, sorted.size(), arena, parallelDepth, leftOut, rightOut );
+
+		// Each triangle is the face on the left of the 3 edges around it. Walking 
+		// the faces left of every directed edge finds them all, along with the 
+		// outer face, which is clockwise.
+		LIST( bool ) visited;
+		visited.resize( 2 * mesh.numQuads(), false );
+		for( size_t i = 0; i < visited.size(); i++ ) {
+			visited[ (unsigned int)i ] = false;
+		}
+		for( size_t q = 0; q < mesh.numQuads(); q++ ) {
+			if ( mesh.isFree( (int)q ) ) {
+				continue;
+			}
+			for( int r = 0; r < 4; r += 2 ) {
+				const int e0 = (int)q * 4 + r;
+				if ( visited[ e0 >> 1 ] ) {
 					continue;
 				}
+				const int e1 = mesh.lnext( e0 );
+				const int e2 = mesh.lnext( e1 );
+				visited[ e0 >> 1 ] = true;
+				if ( mesh.lnext( e2 ) != e0 || !mesh.ccw( mesh.org( e0 ), mesh.org( e1 ), mesh.org( e2 ) ) ) {
+					continue;
+				}
+				visited[ e1 >> 1 ] = visited[ e2 >> 1 ] = true;
+				adjacency->createTriangle( mesh.org( e0 ), mesh.org( e1 ), mesh.org( e2 ) );
+				if ( outTriangles != NULL ) {
+					outTriangles->append( mesh.org( e0 ) );
+					outTriangles->append( mesh.org( e1 ) );
+					outTriangles->append( mesh.org( e2 ) );
+				}
+			}
+		}
+		return true;
+	}
 
-				// check delaunay condition
-				for( int e = 0; e < 3; e++ ) {
-					int adjacentIdx = adjacency->adjacentTriangle( tri, e );
-					if ( adjacentIdx < 0 ) {
-						continue;
-					}
-					int globalEdgeIndex = abs( triangle.edges[ e ] ) - 1;
-					const AdjacencyInfo::Triangle_t& adjacent = adjacency->triangles[ adjacentIdx ];
-					if ( !adjacent.valid ) {
-						continue;
-					}
-					assert( adjacent.valid );
-					int edgeFromAdjacent = adjacent.localEdgeIndex( globalEdgeIndex );
-					assert( edgeFromAdjacent >= 0 );
-					const int v = adjacency->vertexOutOfTriEdge( adjacentIdx, edgeFromAdjacent );
-					assert( v >= 0 );
-					assert( !triangle.contains( v ) );
-
-					if ( triangle.insideCircumcircle( adjacency->vertices[ v ], adjacency->vertices ) > Delaunay::internal::INSIDE_CIRCUMCIRCLE_EPSILON ) {
-						int result[2];
-						if ( adjacency->flipTriangles( tri, adjacentIdx, result ) ) {
-							toCheck.addUnique( result[0] );
-							toCheck.addUnique( result[1] );
-							break;
-						}
-					}
+	//////////////////////////////////////////////////////////////////////////
+	// Delaunay refinement
+	//
+	// Ruppert, "A Delaunay refinement algorithm for quality 2-dimensional mesh 
+	// generation": segments holding a vertex in their diametral circle are 
+	// split, and poor quality triangles get their circumcenter inserted, unless 
+	// it would encroach upon a segment, which is then split instead. Segments 
+	// with a single input endpoint are split at a power of two distance from 
+	// it (concentric shells), so that small input angles don't cascade.
+	// The segments are the constraint edges and the border of the triangulation.
+	// Edges on the border get new indices when the triangles along them are 
+	// replaced, so the constraints are kept per vertex rather than per edge.
+	//////////////////////////////////////////////////////////////////////////
+
+	const float MIN_REFINEMENT_RELATIVE_LENGTH = FLT_EPSILON * 256.0f;
+
+	struct badTriangle_t {
+		float						ratio;			// circumradius to shortest edge, the priority
+		int							triangle;
+		int							vertices[ 3 ];	// to tell whether the triangle index was reused
+		RenderLib::Math::Vector2f	circumcenter;
+
+		bool operator<( const badTriangle_t& other ) const { return ratio < other.ratio; }
+	};
+
+	class delaunayRefinement_t {
+	public:
+		delaunayRefinement_t( AdjacencyInfo& adjacency, const float minAngleDegrees, const float maxArea ) : 
+			adjacency( adjacency ), 
+			maxArea( maxArea ), 
+			numInputVertices( (int)adjacency.vertices.size() ), 
+			stamp( 0 ) {
+			const double minAngle = minAngleDegrees * RenderLib::Math::PI / 180.0;
+			maxRatio = minAngle > 0 ? 0.5 / sin( std::min( minAngle, RenderLib::Math::PI / 3 ) ) : DBL_MAX;
+		}
+
+		void init( const LIST( int )& constraints );
+		bool run( const unsigned int maxSteinerPoints );
+		unsigned int countUnresolved() const;
+		void getConstraints( LIST( int )& constraints ) const;
+
+	private:
+		bool isConstraint( const int v0, const int v1 ) const;
+		bool isSegment( const int edge ) const;
+		bool isEncroached( const int edge ) const;
+		static bool tooSmall( const RenderLib::Math::Vector2f& a, const RenderLib::Math::Vector2f& b, const float length );
+		bool isBad( const int t, badTriangle_t& bad, bool& refinable ) const;
+		void checkTriangle( const int t );
+		void checkTouched();
+		int newVertex();
+		bool splitSegment( const int edge );
+		unsigned int insertCircumcenter( const badTriangle_t& bad );
+
+		AdjacencyInfo&			adjacency;
+		double					maxRatio;
+		const double			maxArea;
+		const int				numInputVertices;
+
+		LIST( vertexList_t )	constraintEnds;	// per vertex, the other ends of the constraints on it
+		LIST( badTriangle_t )	queue;			// heap of bad triangles, worst first
+		LIST( int )				encroached;		// endpoint pairs of the segments to split
+		LIST( int )				toCheck;
+		LIST( int )				touched;
+		LIST( int )				cavity;
+		LIST( int )				cavityStamp;	// per triangle, the last cavity search visiting it
+		int						stamp;
+	};
+
+	/*
+	================
+	delaunayRefinement_t::init
+	================
+	*/
+	void delaunayRefinement_t::init( const LIST( int )& constraints ) {
+		constraintEnds.resize( numInputVertices );
+		for( unsigned int i = 0; i + 1 < (unsigned int)constraints.size(); i += 2 ) {
+			int v0 = constraints[ i ];
+			int v1 = constraints[ i + 1 ];
+			if ( v0 < 0 || v1 < 0 || v0 >= numInputVertices || v1 >= numInputVertices ) {
+				continue;
+			}
+			if ( (int)adjacency.mergedVertices.size() == numInputVertices ) {
+				v0 = adjacency.mergedVertices[ v0 ];
+				v1 = adjacency.mergedVertices[ v1 ];
+			}
+			// constraints missing from the triangulation are left out
+			if ( v0 != v1 && adjacency.findEdge( v0, v1 ) >= 0 && !isConstraint( v0, v1 ) ) {
+				constraintEnds[ v0 ].append( v1 );
+				constraintEnds[ v1 ].append( v0 );
+			}
+		}
+		for( size_t i = 0; i < adjacency.edges.size(); i++ ) {
+			if ( adjacency.edges[ (unsigned int)i ].vertices[ 0 ] >= 0 && isSegment( (int)i ) && isEncroached( (int)i ) ) {
+				encroached.append( adjacency.edges[ (unsigned int)i ].vertices[ 0 ] );
+				encroached.append( adjacency.edges[ (unsigned int)i ].vertices[ 1 ] );
+			}
+		}
+		for( size_t i = 0; i < adjacency.triangles.size(); i++ ) {
+			if ( adjacency.triangles[ (unsigned int)i ].valid ) {
+				checkTriangle( (int)i );
+			}
+		}
+	}
+
+	/*
+	================
+	delaunayRefinement_t::run
+
+	Returns false if it had to stop after maxSteinerPoints
+	================
+	*/
+	bool delaunayRefinement_t::run( const unsigned int maxSteinerPoints ) {
+		unsigned int inserted = 0;
+		while( inserted < maxSteinerPoints ) {
+			// encroached segments come first, circumcenters can only be inserted 
+			// safely inside the domain once there are none
+			if ( !encroached.empty() ) {
+				const int v1 = encroached[ (unsigned int)encroached.size() - 1 ];
+				const int v0 = encroached[ (unsigned int)encroached.size() - 2 ];
+				encroached.resize( encroached.size() - 2, false );
+				const int edge = adjacency.findEdge( v0, v1 );
+				if ( edge >= 0 && isSegment( edge ) && isEncroached( edge ) && splitSegment( edge ) ) {
+					inserted++;
+				}
+				continue;
+			}
+
+			if ( queue.empty() ) {
+				return true;
+			}
+			std::pop_heap( &queue[ 0 ], &queue[ 0 ] + queue.size() );
+			const badTriangle_t bad = queue[ (unsigned int)queue.size() - 1 ];
+			queue.resize( queue.size() - 1, false );
+
+			const AdjacencyInfo::Triangle_t& triangle = adjacency.triangles[ bad.triangle ];
+			if ( !triangle.valid || 
+				 triangle.vertices[ 0 ] != bad.vertices[ 0 ] || 
+				 triangle.vertices[ 1 ] != bad.vertices[ 1 ] || 
+				 triangle.vertices[ 2 ] != bad.vertices[ 2 ] ) {
+				continue; // destroyed since it was queued
+			}
+			inserted += insertCircumcenter( bad );
+		}
+		return false;
+	}
+
+	/*
+	================
+	delaunayRefinement_t::getConstraints
+	================
+	*/
+	void delaunayRefinement_t::getConstraints( LIST( int )& constraints ) const {
+		constraints.resize( 0, false );
+		for( size_t i = 0; i < constraintEnds.size(); i++ ) {
+			const vertexList_t& ends = constraintEnds[ (unsigned int)i ];
+			for( size_t j = 0; j < ends.size(); j++ ) {
+				if ( (int)i < ends[ (unsigned int)j ] ) {
+					constraints.append( (int)i );
+					constraints.append( ends[ (unsigned int)j ] );
 				}
 			}
 		}
+	}
+
+	/*
+	================
+	delaunayRefinement_t::isConstraint
+	================
+	*/
+	bool delaunayRefinement_t::isConstraint( const int v0, const int v1 ) const {
+		return vertexListContains( constraintEnds[ v0 ], v1 );
+	}
+
+	/*
+	================
+	delaunayRefinement_t::isSegment
+	================
+	*/
+	bool delaunayRefinement_t::isSegment( const int edge ) const {
+		const AdjacencyInfo::Edge_t& e = adjacency.edges[ edge ];
+		return e.triangles[ 0 ] < 0 || e.triangles[ 1 ] < 0 || isConstraint( e.vertices[ 0 ], e.vertices[ 1 ] );
+	}
+
+	/*
+	================
+	delaunayRefinement_t::isEncroached
+
+	Whether the apex of a triangle on either side lies inside the diametral circle. 
+	Any vertex inside it would make one of them lie inside too.
+	================
+	*/
+	bool delaunayRefinement_t::isEncroached( const int edge ) const {
+		const AdjacencyInfo::Edge_t& e = adjacency.edges[ edge ];
+		const RenderLib::Math::Vector2f& A = adjacency.vertices[ e.vertices[ 0 ] ];
+		const RenderLib::Math::Vector2f& B = adjacency.vertices[ e.vertices[ 1 ] ];
+		for( int side = 0; side < 2; side++ ) {
+			const int t = e.triangles[ side ];
+			if ( t < 0 ) {
+				continue;
+			}
+			const AdjacencyInfo::Triangle_t& triangle = adjacency.triangles[ t ];
+			const int apex = adjacency.vertexOutOfTriEdge( t, triangle.localEdgeIndex( edge ) );
+			const RenderLib::Math::Vector2f& P = adjacency.vertices[ apex ];
+			if ( ( (double)A.x - P.x ) * ( (double)B.x - P.x ) + ( (double)A.y - P.y ) * ( (double)B.y - P.y ) < 0 ) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/*
+	================
+	delaunayRefinement_t::tooSmall
+
+	Whether splitting any further would bring vertices within a few floating point 
+	steps of each other, where new vertices can't be placed where they belong
+	================
+	*/
+	bool delaunayRefinement_t::tooSmall( const RenderLib::Math::Vector2f& a, const RenderLib::Math::Vector2f& b, const float length ) {
+		const float magnitude = std::max( std::max( fabsf( a.x ), fabsf( a.y ) ), std::max( fabsf( b.x ), fabsf( b.y ) ) );
+		return length <= magnitude * MIN_REFINEMENT_RELATIVE_LENGTH;
+	}
+
+	/*
+	================
+	delaunayRefinement_t::isBad
+
+	Whether the triangle has an angle below the minimum, or an area above the maximum. 
+	refinable tells whether its circumcenter, given in bad, may be inserted: flat 
+	triangles and those with an edge too small to split any further are left as they are
+	================
+	*/
+	bool delaunayRefinement_t::isBad( const int t, badTriangle_t& bad, bool& refinable ) const {
+		const AdjacencyInfo::Triangle_t& triangle = adjacency.triangles[ t ];
+		const RenderLib::Math::Vector2f& A = adjacency.vertices[ triangle.vertices[ 0 ] ];
+		const RenderLib::Math::Vector2f& B = adjacency.vertices[ triangle.vertices[ 1 ] ];
+		const RenderLib::Math::Vector2f& C = adjacency.vertices[ triangle.vertices[ 2 ] ];
+
+		const double bx = (double)B.x - A.x, by = (double)B.y - A.y;
+		const double cx = (double)C.x - A.x, cy = (double)C.y - A.y;
+		const double ab2 = bx * bx + by * by;
+		const double ac2 = cx * cx + cy * cy;
+		const double bc2 = ( cx - bx ) * ( cx - bx ) + ( cy - by ) * ( cy - by );
+		const double d = 2.0 * ( bx * cy - by * cx ); // 4 times the area
+		if ( d <= 0 ) {
+			refinable = false;
+			return maxRatio < DBL_MAX;
+		}
+		const double shortest2 = std::min( ab2, std::min( ac2, bc2 ) );
+		const double ux = ( cy * ab2 - by * ac2 ) / d;
+		const double uy = ( bx * ac2 - cx * ab2 ) / d;
+		const double ratio = sqrt( ( ux * ux + uy * uy ) / shortest2 );
+		if ( ratio <= maxRatio && ( maxArea <= 0 || d * 0.25 <= maxArea ) ) {
+			return false;
+		}
+
+		refinable = !tooSmall( A, B, (float)sqrt( shortest2 ) );
+		bad.ratio = (float)ratio;
+		bad.triangle = t;
+		bad.vertices[ 0 ] = triangle.vertices[ 0 ];
+		bad.vertices[ 1 ] = triangle.vertices[ 1 ];
+		bad.vertices[ 2 ] = triangle.vertices[ 2 ];
+		bad.circumcenter = RenderLib::Math::Vector2f( (float)( A.x + ux ), (float)( A.y + uy ) );
 		return true;
 	}
 
+	/*
+	================
+	delaunayRefinement_t::checkTriangle
+	================
+	*/
+	void delaunayRefinement_t::checkTriangle( const int t ) {
+		badTriangle_t bad;
+		bool refinable;
+		if ( !isBad( t, bad, refinable ) || !refinable ) {
+			return;
+		}
+		badTriangle_t& queued = queue.append();
+		queued = bad;
+		std::push_heap( &queue[ 0 ], &queue[ 0 ] + queue.size() );
+	}
+
+	/*
+	================
+	delaunayRefinement_t::countUnresolved
+
+	Bad triangles may be left once the queue is empty: those that can't be refined, 
+	and those dropped when their circumcenter couldn't be inserted nor the segments it 
+	encroaches split
+	================
+	*/
+	unsigned int delaunayRefinement_t::countUnresolved() const {
+		unsigned int count = 0;
+		for( size_t i = 0; i < adjacency.triangles.size(); i++ ) {
+			badTriangle_t bad;
+			bool refinable;
+			if ( adjacency.triangles[ (unsigned int)i ].valid && isBad( (int)i, bad, refinable ) ) {
+				count++;
+			}
+		}
+		return count;
+	}
+
+	/*
+	================
+	delaunayRefinement_t::checkTouched
+
+	Queues the triangles changed by the last insertion, and the segments on them its vertex encroaches
+	================
+	*/
+	void delaunayRefinement_t::checkTouched() {
+		for( size_t i = 0; i < touched.size(); i++ ) {
+			const int t = touched[ (unsigned int)i ];
+			const AdjacencyInfo::Triangle_t& triangle = adjacency.triangles[ t ];
+			if ( !triangle.valid ) {
+				continue;
+			}
+			checkTriangle( t );
+			for( int e = 0; e < 3; e++ ) {
+				const int edge = abs( triangle.edges[ e ] ) - 1;
+				if ( isSegment( edge ) && isEncroached( edge ) ) {
+					encroached.append( adjacency.edges[ edge ].vertices[ 0 ] );
+					encroached.append( adjacency.edges[ edge ].vertices[ 1 ] );
+				}
+			}
+		}
+		touched.resize( 0, false );
+	}
+
+	/*
+	================
+	delaunayRefinement_t::newVertex
+
+	Keeps the per vertex lists in sync with the vertex about to be added
+	================
+	*/
+	int delaunayRefinement_t::newVertex() {
+		const int v = (int)adjacency.vertices.size();
+		adjacency.mergedVertices.append( v );
+		if ( !adjacency.vertexTriangleAdjacencyInfo.empty() ) {
+			adjacency.vertexTriangleAdjacencyInfo.append();
+		}
+		constraintEnds.append();
+		return v;
+	}
+
+	/*
+	================
+	delaunayRefinement_t::splitSegment
+	================
+	*/
+	bool delaunayRefinement_t::splitSegment( const int edge ) {
+		using namespace RenderLib::Math;
+
+		const AdjacencyInfo::Edge_t& e = adjacency.edges[ edge ];
+		const int a = e.vertices[ 0 ];
+		const int b = e.vertices[ 1 ];
+		const Vector2f& A = adjacency.vertices[ a ];
+		const Vector2f& B = adjacency.vertices[ b ];
+		const float length = ( B - A ).length();
+		if ( tooSmall( A, B, length ) ) {
+			return false;
+		}
+
+		float t = 0.5f;
+		const bool aInput = a < numInputVertices;
+		const bool bInput = b < numInputVertices;
+		if ( aInput != bInput ) {
+			// split at the power of two closest to the middle, measured from the input vertex
+			const float split = powf( 2.0f, floorf( logf( length * 0.5f ) / logf( 2.0f ) + 0.5f ) );
+			t = std::max( 0.25f, std::min( 0.75f, split / length ) );
+			if ( bInput ) {
+				t = 1.0f - t;
+			}
+		}
+
+		// the split point is rounded, make sure it still splits the triangles 
+		// on either side into correctly oriented ones
+		Vector2f p;
+		bool valid = false;
+		for( int attempt = 0; attempt < 2 && !valid; attempt++ ) {
+			if ( attempt > 0 ) {
+				t = 0.5f;
+			}
+			p = A + ( B - A ) * t;
+			valid = true;
+			for( int side = 0; side < 2 && valid; side++ ) {
+				const int tri = e.triangles[ side ];
+				if ( tri < 0 ) {
+					continue;
+				}
+				const Vector2f& apex = adjacency.vertices[ adjacency.vertexOutOfTriEdge( tri, adjacency.triangles[ tri ].localEdgeIndex( edge ) ) ];
+				const Vector2f& from = side == 0 ? A : B;
+				const Vector2f& to = side == 0 ? B : A;
+				valid = RenderLib::Geometry::orient2D( apex, from, p ) > 0 && RenderLib::Geometry::orient2D( to, apex, p ) > 0;
+			}
+		}
+		if ( !valid ) {
+			return false;
+		}
+
+		const int v = newVertex();
+		if ( isConstraint( a, b ) ) {
+			constraintEnds[ a ].removeFast( b );
+			constraintEnds[ b ].removeFast( a );
+			constraintEnds[ a ].append( v );
+			constraintEnds[ b ].append( v );
+			constraintEnds[ v ].append( a );
+			constraintEnds[ v ].append( b );
+		}
+		int result[ 4 ];
+		adjacency.splitEdge( edge, p, result );
+		assert( v == (int)adjacency.vertices.size() - 1 );
+
+		for( int i = 0; i < 4; i++ ) {
+			if ( result[ i ] >= 0 ) {
+				toCheck.addUnique( result[ i ] );
+			}
+		}
+		delaunay2DLegalize( &adjacency, toCheck, &constraintEnds, &touched );
+		checkTouched();
+		return true;
+	}
+
+	/*
+	================
+	delaunayRefinement_t::insertCircumcenter
+
+	Returns the number of vertices inserted
+	================
+	*/
+	unsigned int delaunayRefinement_t::insertCircumcenter( const badTriangle_t& bad ) {
+		const RenderLib::Math::Vector2f& c = bad.circumcenter;
+
+		// the segments c would encroach upon lie on the border of the region 
+		// of triangles whose circumcircle holds it, which its insertion replaces. 
+		// It is grown from the bad triangle, which also catches a c lying past 
+		// the border of the triangulation
+		if ( cavityStamp.size() < adjacency.triangles.size() ) {
+			const size_t size = cavityStamp.size();
+			cavityStamp.resize( adjacency.triangles.size(), false );
+			for( size_t i = size; i < cavityStamp.size(); i++ ) {
+				cavityStamp[ (unsigned int)i ] = 0;
+			}
+		}
+		stamp++;
+		cavity.resize( 0, false );
+		cavity.append( bad.triangle );
+		cavityStamp[ bad.triangle ] = stamp;
+		const size_t numEncroached = encroached.size();
+		for( size_t i = 0; i < cavity.size(); i++ ) {
+			const int t = cavity[ (unsigned int)i ];
+			const AdjacencyInfo::Triangle_t& triangle = adjacency.triangles[ t ];
+			for( int e = 0; e < 3; e++ ) {
+				const int edge = abs( triangle.edges[ e ] ) - 1;
+				if ( isSegment( edge ) ) {
+					const RenderLib::Math::Vector2f& A = adjacency.vertices[ adjacency.edges[ edge ].vertices[ 0 ] ];
+					const RenderLib::Math::Vector2f& B = adjacency.vertices[ adjacency.edges[ edge ].vertices[ 1 ] ];
+					if ( ( (double)A.x - c.x ) * ( (double)B.x - c.x ) + ( (double)A.y - c.y ) * ( (double)B.y - c.y ) < 0 ) {
+						encroached.append( adjacency.edges[ edge ].vertices[ 0 ] );
+						encroached.append( adjacency.edges[ edge ].vertices[ 1 ] );
+					}
+					continue;
+				}
+				const int adjacent = adjacency.adjacentTriangle( t, e );
+				if ( cavityStamp[ adjacent ] == stamp ) {
+					continue;
+				}
+				const AdjacencyInfo::Triangle_t& other = adjacency.triangles[ adjacent ];
+				if ( inCircle2D( adjacency.vertices[ other.vertices[ 0 ] ], adjacency.vertices[ other.vertices[ 1 ] ], adjacency.vertices[ other.vertices[ 2 ] ], c ) > 0 ) {
+					cavityStamp[ adjacent ] = stamp;
+					cavity.append( adjacent );
+				}
+			}
+		}
+
+		if ( encroached.size() > numEncroached ) {
+			// split them rather than inserting c, and give the triangle another chance if 
+			// it survives. Segments that can't be split are dropped to ensure progress
+			unsigned int splits = 0;
+			while( encroached.size() > numEncroached ) {
+				const int v1 = encroached[ (unsigned int)encroached.size() - 1 ];
+				const int v0 = encroached[ (unsigned int)encroached.size() - 2 ];
+				encroached.resize( encroached.size() - 2, false );
+				const int edge = adjacency.findEdge( v0, v1 );
+				if ( edge >= 0 && isSegment( edge ) && splitSegment( edge ) ) {
+					splits++;
+				}
+			}
+			if ( splits > 0 ) {
+				badTriangle_t& requeued = queue.append();
+				requeued = bad;
+				std::push_heap( &queue[ 0 ], &queue[ 0 ] + queue.size() );
+			}
+			return splits;
+		}
+
+		// with no segment in the way, c lies inside the region
+		int tri = -1;
+		for( size_t i = 0; i < cavity.size() && tri < 0; i++ ) {
+			if ( adjacency.containsPoint( adjacency.triangles[ cavity[ (unsigned int)i ] ], c ) ) {
+				tri = cavity[ (unsigned int)i ];
+			}
+		}
+		if ( tri < 0 ) {
+			return 0;
+		}
+		for( int i = 0; i < 3; i++ ) {
+			const RenderLib::Math::Vector2f& v = adjacency.vertices[ adjacency.triangles[ tri ].vertices[ i ] ];
+			if ( v.x == c.x && v.y == c.y ) {
+				return 0; // rounded onto a vertex
+			}
+		}
+
+		newVertex();
+		const int edge = adjacency.pointInTriangleEdge( c, tri );
+		if ( edge >= 0 ) {
+			assert( !isSegment( edge ) );
+			int result[ 4 ];
+			adjacency.splitEdge( edge, c, result );
+			for( int i = 0; i < 4; i++ ) {
+				if ( result[ i ] >= 0 ) {
+					toCheck.addUnique( result[ i ] );
+				}
+			}
+		} else {
+			int result[ 3 ];
+			adjacency.splitTriangle( tri, c, result );
+			for( int i = 0; i < 3; i++ ) {
+				toCheck.addUnique( result[ i ] );
+			}
+		}
+		delaunay2DLegalize( &adjacency, toCheck, &constraintEnds, &touched );
+		checkTouched();
+		return 1;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Batch triangulation
+	//////////////////////////////////////////////////////////////////////////
+
+	// below this number of inputs, the batch is not split any further among threads
+	const size_t BATCH_GRAIN_SIZE = 32;
+
+	// Scratch state a thread triangulates its inputs in, cleared from one input to the
+	// next rather than reallocated. There are as many as threads, or a single one unless 
+	// DELAUNAY_2D_CONCURRENT_LISTS is set, and a chunk of inputs takes over whichever is 
+	// free when it starts.
+	struct batchWorkspace_t {
+		AdjacencyInfo				adjacency;
+		LIST( RenderLib::Math::Vector2f ) vertices;
+		LIST( int )					edges;
+		LIST( bool )				outside;
+	};
+
+	class batchWorkspacePool_t {
+	public:
+		explicit batchWorkspacePool_t( const unsigned int count ) : workspaces( count ) {
+			for( unsigned int i = 0; i < count; i++ ) {
+				available.push_back( count - 1 - i );
+			}
+		}
+
+		batchWorkspace_t& acquire() {
+			std::lock_guard< std::mutex > lock( mutex );
+			assert( !available.empty() );
+			const unsigned int index = available.back();
+			available.pop_back();
+			return workspaces[ index ];
+		}
+
+		void release( batchWorkspace_t& workspace ) {
+			std::lock_guard< std::mutex > lock( mutex );
+			available.push_back( (unsigned int)( &workspace - &workspaces[ 0 ] ) );
+		}
+
+	private:
+		std::vector< batchWorkspace_t >	workspaces;
+		std::vector< unsigned int >		available;
+		std::mutex						mutex;
+	};
+
+	/*
+	================
+	Delaunay2D::TriangulateBatchItem
+
+	Constrained triangulation of the input [ vertexBegin, vertexEnd ), whose edges
+	[ edgeBegin, edgeEnd ) index its vertices from 0, within the given workspace.
+	Appends the triangles to outTriangles as indices into the whole vertex list,
+	and returns how many indices were appended, or -1 on failure. Constraints 
+	left out don't discard the triangulation, but clear recovered.
+	================
+	*/
+	int delaunay2DTriangulateBatchItem( const LIST( RenderLib::Math::Vector2f )& vertices,
+										const int vertexBegin, const int vertexEnd,
+										const LIST( int )& edges,
+										const int edgeBegin, const int edgeEnd,
+										const bool removeOutside,
+										batchWorkspace_t& workspace,
+										LIST( int )& outTriangles,
+										bool& recovered ) {
+		assert( vertexBegin <= vertexEnd && edgeBegin <= edgeEnd );
+		workspace.adjacency.clear();
+		workspace.vertices.resize( vertexEnd - vertexBegin, false );
+		for( int i = vertexBegin; i < vertexEnd; i++ ) {
+			workspace.vertices[ (unsigned int)( i - vertexBegin ) ] = vertices[ (unsigned int)i ];
+		}
+		workspace.edges.resize( edgeEnd - edgeBegin, false );
+		for( int i = edgeBegin; i < edgeEnd; i++ ) {
+			workspace.edges[ (unsigned int)( i - edgeBegin ) ] = edges[ (unsigned int)i ];
+		}
+
+		// once delaunay2D succeeded, constrainedDelaunay2D only fails listing the constraints left out
+		recovered = constrainedDelaunay2D( workspace.vertices, workspace.edges, NULL, &workspace.adjacency );
+		if ( !recovered && workspace.adjacency.unrecoveredEdges.empty() ) {
+			return -1;
+		}
+
+		const AdjacencyInfo& adjacency = workspace.adjacency;
+		if ( removeOutside && !trianglesOutside( adjacency, workspace.edges, workspace.outside ) ) {
+			return -1;
+		}
+
+		const int start = (int)outTriangles.size();
+		for( size_t i = 0; i < adjacency.triangles.size(); i++ ) {
+			const AdjacencyInfo::Triangle_t& triangle = adjacency.triangles[ (unsigned int)i ];
+			if ( !triangle.valid || ( removeOutside && workspace.outside[ (unsigned int)i ] ) ) {
+				continue;
+			}
+			outTriangles.append( vertexBegin + triangle.vertices[ 0 ] );
+			outTriangles.append( vertexBegin + triangle.vertices[ 1 ] );
+			outTriangles.append( vertexBegin + triangle.vertices[ 2 ] );
+		}
+		return (int)outTriangles.size() - start;
+	}
+
 }
 
 	AdjacencyInfo::AdjacencyInfo()
@@ -242,6 +1499,32 @@ namespace internal {
 		edges.setGranularity( 1024 );
 	}
 
+	void AdjacencyInfo::clear()
+	{
+		// sizes are reset but the storage is kept, for the next triangulation to reuse
+		edges.resize( 0, false );
+		triangles.resize( 0, false );
+		vertices.resize( 0, false );
+		invalidTriangles.resize( 0, false );
+		freeEdges.resize( 0, false );
+		mergedVertices.resize( 0, false );
+		unrecoveredEdges.resize( 0, false );
+		for( size_t i = 0; i < vertexTriangleAdjacencyInfo.size(); i++ ) {
+			vertexTriangleAdjacencyInfo[ (unsigned int)i ].resize( 0, false );
+		}
+		vertexTriangleAdjacencyInfo.resize( 0, false );
+		edgeTable.resize( 0, false );
+	}
+
+	void AdjacencyInfo::preAllocate( size_t numVertices )
+	{
+		// by Euler's formula, a triangulation of n points has at most 2n triangles and 3n edges
+		vertices.preAllocate( numVertices );
+		triangles.preAllocate( 2 * numVertices );
+		edges.preAllocate( 3 * numVertices );
+		rebuildEdgeTable( 3 * numVertices );
+	}
+
 	bool isTriOutside( RenderLib::Math::Vector2f centroid, 
 					   const float diagonal, 
 					   const LIST( int ) &edges, 
@@ -321,10 +1604,129 @@ namespace internal {
 			return nPositive >= nNegative;
 		}
 
+	bool trianglesOutside( const AdjacencyInfo& adjacency, 
+						   const LIST( int )& edges, 
+						   LIST( bool )& outside ) {
+
+		/* Flood fill across the triangle edges, from the triangles on the convex hull, which
+		were adjacent to the super triangle. Crossing a constraint edge flips the side, so 
+		a triangle is outside when the number of constraints separating it from the hull is 
+		even. This takes a single visit per triangle, but relies on every constraint being 
+		an edge of the triangulation and on the constraints enclosing regions consistently; 
+		when either fails, each triangle is classified casting rays through isTriOutside.
+		*/
+
+		using namespace RenderLib::Math;
+
+		const size_t numTriangles = adjacency.triangles.size();
+		if ( numTriangles == 0 ) {
+			return false;
+		}
+		outside.resize( numTriangles, false );
+
+		LIST( bool ) constraint;
+		constraint.resize( adjacency.edges.size(), false );
+		for( size_t i = 0; i < constraint.size(); i++ ) {
+			constraint[ (unsigned int)i ] = false;
+		}
+
+		bool consistent = true;
+		for( unsigned int i = 0; i + 1 < (unsigned int)edges.size() && consistent; i += 2 ) {
+			int v0 = edges[ i ];
+			int v1 = edges[ i + 1 ];
+			if ( v0 < 0 || v1 < 0 || v0 == v1 ) {
+				continue;
+			}
+			if ( (size_t)v0 < adjacency.mergedVertices.size() && (size_t)v1 < adjacency.mergedVertices.size() ) {
+				v0 = adjacency.mergedVertices[ v0 ];
+				v1 = adjacency.mergedVertices[ v1 ];
+				if ( v0 == v1 ) {
+					continue;
+				}
+			}
+			const int edgeIndex = adjacency.findEdge( v0, v1 );
+			if ( edgeIndex < 0 ) {
+				consistent = false; // not recovered in the triangulation
+			} else {
+				constraint[ edgeIndex ] = true;
+			}
+		}
+
+		// -1 unvisited, 0 outside, 1 inside
+		LIST( int ) side;
+		side.resize( numTriangles, false );
+		LIST( int ) queue;
+		queue.setGranularity( numTriangles );
+		for( size_t i = 0; i < numTriangles; i++ ) {
+			side[ (unsigned int)i ] = -1;
+			const AdjacencyInfo::Triangle_t& triangle = adjacency.triangles[ (unsigned int)i ];
+			if ( !triangle.valid ) {
+				continue;
+			}
+			for( int e = 0; e < 3; e++ ) {
+				if ( adjacency.adjacentTriangle( (int)i, e ) < 0 ) {
+					side[ (unsigned int)i ] = constraint[ abs( triangle.edges[ e ] ) - 1 ] ? 1 : 0;
+					queue.append( (int)i );
+					break;
+				}
+			}
+		}
+
+		for( size_t head = 0; head < queue.size() && consistent; head++ ) {
+			const int t = queue[ (unsigned int)head ];
+			const AdjacencyInfo::Triangle_t& triangle = adjacency.triangles[ t ];
+			for( int e = 0; e < 3; e++ ) {
+				const int adjacent = adjacency.adjacentTriangle( t, e );
+				if ( adjacent < 0 ) {
+					continue;
+				}
+				const int adjacentSide = constraint[ abs( triangle.edges[ e ] ) - 1 ] ? 1 - side[ t ] : side[ t ];
+				if ( side[ adjacent ] < 0 ) {
+					side[ adjacent ] = adjacentSide;
+					queue.append( adjacent );
+				} else if ( side[ adjacent ] != adjacentSide ) {
+					consistent = false; // open or crossing constraints
+					break;
+				}
+			}
+		}
+
+		if ( consistent ) {
+			for( size_t i = 0; i < numTriangles; i++ ) {
+				outside[ (unsigned int)i ] = side[ (unsigned int)i ] != 1;
+			}
+			return true;
+		}
+
+		// fall back to casting rays from the centroid of each triangle
+		RenderLib::Geometry::Bounds2D bounds;
+		for( size_t i = 0; i < adjacency.vertices.size(); i++ ) {
+			bounds.expand( adjacency.vertices[ (unsigned int)i ] );
+		}
+		const float diagonal = bounds.extents().length();
+		for( size_t i = 0; i < numTriangles; i++ ) {
+			const AdjacencyInfo::Triangle_t& triangle = adjacency.triangles[ (unsigned int)i ];
+			if ( !triangle.valid ) {
+				outside[ (unsigned int)i ] = true;
+				continue;
+			}
+			const Vector2f centroid = ( adjacency.vertices[ triangle.vertices[ 0 ] ] + 
+										adjacency.vertices[ triangle.vertices[ 1 ] ] + 
+										adjacency.vertices[ triangle.vertices[ 2 ] ] ) / 3.0f;
+			outside[ (unsigned int)i ] = isTriOutside( centroid, diagonal, edges, adjacency.vertices, (int)i );
+		}
+		return true;
+	}
+
 
 	
 
-	int AdjacencyInfo::createTriangle( unsigned int a, unsigned int b, unsigned int c )
+	int AdjacencyInfo::createTriangle( unsigned int a, unsigned int b, unsigned int c )
+	{
+		return createTriangle( a, b, c, NULL );
+	}
+
+	int AdjacencyInfo::createTriangle( unsigned int a, unsigned int b, unsigned int c, const int edgeHints[ 3 ] )
 	{
 		using namespace RenderLib::Math;
 		assert( a != b && a != c && b != c );
@@ -360,7 +1762,10 @@ namespace internal {
 
 
 		for( int i = 0; i < 3; i++ ) {
-			int e = findEdge( triangle.vertices[ i ], triangle.vertices[ (i + 1) % 3 ] );
+			int e = edgeHints != NULL ? edgeHints[ i ] : -1;
+			if ( e < 0 || !edges[ e ].Links( triangle.vertices[ i ], triangle.vertices[ ( i + 1 ) % 3 ] ) ) {
+				e = findEdge( triangle.vertices[ i ], triangle.vertices[ ( i + 1 ) % 3 ] );
+			}
 			if( e >= 0 ) {
 				AdjacencyInfo::Edge_t& edge = edges[ e ];
 				int edgeTriIdx = edge.vertices[ 0 ] == triangle.vertices[ i ] ? 0 : 1;
@@ -394,16 +1799,19 @@ namespace internal {
 				assert( edge.triangles[ 0 ] == (int)t );
 				edge.triangles[ 0 ] = -1;
 			}
-			/*if ( edge.triangles[ 0 ] < 0 && edge.triangles[ 1 ] < 0 ) {
-			// no longer used
-			// we should remove the edge, but if we do, we'll invalidate references to other edges
-			}*/
-
+			if ( edge.triangles[ 0 ] < 0 && edge.triangles[ 1 ] < 0 ) {
+				// no longer used: keep its index, so that the others don't change,
+				// and hand it out again to the next edge created
+				removeEdgeFromTable( abs( edgeIndex ) - 1 );
+				edge.vertices[ 0 ] = edge.vertices[ 1 ] = -1;
+				freeEdges.append( abs( edgeIndex ) - 1 );
+			}
 		}
 
-		for( size_t i = 0; i < vertexTriangleAdjacencyInfo.size(); i++ ) {
-			LIST( int )& adjacents = vertexTriangleAdjacencyInfo[ (unsigned int)i ];
-			adjacents.removeFast( (int)t );
+		if ( !vertexTriangleAdjacencyInfo.empty() ) {
+			for( int i = 0; i < 3; i++ ) {
+				vertexTriangleAdjacencyInfo[ triangle.vertices[ i ] ].removeFast( (int)t );
+			}
 		}
 
 		triangle.valid = false;
@@ -421,30 +1829,57 @@ namespace internal {
 				continue;
 			}
 
-			bool hit = false;
-
-			// use barycentric coordinates to determine whether the point is inside the triangle
-
-			// http://steve.hollasch.net/cgindex/math/barycentric.html
+			if ( containsPoint( t, p ) ) {
+				return (int)i;
+			}
+		}
+		return -1;
+	}
 
-			const Vector2f& v0 = vertices[ t.vertices[ 0 ] ];
-			const Vector2f& v1 = vertices[ t.vertices[ 1 ] ];
-			const Vector2f& v2 = vertices[ t.vertices[ 2 ] ];
+	int AdjacencyInfo::pointInTriangle( const RenderLib::Math::Vector2f& p, const int startTriangle ) const
+	{
+		using namespace RenderLib::Geometry;
 
-			const float b0 =  (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
-			if ( b0 != 0 ) {
-				const float b1 = ((v1.x - p.x) * (v2.y - p.y) - (v2.x - p.x) * (v1.y - p.y)) / b0; 
-				const float b2 = ((v2.x - p.x) * (v0.y - p.y) - (v0.x - p.x) * (v2.y - p.y)) / b0;
-				const float b3 = ((v0.x - p.x) * (v1.y - p.y) - (v1.x - p.x) * (v0.y - p.y)) / b0;
+		if ( startTriangle < 0 || startTriangle >= (int)triangles.size() || !triangles[ startTriangle ].valid ) {
+			return pointInTriangle( p );
+		}
 
-				hit = b1 >=0 && b2 >= 0 && b3 >=0;
+		// Visibility walk: cross any edge with p on its outer side until there's none.
+		// The edges are tested from a pseudo-random one on, so that the walk can't 
+		// cycle, which a fixed order could on a Delaunay triangulation under construction.
+		unsigned int seed = 0x9E3779B9u;
+		int current = startTriangle;
+		int previous = -1;
+		for( size_t steps = 0; steps < triangles.size(); steps++ ) {
+			const Triangle_t& t = triangles[ current ];
+			seed = seed * 1664525u + 1013904223u;
+			const int first = (int)( ( seed >> 16 ) % 3 );
+			int next = -1;
+			for( int i = 0; i < 3; i++ ) {
+				const int e = ( first + i ) % 3;
+				const int adjacent = adjacentTriangle( current, e );
+				if ( adjacent == previous && adjacent >= 0 ) {
+					continue; // p is on the inner side of the edge we came through
+				}
+				// the triangles are counterclockwise, so p is outside on the clockwise side of an edge
+				if ( adjacent >= 0 && orient2D( vertices[ t.vertices[ e ] ], vertices[ t.vertices[ ( e + 1 ) % 3 ] ], p ) < 0 ) {
+					next = adjacent;
+					break;
+				}
 			}
-
-			if ( hit ) {
-				return (int)i;
+			if ( next < 0 ) {
+				break;
 			}
+			previous = current;
+			current = next;
 		}
-		return -1;
+
+		// the walk stops early only if it reached the border of the triangulation, 
+		// in which case the exhaustive search takes over
+		if ( containsPoint( triangles[ current ], p ) ) {
+			return current;
+		}
+		return pointInTriangle( p );
 	}
 
 	int AdjacencyInfo::pointInTriangleEdge( const RenderLib::Math::Vector2f& p, const int t ) const
@@ -454,36 +1889,19 @@ namespace internal {
 		const Triangle_t& triangle = triangles[ t ];
 		assert( triangle.valid );
 
-		int closestEdge = -1;
-		float closestDistance = FLT_MAX;
+		// p is inside the triangle, so it lies on the segment iff it is exactly 
+		// on its line. Points merely close to it split the triangle instead, 
+		// into a thin but correctly oriented one
 		for( int i = 0; i < 3; i++ ) {
 			assert( triangle.edges[ i ] != INT_MAX );
-			int edgeIdx = abs( triangle.edges[ i ] ) - 1;
-			const Edge_t& edge = edges[ edgeIdx ];
-			float distance;
-			if ( pointOnSegment<float>( vertices[ edge.vertices[ 0 ] ],
-				vertices[ edge.vertices[ 1 ] ], 
-				p, 
-				Delaunay::internal::POINT_ON_SEGMENT_DISTANCE_EPSILON,
-				Delaunay::internal::POINT_ON_SEGMENT_PARAMETRIC_EPSILON, 
-				&distance ) ) {
-
-					if ( distance < closestDistance ) {
-						closestDistance = distance;
-						closestEdge =  edgeIdx;
-					}
+			if ( orient2D( vertices[ triangle.vertices[ i ] ], vertices[ triangle.vertices[ ( i + 1 ) % 3 ] ], p ) == 0 ) {
+				return abs( triangle.edges[ i ] ) - 1;
 			}
 		}
-
-		return closestEdge;
+		return -1;
 	}
 	void AdjacencyInfo::splitEdge( int edgeIndex, const RenderLib::Math::Vector2f& p, int result[ 4 ] ) {
 		Edge_t& edge = edges[ edgeIndex ];
-		assert( RenderLib::Geometry::pointOnSegment<float>( vertices[ edge.vertices[ 0 ] ],
-													vertices[ edge.vertices[ 1 ] ], 
-													p, 
-													Delaunay::internal::POINT_ON_SEGMENT_DISTANCE_EPSILON, 
-													Delaunay::internal::POINT_ON_SEGMENT_PARAMETRIC_EPSILON ) );
 
 		/*
 				   B = edge.v[0]	
@@ -521,7 +1939,7 @@ namespace internal {
 		const int D = triIdx2 >= 0 ? vertexOutOfTriEdge( triIdx2, tri2edge ) : -1;
 		assert( triIdx2 < 0 || D >= 0);
 
-		if ( A < 0 || D < 0 ) return;
+		if ( A < 0 && D < 0 ) return;
 
 		const int B = edge.vertices[ 0 ];
 		const int C = edge.vertices[ 1 ];
@@ -529,8 +1947,13 @@ namespace internal {
 		assert( B >= 0 && C >= 0 );
 		if ( B < 0 || C < 0 ) return;
 
-		assert( triangles[ triIdx1 ].contains( A, B, C ) );
-		assert( triangles[ triIdx2 ].contains( C, B, D ) );
+		assert( A < 0 || triangles[ triIdx1 ].contains( A, B, C ) );
+		assert( D < 0 || triangles[ triIdx2 ].contains( C, B, D ) );
+		// p has to be close enough to BC for the new triangles to keep their orientation
+		assert( A < 0 || ( RenderLib::Geometry::orient2D( vertices[ A ], vertices[ B ], p ) > 0 && 
+						   RenderLib::Geometry::orient2D( vertices[ C ], vertices[ A ], p ) > 0 ) );
+		assert( D < 0 || ( RenderLib::Geometry::orient2D( vertices[ D ], vertices[ C ], p ) > 0 && 
+						   RenderLib::Geometry::orient2D( vertices[ B ], vertices[ D ], p ) > 0 ) );
 		if ( triIdx1 >= 0 ) removeTriangle( triIdx1 );
 		if ( triIdx2 >= 0 ) removeTriangle( triIdx2 );
 		assert( edge.triangles[ 0 ] < 0 && edge.triangles[ 1 ] < 0 );
@@ -565,11 +1988,23 @@ namespace internal {
 		const int C = oldTri.vertices[ 2 ];
 		assert( A != B && A != C && A != newVertex && B != C && B != newVertex && C != newVertex );
 
+		// the edges of the old triangle, and those of the new ones already created, 
+		// spare looking them up
+		int hints[ 3 ] = { abs( oldTri.edges[ 0 ] ) - 1, -1, -1 };
+		const int BC = abs( oldTri.edges[ 1 ] ) - 1;
+		const int CA = abs( oldTri.edges[ 2 ] ) - 1;
 		removeTriangle( triIdx );
 
-		result[ 0 ] = createTriangle( A, B, newVertex );
-		result[ 1 ] = createTriangle( B, C, newVertex );
-		result[ 2 ] = createTriangle( C, A, newVertex );
+		result[ 0 ] = createTriangle( A, B, newVertex, hints );
+		const int BP = abs( triangles[ result[ 0 ] ].edges[ 1 ] ) - 1;
+		const int PA = abs( triangles[ result[ 0 ] ].edges[ 2 ] ) - 1;
+		hints[ 0 ] = BC;
+		hints[ 2 ] = BP;
+		result[ 1 ] = createTriangle( B, C, newVertex, hints );
+		hints[ 0 ] = CA;
+		hints[ 1 ] = PA;
+		hints[ 2 ] = abs( triangles[ result[ 1 ] ].edges[ 1 ] ) - 1;
+		result[ 2 ] = createTriangle( C, A, newVertex, hints );
 	}
 
 	int AdjacencyInfo::adjacentTriangle( int triIndex, int edgeIndex ) const
@@ -641,7 +2076,11 @@ namespace internal {
 
 		assert( A != B && A != C && A != D && B != C && B != D && C != D );
 
-		if ( !segmentIntersect( vertices[ A ], vertices[ D ], vertices[ B ], vertices[ C ] ) ) {
+		// A and D are on opposite sides of BC, the flip is only valid if B and C 
+		// are also strictly on opposite sides of AD, otherwise it would invert a triangle
+		const double sideB = orient2D( vertices[ A ], vertices[ D ], vertices[ B ] );
+		const double sideC = orient2D( vertices[ A ], vertices[ D ], vertices[ C ] );
+		if ( !( ( sideB > 0 && sideC < 0 ) || ( sideB < 0 && sideC > 0 ) ) ) {
 			// can't flip
 			return false;
 		}
@@ -656,11 +2095,18 @@ namespace internal {
 		//assert( triangles[ tri1 ].insideCircumcircle( vertices[ D ], vertices ) > Delaunay::internal::INSIDE_CIRCUMCIRCLE_EPSILON );
 		//assert( triangles[ tri2 ].insideCircumcircle( vertices[ A ], vertices ) > Delaunay::internal::INSIDE_CIRCUMCIRCLE_EPSILON);
 
+		// the outer edges are kept, and spare looking them up
+		int hints[ 3 ] = { edgeOf( triangle1, A, B ), edgeOf( triangle2, B, D ), -1 };
+		const int DC = edgeOf( triangle2, D, C );
+		const int CA = edgeOf( triangle1, C, A );
 		removeTriangle( tri1 );
 		removeTriangle( tri2 );
 
-		result[ 0 ] = createTriangle( A, B, D );
-		result[ 1 ] = createTriangle( A, D, C );
+		result[ 0 ] = createTriangle( A, B, D, hints );
+		hints[ 0 ] = abs( triangles[ result[ 0 ] ].edges[ 2 ] ) - 1;
+		hints[ 1 ] = DC;
+		hints[ 2 ] = CA;
+		result[ 1 ] = createTriangle( A, D, C, hints );
 
 #if _DEBUG && 0
 		FILE* fd = fopen("triFlip.txt", "wt");
@@ -762,304 +2208,233 @@ namespace internal {
 		return true;
 	}
 
-	unsigned int AdjacencyInfo::deleteTrianglesIntersectingSegment_r( const int vIdx0, const int vIdx1, LIST( int )& upperVertices, LIST( int )& lowerVertices )
+	void AdjacencyInfo::SegmentRecovery_t::addConstraint( const int v0, const int v1 )
 	{
-		using namespace RenderLib::Geometry;
-		using namespace RenderLib::Math;
-
-		if ( vIdx0 < 0 || vIdx1 < 0 || (size_t)vIdx0 >= vertices.size() || (size_t)vIdx1 >= vertices.size() ) {
-			return 0;
+		if ( !isConstraint( v0, v1 ) ) {
+			constraintEnds[ v0 ].append( v1 );
+			constraintEnds[ v1 ].append( v0 );
 		}
+	}
 
+	bool AdjacencyInfo::SegmentRecovery_t::isConstraint( const int v0, const int v1 ) const
+	{
+		const LIST( int )& ends = constraintEnds[ v0 ];
+		for( size_t i = 0; i < ends.size(); i++ ) {
+			if ( ends[ (unsigned int)i ] == v1 ) {
+				return true;
+			}
+		}
+		return false;
+	}
 
-		int tri = -1;
-		int triEdge = -1;
-		const Vector2f& v0 = vertices[ vIdx0 ];
-		const Vector2f& v1 = vertices[ vIdx1 ];
-		const triList_t& v0Adjacents = vertexTriangleAdjacencyInfo[ vIdx0 ];
-
-		// find the triangle containing v0
-		for( size_t t = 0; t < v0Adjacents.size(); t++ ) {
-			const Triangle_t& triangle = triangles[ v0Adjacents[ (unsigned int)t ] ];
-			assert( triangle.contains( vIdx0 ) );
-			for( int e = 0; e < 3; e++ ) {
-				const int edgeIdx = abs( triangle.edges[ e ] ) - 1;
-				Edge_t edge = edges[ edgeIdx ];
-				if ( edge.vertices[ 0 ] == vIdx0 || edge.vertices[ 1 ] == vIdx0 ) {
-
-					if ( edge.vertices[ 0 ] == vIdx1 || edge.vertices[ 1 ] == vIdx1 ) {
-						// there's no need to insert anything: the initial segment
-						// already existed as a collection of subsegments that we
-						// traversed in recursive calls to DeleteTrianglesIntersectingSegment
-						return true;
-					}
-
-					// check for degenerate cases, where the segment v0-v1 is parallel
-					// to a triangle edge. All we need to do in this case is instead 
-					// inserting the segment from the parallel edge endpoint to v1
+	bool AdjacencyInfo::recoverSegment( const int vIdx0, const int vIdx1, SegmentRecovery_t& scratch )
+	{
+		using namespace RenderLib::Geometry;
+		using namespace RenderLib::Math;
 
-					const int other = edge.vertices[ 0 ] == vIdx0 ? edge.vertices[ 1 ] : edge.vertices[ 0 ];
+		LIST( int )& vertexTriangle = scratch.vertexTriangle;
+		const Vector2f& B = vertices[ vIdx1 ];
 
-					if ( pointOnSegment<float>( v0, v1, vertices[ other ], 1e-3f, 0.f ) ) {
-						return deleteTrianglesIntersectingSegment_r( other, vIdx1, upperVertices, lowerVertices );			
-					}
+		int a = vIdx0;
+		while( a != vIdx1 ) {
+			if ( findEdge( a, vIdx1 ) >= 0 ) {
+				scratch.addConstraint( a, vIdx1 );
+				return true;
+			}
+			const Vector2f& A = vertices[ a ];
 
-					continue;
+			// rotate around a looking for the triangle a-b leaves a through, or for 
+			// an edge from a running along the segment. Counterclockwise first, and 
+			// clockwise from the start if the border of the triangulation is reached
+			const int startTriangle = vertexTriangle[ a ];
+			if ( startTriangle < 0 ) {
+				return false;
+			}
+			int t = startTriangle;
+			int direction = 1;
+			int first = -1, collinear = -1;
+			int p = -1, q = -1;
+			for( size_t steps = 0; steps <= triangles.size(); steps++ ) {
+				const Triangle_t& triangle = triangles[ t ];
+				assert( triangle.valid && triangle.contains( a ) );
+				const int i = triangle.vertices[ 0 ] == a ? 0 : ( triangle.vertices[ 1 ] == a ? 1 : 2 );
+				p = triangle.vertices[ ( i + 1 ) % 3 ];
+				q = triangle.vertices[ ( i + 2 ) % 3 ];
+				const Vector2f& P = vertices[ p ];
+				const Vector2f& Q = vertices[ q ];
+				const double sideP = orient2D( A, P, B );
+				const double sideQ = orient2D( A, Q, B );
+				// no vertex lies inside an edge, so a vertex aligned with a-b and on the 
+				// same side of a lies between a and b
+				if ( sideP == 0 && ( (double)P.x - A.x ) * ( (double)B.x - A.x ) + ( (double)P.y - A.y ) * ( (double)B.y - A.y ) > 0 ) {
+					collinear = p;
+					break;
 				}
-
-				const Vector2f& triVi = vertices[ edge.vertices[ 0 ] ];
-				const Vector2f& triVj = vertices[ edge.vertices[ 1 ] ];
-
-				if ( pointOnSegment<float>( v0, v1, triVi, 1e-3f, 0.f ) ||
-					 pointOnSegment<float>( v0, v1, triVj, 1e-3f, 0.f ) ) {
-						continue;
+				if ( sideQ == 0 && ( (double)Q.x - A.x ) * ( (double)B.x - A.x ) + ( (double)Q.y - A.y ) * ( (double)B.y - A.y ) > 0 ) {
+					collinear = q;
+					break;
+				}
+				if ( sideP > 0 && sideQ < 0 ) {
+					first = t;
+					break;
 				}
-				// we now for certain that the segment is not parallel
-
-				if ( segmentIntersect( v0, v1, triVi, triVj ) ) {
-					triEdge = e;
-					tri = v0Adjacents[ (unsigned int)t ];
-
-					upperVertices.append( vIdx0 );
-					lowerVertices.append( vIdx0 );
 
-					if ( segmentVertexSide( v0, v1, triVi ) >= 0 ) {
-						upperVertices.append( edge.vertices[ 0 ] );
-						assert( segmentVertexSide( v0, v1, triVj ) < 0 );
-						lowerVertices.append( edge.vertices[ 1 ] );
-					} else {
-						lowerVertices.append( edge.vertices[ 0 ] );
-						assert( segmentVertexSide( v0, v1, triVj ) >= 0 );
-						upperVertices.append( edge.vertices[ 1 ] );
+				const int next = adjacentTriangle( t, direction > 0 ? ( i + 2 ) % 3 : i );
+				if ( next < 0 ) {
+					if ( direction < 0 ) {
+						break;
 					}
-
+					direction = -1;
+					t = startTriangle;
+				} else if ( next == startTriangle ) {
 					break;
+				} else {
+					t = next;
 				}
 			}
-			if ( tri >= 0 ) {
-				break;
-			}
-		}
-		if ( tri < 0 || triEdge < 0 ) {
-			return 0;
-		}				
 
-		LIST( int ) toDelete;
-		do {
-			int next = this->adjacentTriangle( tri, triEdge );
-			assert( next >= 0 );	
-			if ( next < 0 ) {
-				break;
+			if ( collinear >= 0 ) {
+				// the segment runs along an existing edge, go on from its other end
+				scratch.addConstraint( a, collinear );
+				a = collinear;
+				continue;
+			}
+			if ( first < 0 ) {
+				assert( false );
+				return false;
 			}
 
-			const int globalEdgeJustCrossed = abs( triangles[ tri ].edges[ triEdge ] ) - 1;
-			toDelete.append( tri );
-			tri = next;
-
-			const Triangle_t& triangle = triangles[ tri ];
-			const int localEdgeJustCrossed = triangle.localEdgeIndex( globalEdgeJustCrossed );
-			assert( localEdgeJustCrossed >= 0 );
-
-			int vNext = this->vertexOutOfTriEdge( tri, localEdgeJustCrossed );
-			if ( vNext == vIdx1 ) {
-				upperVertices.append( vNext );
-				lowerVertices.append( vNext );
-			} else {
-				if ( pointOnSegment<float>( v0, v1, vertices[ vNext ] ) ) {
-					// vNext lies on the v0-v1 segment, dividing it into two
-					// so we'll now process the first half and make a recursive call
-					// to take care of the remaining half
-
-					deleteTrianglesIntersectingSegment_r( vNext, vIdx1, upperVertices, lowerVertices );
-
-					break;
-				}
-				if ( segmentVertexSide( v0, v1, vertices[ vNext ] ) >= 0 ) {
-					upperVertices.append( vNext );
-				} else {
-					lowerVertices.append( vNext );
+			// walk along the segment collecting the triangles it crosses, and the 
+			// vertices on either side: p is to the right of a-b and q to the left
+			LIST( int )& crossed = scratch.crossed;
+			LIST( int )& upper = scratch.upper;
+			LIST( int )& lower = scratch.lower;
+			crossed.resize( 0, false );
+			upper.resize( 0, false );
+			lower.resize( 0, false );
+			upper.append( a );
+			upper.append( q );
+			lower.append( a );
+			lower.append( p );
+
+			int left = q, right = p;
+			int current = first;
+			int end = -1;
+			while( end < 0 ) {
+				if ( scratch.isConstraint( right, left ) ) {
+					// crossing a constraint already in place, nothing has been modified yet
+					return false;
 				}
-
-				triEdge = -1;
-
-				for( int e = 0; e < 3; e++ ) {
-					if ( e == localEdgeJustCrossed ) {
-						// this will surely intersect the v0-v1 segment, but it's
-						// the segment through which we come from, so skip it
-#if _DEBUG
-						const int edgeIdx = abs( triangle.edges[ e ] ) - 1;
-						Edge_t edge = edges[ edgeIdx ];
-						const Vector2f& triVi = vertices[ edge.vertices[ 0 ] ];
-						const Vector2f& triVj = vertices[ edge.vertices[ 1 ] ];
-						assert( segmentIntersect( v0, v1, triVi, triVj ) ); 
-#endif
-						continue;
-					}
-					const int edgeIdx = abs( triangle.edges[ e ] ) - 1;
-					Edge_t edge = edges[ edgeIdx ];
-					const Vector2f& triVi = vertices[ edge.vertices[ 0 ] ];
-					const Vector2f& triVj = vertices[ edge.vertices[ 1 ] ];
-					if ( segmentIntersect( v0, v1, triVi, triVj, 0 ) ) {
-						triEdge = e;			
-						assert( edge.vertices[ 0 ] == vNext || edge.vertices[ 1 ] == vNext );
-						break;
-					}
+				crossed.append( current );
+				const Triangle_t& triangle = triangles[ current ];
+				int e = 0;
+				while( e < 3 && !( triangle.vertices[ e ] == right && triangle.vertices[ ( e + 1 ) % 3 ] == left ) ) {
+					e++;
 				}
-
-				assert( triEdge >= 0 );
-				if ( triEdge < 0 ) {
+				assert( e < 3 );
+				const int next = e < 3 ? adjacentTriangle( current, e ) : -1;
+				if ( next < 0 ) {
+					// segment going out of the triangulation, nothing has been modified yet
+					assert( false );
 					return false;
 				}
-			}
-
-		} while( !triangles[ tri ].contains( vIdx1 ) );
-
-		toDelete.append( tri );
-
-
-#if _DEBUG && DEBUG_STEPS
-		// dump to maya
-		{			
-			{
-				Vector2f& a = vertices[ vIdx0 ];
-				Vector2f& b = vertices[ vIdx1 ];
-				MString cmd = CoreLib::varArgsStr<1024>( "$c = `curve -d 1 -p %f %f 0 -p %f %f 0 -k 0 -k 1`;", a.x, a.y, b.x, b.y );
-				MGlobal::executeCommand( cmd );
-			}
-
-			MPointArray verts;
-			for( size_t i = 0; i < vertices.size(); i++ ) {
-				MPoint v( vertices[ i ].x, vertices[ i ].y, 0 );
-				verts.append( v );
-			}
+				const Triangle_t& nextTriangle = triangles[ next ];
+				int v = nextTriangle.vertices[ 0 ];
+				for( int j = 1; v == left || v == right; j++ ) {
+					v = nextTriangle.vertices[ j ];
+				}
 
-			MIntArray triangleVertices;
-			for( size_t i = 0; i < toDelete.size(); i++ ) {
-				const AdjacencyInfof::Triangle_t& triangle = triangles[ toDelete[ i ] ];
-				if ( !triangle.valid ) {
-					continue;
+				if ( v == vIdx1 ) {
+					end = v;
+				} else {
+					const double side = orient2D( A, B, vertices[ v ] );
+					if ( side == 0 ) {
+						// v lies on the segment, the rest of it is recovered from v
+						end = v;
+					} else if ( side > 0 ) {
+						upper.append( v );
+						left = v;
+					} else {
+						lower.append( v );
+						right = v;
+					}
 				}
-				triangleVertices.append( triangle.vertices[ 0 ] );
-				triangleVertices.append( triangle.vertices[ 1 ] );
-				triangleVertices.append( triangle.vertices[ 2 ] );
+				current = next;
 			}
+			crossed.append( current );
+			upper.append( end );
+			lower.append( end );
 
-
-			const int resultingTris = triangleVertices.length() / 3;
-			MFnMeshData meshData;
-			MObject meshObj = meshData.create();
-			MFnMesh mesh( meshObj );
-			MIntArray polygonCounts( resultingTris, 3 );
-			MStatus status;
-			mesh.create( verts.length(), resultingTris, verts, polygonCounts, triangleVertices, MObject::kNullObj, &status );
-			MGlobal::addToModel( meshObj );			
-		}
-#endif
-		for( size_t i = 0; i < toDelete.size(); i++ ) {
-			removeTriangle( toDelete[ (unsigned int)i ] );
-		}
-
-		// sort the upper/lower lists in the correct order
-		if ( upperVertices.size() > 2 ) {
-			const Vector2f v1 = vertices[ upperVertices[ 1 ] ] - vertices[ upperVertices[ 0 ] ];
-			const Vector2f v2 = vertices[ upperVertices[ (unsigned int)upperVertices.size() - 1 ] ] - vertices[ upperVertices[ 0 ] ];
-			const float crossProductZ = (v1.x * v2.y) - (v1.y * v2.x);
-			const bool reversed = crossProductZ < 0;
-			if ( reversed ) {
-				int aux;
-				for( unsigned int i = 0; i < (unsigned int)upperVertices.size() / 2; i++ ) {
-					aux = upperVertices[ i ];
-					upperVertices[ i ] = upperVertices[ (unsigned int)upperVertices.size() - 1 - i ];
-					upperVertices[ (unsigned int)upperVertices.size() - 1 - i ] = aux;
-				}
+			for( size_t i = 0; i < crossed.size(); i++ ) {
+				removeTriangle( crossed[ (unsigned int)i ] );
 			}
-		}
-		if ( lowerVertices.size() > 2 ) {
-			const Vector2f v1 = vertices[ lowerVertices[ 1 ] ] - vertices[ lowerVertices[ 0 ] ];
-			const Vector2f v2 = vertices[ lowerVertices[ (unsigned int)lowerVertices.size() - 1 ] ] - vertices[ lowerVertices[ 0 ] ];
-			const float crossProductZ = (v1.x * v2.y) - (v1.y * v2.x);
-			const bool reversed = crossProductZ < 0;
-			if ( reversed ) {
-				int aux;
-				for( unsigned int i = 0; i < (unsigned int)lowerVertices.size() / 2; i++ ) {
-					aux = lowerVertices[ i ];
-					lowerVertices[ i ] = lowerVertices[ (unsigned int)lowerVertices.size() - 1 - i ];
-					lowerVertices[ (unsigned int)lowerVertices.size() - 1 - i ] = aux;
-				}
+			if ( !fillCavity( upper, true, scratch ) || !fillCavity( lower, false, scratch ) ) {
+				return false;
 			}
+			scratch.addConstraint( a, end );
+			a = end;
 		}
-		return (int)toDelete.size();
+		return true;
 	}
 
-	bool AdjacencyInfo::triangulateSubPolygon_r( const LIST( int )& indices )
+	bool AdjacencyInfo::fillCavity( const LIST( int )& chain, const bool leftSide, SegmentRecovery_t& scratch )
 	{
 		using namespace RenderLib::Geometry;
 		using namespace RenderLib::Math;
 
-		if ( indices.size() < 3 ) {
-			return false;
-		}
-
-		if ( indices.size() == 3 ) {
-			// trivial triangulation
-			return createTriangle( indices[ 0 ], indices[ 1 ], indices[ 2 ] ) >= 0;
-		}
-
-		// Split subpolygon
+		// chain runs from one end of the segment to the other, through vertices all 
+		// on the same side of it. Each range of the chain is closed with the 
+		// triangle on its base whose circumcircle holds none of the vertices in 
+		// between, which leaves two smaller ranges on the triangle sides to fill
+		LIST( int )& ranges = scratch.ranges;
+		ranges.resize( 0, false );
+		ranges.append( 0 );
+		ranges.append( (int)chain.size() - 1 );
+		while( !ranges.empty() ) {
+			const int j = ranges[ (unsigned int)ranges.size() - 1 ];
+			const int i = ranges[ (unsigned int)ranges.size() - 2 ];
+			ranges.resize( ranges.size() - 2, false );
+			if ( j - i < 2 ) {
+				continue;
+			}
 
-		// look for a candidate point P between indices 1 and N-2
-		// so that the circumference passing through 0, p, N-1 is empty
-		Vector2f& a = vertices[ indices[ 0 ] ];
-		Vector2f& b = vertices[ indices[ (unsigned int)indices.size() - 1 ] ];
-		int splitPoint = -1;
-		for( int i = 1; i < (int)indices.size() - 1; i++ ) {
-			Vector2f& p = vertices[ indices[ i ] ];
-			bool empty = true;
-			for( int j = 1; j < (int)indices.size() - 1; j++ ) {
-				if ( j == i ) {
+			const Vector2f& Vi = vertices[ chain[ i ] ];
+			const Vector2f& Vj = vertices[ chain[ j ] ];
+			int best = -1;
+			for( int k = i + 1; k < j; k++ ) {
+				const Vector2f& Vk = vertices[ chain[ k ] ];
+				const double side = orient2D( Vi, Vj, Vk );
+				if ( leftSide ? side <= 0 : side >= 0 ) {
 					continue;
 				}
-
-				if ( inCircle( a, p, b, vertices[ indices[ j ] ] ) > 0 ) {
-					empty = false;
-					break;
+				// moving to a vertex inside the circle shrinks it on this side of the base
+				if ( best < 0 ) {
+					best = k;
+				} else {
+					const double inside = inCircle2D( Vi, Vj, vertices[ chain[ best ] ], Vk );
+					if ( leftSide ? inside > 0 : inside < 0 ) {
+						best = k;
+					}
 				}
 			}
-			if ( empty ) {
-				splitPoint = (int)i;
-				break;
-			}
-		}
-
-		if ( splitPoint <= 0 ) {					
-			assert( false );
-			return false;
-
-		}
-
-		LIST( int ) left, right;
-		for( int i = 0; i <= splitPoint; i++ ) {
-			left.append( indices[ i ] );
-		}			
-
-		for( size_t i = (size_t)splitPoint; i < indices.size(); i++ ) {
-			right.append( indices[ (unsigned int)i ] );
-		}
-		assert( left.size() < indices.size() );
-		assert( right.size() < indices.size() );
-		if ( !pointOnSegment<float>( vertices[ indices[ 0 ] ], vertices[ indices[ (unsigned int)indices.size() - 1 ] ], vertices[ (unsigned int)indices[ splitPoint ] ] ) ) {
-			 createTriangle( indices[ 0 ], indices[ splitPoint ], indices[ (unsigned int)indices.size() - 1 ] ); 
-		}
-
-		if ( left.size() >= 3 ) {
-			if ( !triangulateSubPolygon_r( left ) ) {
+			if ( best < 0 ) {
+				assert( false );
 				return false;
 			}
-		}
-		if ( right.size() >= 3 ) {
-			if ( !triangulateSubPolygon_r( right ) ) {
+
+			const int t = leftSide ? createTriangle( chain[ i ], chain[ j ], chain[ best ] ) 
+								   : createTriangle( chain[ i ], chain[ best ], chain[ j ] );
+			if ( t < 0 ) {
 				return false;
 			}
+			scratch.vertexTriangle[ chain[ i ] ] = t;
+			scratch.vertexTriangle[ chain[ j ] ] = t;
+			scratch.vertexTriangle[ chain[ best ] ] = t;
+
+			ranges.append( i );
+			ranges.append( best );
+			ranges.append( best );
+			ranges.append( j );
 		}
 		return true;
 	}
@@ -1067,32 +2442,127 @@ namespace internal {
 	int AdjacencyInfo::findEdge( int v1, int v2 ) const
 	{
 		assert( v1 != v2 );
-		for( int i = 0; i < static_cast<int>(edges.size()); i++ ) {
-			if ( edges[ i ].Links( v1, v2 ) )
+		if ( edgeTable.empty() ) {
+			return -1;
+		}
+		const unsigned int mask = (unsigned int)edgeTable.size() - 1;
+		for( unsigned int slot = edgeTableSlot( v1, v2 ); edgeTable[ slot ] >= 0; slot = ( slot + 1 ) & mask ) {
+			if ( edges[ edgeTable[ slot ] ].Links( v1, v2 ) )
 			{
-				return i;
+				return edgeTable[ slot ];
 			}
 		}
 		return -1;
 	}
 
-	float AdjacencyInfo::segmentVertexSide( const RenderLib::Math::Vector2f& A, const RenderLib::Math::Vector2f& B, const RenderLib::Math::Vector2f& P ) const
+	unsigned int AdjacencyInfo::edgeTableSlot( int v1, int v2 ) const
 	{
-		/*const Vector2f AB = B - A;
-		const Vector2f ABperp( AB.y, -AB.x );
-		const Vector2f AP = P - A;
-		return ABperp * AP;*/
-		return RenderLib::Geometry::signed2DTriangleArea( A, B, P );
+		// the same slot for both orientations of the edge
+		const unsigned long long a = (unsigned int)std::min( v1, v2 );
+		const unsigned long long b = (unsigned int)std::max( v1, v2 );
+		const unsigned long long h = ( ( a << 32 ) | b ) * 0x9E3779B97F4A7C15ull;
+		return (unsigned int)( h >> 32 ) & ( (unsigned int)edgeTable.size() - 1 );
 	}
-	
+
+	void AdjacencyInfo::insertEdgeInTable( int edgeIndex )
+	{
+		// keep the table at most half full, for short probe sequences
+		if ( 2 * edges.size() > edgeTable.size() ) {
+			rebuildEdgeTable();
+			return;
+		}
+		const Edge_t& edge = edges[ edgeIndex ];
+		const unsigned int mask = (unsigned int)edgeTable.size() - 1;
+		unsigned int slot = edgeTableSlot( edge.vertices[ 0 ], edge.vertices[ 1 ] );
+		while( edgeTable[ slot ] >= 0 ) {
+			slot = ( slot + 1 ) & mask;
+		}
+		edgeTable[ slot ] = edgeIndex;
+	}
+
+	void AdjacencyInfo::removeEdgeFromTable( int edgeIndex )
+	{
+		const Edge_t& edge = edges[ edgeIndex ];
+		const unsigned int mask = (unsigned int)edgeTable.size() - 1;
+		unsigned int slot = edgeTableSlot( edge.vertices[ 0 ], edge.vertices[ 1 ] );
+		while( edgeTable[ slot ] != edgeIndex ) {
+			assert( edgeTable[ slot ] >= 0 );
+			slot = ( slot + 1 ) & mask;
+		}
+
+		// shift back the following entries which would no longer be reachable 
+		// from their home slot, rather than leaving a tombstone
+		unsigned int next = slot;
+		for( ;; ) {
+			next = ( next + 1 ) & mask;
+			if ( edgeTable[ next ] < 0 ) {
+				break;
+			}
+			const Edge_t& other = edges[ edgeTable[ next ] ];
+			const unsigned int home = edgeTableSlot( other.vertices[ 0 ], other.vertices[ 1 ] );
+			// whether home lies cyclically in ( slot, next ]
+			const bool reachable = slot < next ? ( home > slot && home <= next ) : ( home > slot || home <= next );
+			if ( !reachable ) {
+				edgeTable[ slot ] = edgeTable[ next ];
+				slot = next;
+			}
+		}
+		edgeTable[ slot ] = -1;
+	}
+
+	void AdjacencyInfo::rebuildEdgeTable( size_t numEdges )
+	{
+		size_t size = 1024;
+		while( size < 2 * std::max( numEdges, edges.size() ) ) {
+			size *= 2;
+		}
+		edgeTable.resize( size, false );
+		for( size_t i = 0; i < size; i++ ) {
+			edgeTable[ (unsigned int)i ] = -1;
+		}
+		const unsigned int mask = (unsigned int)size - 1;
+		for( size_t i = 0; i < edges.size(); i++ ) {
+			const Edge_t& edge = edges[ (unsigned int)i ];
+			if ( edge.vertices[ 0 ] < 0 ) {
+				continue; // free
+			}
+			unsigned int slot = edgeTableSlot( edge.vertices[ 0 ], edge.vertices[ 1 ] );
+			while( edgeTable[ slot ] >= 0 ) {
+				slot = ( slot + 1 ) & mask;
+			}
+			edgeTable[ slot ] = (int)i;
+		}
+	}
+
 	unsigned int AdjacencyInfo::createEdge( int v1, int v2 )
 	{
-		Edge_t& e = edges.append();
+		int edgeIndex;
+		if ( freeEdges.empty() ) {
+			edgeIndex = (int)edges.size();
+			edges.append();
+		} else {
+			edgeIndex = freeEdges[ (unsigned int)freeEdges.size() - 1 ];
+			freeEdges.resize( freeEdges.size() - 1, false );
+		}
+		Edge_t& e = edges[ edgeIndex ];
 		e.vertices[ 0 ] = v1;
 		e.vertices[ 1 ] = v2;
 		e.triangles[ 0 ] = -1;
 		e.triangles[ 1 ] = -1;
-		return (int)edges.size() - 1;
+		insertEdgeInTable( edgeIndex );
+		return edgeIndex;
+	}
+
+	int AdjacencyInfo::edgeOf( const Triangle_t& t, int v1, int v2 ) const
+	{
+		for( int i = 0; i < 3; i++ ) {
+			const int a = t.vertices[ i ];
+			const int b = t.vertices[ ( i + 1 ) % 3 ];
+			if ( ( a == v1 && b == v2 ) || ( a == v2 && b == v1 ) ) {
+				return abs( t.edges[ i ] ) - 1;
+			}
+		}
+		return -1;
 	}
 
 	int AdjacencyInfo::commonEdge( const Triangle_t& tri1, const Triangle_t& tri2 ) const
@@ -1109,6 +2579,14 @@ namespace internal {
 		return -1;
 	}
 
+	bool AdjacencyInfo::containsPoint( const Triangle_t& t, const RenderLib::Math::Vector2f& p ) const
+	{
+		using namespace RenderLib::Geometry;
+		return orient2D( vertices[ t.vertices[ 0 ] ], vertices[ t.vertices[ 1 ] ], p ) >= 0 && 
+			   orient2D( vertices[ t.vertices[ 1 ] ], vertices[ t.vertices[ 2 ] ], p ) >= 0 && 
+			   orient2D( vertices[ t.vertices[ 2 ] ], vertices[ t.vertices[ 0 ] ], p ) >= 0;
+	}
+
 	AdjacencyInfo::Edge_t::Edge_t()
 	{
 		vertices[ 0 ] = vertices[ 1 ] = -1;
@@ -1126,7 +2604,6 @@ namespace internal {
 		vertices[ 0 ] = vertices[ 1 ] = vertices[ 2 ] = -1;
 		edges[ 0 ] = edges[ 1 ] = edges[ 2 ] = INT_MAX;
 		valid = false;
-		circumcircleRadius = -1;
 	}
 
 	bool AdjacencyInfo::Triangle_t::contains( int v ) const
@@ -1149,14 +2626,15 @@ namespace internal {
 		return -1;
 	}
 
-	float AdjacencyInfo::Triangle_t::insideCircumcircle( const RenderLib::Math::Vector2f& p, const LIST( RenderLib::Math::Vector2f )& verts ) const
+	double AdjacencyInfo::Triangle_t::insideCircumcircle( const RenderLib::Math::Vector2f& p, const LIST( RenderLib::Math::Vector2f )& verts ) const
 	{
 		using namespace RenderLib::Math;
 		const Vector2f& A = verts[ vertices[ 0 ] ];
 		const Vector2f& B = verts[ vertices[ 1 ] ];
 		const Vector2f& C = verts[ vertices[ 2 ] ];
 
-		const float det = inCircle( A, B, C, p );
+		// the triangles are counterclockwise
+		const double det = inCircle2D( A, B, C, p );
 #if _DEBUG && 0
 		{
 			Point2f center; 
@@ -1178,7 +2656,10 @@ namespace internal {
 
 	bool delaunay2D( const LIST( RenderLib::Math::Vector2f )& vertices, 
 					 LIST(int)* outTriangles , 
-					 AdjacencyInfo* adjacencyInfo ) {
+					 AdjacencyInfo* adjacencyInfo,
+					 Delaunay2DAlgorithm_t algorithm,
+					 bool parallel,
+					 float coincidentTolerance ) {
 
 		/* Implements Lawson algorithm: 
 		http://www.henrikzimmer.com/VoronoiDelaunay.pdf
@@ -1207,12 +2688,21 @@ namespace internal {
 		if ( adjacencyInfo == NULL ) {
 			adjacency = new AdjacencyInfo;
 		};
+
+		if ( algorithm == DELAUNAY_2D_DIVIDE_AND_CONQUER ) {
+			const bool result = delaunay2DDivideAndConquer( vertices, adjacency, outTriangles, parallel, coincidentTolerance );
+			if ( adjacencyInfo == NULL ) {
+				delete adjacency;
+			}
+			return result;
+		}
 		
+		adjacency->preAllocate( vertices.size() + 3 );
 		unsigned int stIdx1, stIdx2, stIdx3;
 		delaunay2DCreateSuperTriangle(vertices, adjacency, stIdx1, stIdx2, stIdx3 );
 
 
-		if ( !delaunay2DInsertPoints(vertices, adjacency) ) return false;
+		if ( !delaunay2DInsertPoints(vertices, parallel, coincidentTolerance, adjacency) ) return false;
 
 
 #if _DEBUG && DEBUG_STEPS
@@ -1289,73 +2779,84 @@ namespace internal {
 	bool constrainedDelaunay2D( const LIST( RenderLib::Math::Vector2f )& vertices, 
 								const LIST( int )& edges, 
 								LIST(int)* outTriangles, 
-								AdjacencyInfo* adjacencyInfo ) {
+								AdjacencyInfo* adjacencyInfo,
+								Delaunay2DAlgorithm_t algorithm,
+								float coincidentTolerance ) {
 			AdjacencyInfo* adjacency = adjacencyInfo;
 			if ( adjacencyInfo == NULL ) {
 				adjacency = new AdjacencyInfo;
 			}
 
-			if ( !delaunay2D( vertices, outTriangles, adjacency ) ) {
-				return false;
-			}
-
-			// build a list of all adjacent triangles for each vertex
-			if ( !adjacency->buildVertexTriangleAdjacencyInfo() ) {
+			if ( !delaunay2D( vertices, outTriangles, adjacency, algorithm, false, coincidentTolerance ) ) {
+				if ( adjacencyInfo == NULL ) {
+					delete adjacency;
+				}
 				return false;
 			}
 
-			// insert edges
-			for( unsigned int i = 0; i < (unsigned int)edges.size(); i += 2 ) {
+			// constraints already present in the triangulation are told apart through 
+			// the edge table, before doing any other work
+			AdjacencyInfo::SegmentRecovery_t scratch;
+			scratch.constraintEnds.resize( adjacency->vertices.size() );
+			adjacency->unrecoveredEdges.resize( 0, false );
+			LIST( int ) missing;
+			missing.setGranularity( 1024 );
+			for( unsigned int i = 0; i + 1 < (unsigned int)edges.size(); i += 2 ) {
 				int v0 = edges[ i ];
 				int v1 = edges[ i + 1 ];
-				if ( v0 == v1 || v0 < 0 || v1 < 0 ) {
+				if ( v0 < 0 || v1 < 0 || v0 >= (int)vertices.size() || v1 >= (int)vertices.size() ) {
 					continue;
 				}
-				if ( adjacency->findEdge( v0, v1 ) >= 0 ) {
+				// coincident vertices were merged into a single one
+				v0 = adjacency->mergedVertices[ v0 ];
+				v1 = adjacency->mergedVertices[ v1 ];
+				if ( v0 == v1 ) {
 					continue;
 				}
+				if ( adjacency->findEdge( v0, v1 ) >= 0 ) {
+					scratch.addConstraint( v0, v1 );
+				} else {
+					missing.append( (int)i / 2 );
+				}
+			}
 
-#if _DEBUG && DEBUG_STEPS
-				// dump to maya
-				{				
-					MPointArray vertices;
-					for( int i = 0; i < adjacency->vertices.Num(); i++ ) {
-						MPoint v( adjacency->vertices[ i ].x, adjacency->vertices[ i ].y, 0 );
-						vertices.append( v );
-					}
-
-					MIntArray triangleVertices;
-					for( int i = 0; i < adjacency->triangles.Num(); i++ ) {
-						const AdjacencyInfo::Triangle_t& triangle = adjacency->triangles[ i ];
-						if ( !triangle.valid ) {
-							continue;
+			bool recovered = true;
+			if ( !missing.empty() ) {
+				scratch.vertexTriangle.resize( adjacency->vertices.size(), false );
+				for( size_t i = 0; i < scratch.vertexTriangle.size(); i++ ) {
+					scratch.vertexTriangle[ (unsigned int)i ] = -1;
+				}
+				for( size_t i = 0; i < adjacency->triangles.size(); i++ ) {
+					const AdjacencyInfo::Triangle_t& triangle = adjacency->triangles[ (unsigned int)i ];
+					if ( triangle.valid ) {
+						for( int j = 0; j < 3; j++ ) {
+							scratch.vertexTriangle[ triangle.vertices[ j ] ] = (int)i;
 						}
-						triangleVertices.append( triangle.vertices[ 0 ] );
-						triangleVertices.append( triangle.vertices[ 1 ] );
-						triangleVertices.append( triangle.vertices[ 2 ] );
 					}
-
-
-					const int resultingTris = triangleVertices.length() / 3;
-					MFnMeshData meshData;
-					MObject meshObj = meshData.create();
-					MFnMesh mesh( meshObj );
-					MIntArray polygonCounts( resultingTris, 3 );
-					MStatus status;
-					mesh.create( vertices.length(), resultingTris, vertices, polygonCounts, triangleVertices, MObject::kNullObj, &status );
-					MGlobal::addToModel( meshObj );			
-				}
-#endif
-				LIST( int ) upperVertices, lowerVertices;
-				if ( adjacency->deleteTrianglesIntersectingSegment_r( v0, v1, upperVertices, lowerVertices ) == 0 ) {
-					break;
 				}
 
-				if ( !upperVertices.empty() && !adjacency->triangulateSubPolygon_r( upperVertices ) ) {
-					break;
+				// a failure leaves the segment out, possibly in part, but the rest are still recovered
+				for( size_t i = 0; i < missing.size(); i++ ) {
+					const int edge = missing[ (unsigned int)i ];
+					const int v0 = adjacency->mergedVertices[ edges[ 2 * edge ] ];
+					const int v1 = adjacency->mergedVertices[ edges[ 2 * edge + 1 ] ];
+					if ( !adjacency->recoverSegment( v0, v1, scratch ) ) {
+						adjacency->unrecoveredEdges.append( edge );
+						recovered = false;
+					}
 				}
-				if ( !lowerVertices.empty() && !adjacency->triangulateSubPolygon_r( lowerVertices ) ) {
-					break;
+
+				if ( outTriangles != NULL ) {
+					// the triangles returned by delaunay2D no longer hold
+					outTriangles->resize( 0, false );
+					for( size_t i = 0; i < adjacency->triangles.size(); i++ ) {
+						const AdjacencyInfo::Triangle_t& triangle = adjacency->triangles[ (unsigned int)i ];
+						if ( triangle.valid ) {
+							outTriangles->append( triangle.vertices[ 0 ] );
+							outTriangles->append( triangle.vertices[ 1 ] );
+							outTriangles->append( triangle.vertices[ 2 ] );
+						}
+					}
 				}
 			}
 
@@ -1394,7 +2895,99 @@ namespace internal {
 				delete adjacency;
 			}
 
+			return recovered;
+	}
+
+	bool refineDelaunay2D( AdjacencyInfo& adjacency, 
+						   LIST( int )& edges, 
+						   const float minAngleDegrees, 
+						   const float maxArea, 
+						   const unsigned int maxSteinerPoints,
+						   unsigned int* numUnresolved ) {
+		if ( adjacency.triangles.empty() ) {
+			return false;
+		}
+		internal::delaunayRefinement_t refinement( adjacency, minAngleDegrees, maxArea );
+		refinement.init( edges );
+		const bool done = refinement.run( maxSteinerPoints );
+		refinement.getConstraints( edges );
+		const unsigned int unresolved = refinement.countUnresolved();
+		if ( numUnresolved != NULL ) {
+			*numUnresolved = unresolved;
+		}
+		return done && unresolved == 0;
+	}
+
+	bool constrainedDelaunay2DBatch( const LIST( RenderLib::Math::Vector2f )& vertices,
+									 const LIST( int )& vertexOffsets,
+									 const LIST( int )& edges,
+									 const LIST( int )& edgeOffsets,
+									 LIST( int )& outTriangles,
+									 LIST( int )& triangleOffsets,
+									 const bool removeOutside ) {
+		using namespace internal;
+
+		outTriangles.resize( 0, false );
+		triangleOffsets.resize( 0, false );
+		if ( vertexOffsets.empty() || edgeOffsets.size() != vertexOffsets.size() ) {
+			return false;
+		}
+		const size_t count = vertexOffsets.size() - 1;
+		triangleOffsets.resize( count + 1, false );
+		triangleOffsets[ 0 ] = 0;
+		if ( count == 0 ) {
 			return true;
+		}
+
+		// each chunk of inputs gathers its triangles separately, then they're laid out contiguously
+		const size_t numChunks = ( count + BATCH_GRAIN_SIZE - 1 ) / BATCH_GRAIN_SIZE;
+		std::vector< LIST( int ) > chunkTriangles( numChunks );
+		const unsigned int numWorkspaces = DELAUNAY_2D_CONCURRENT_LISTS ? RenderLib::Parallel::numThreads() : 1;
+		batchWorkspacePool_t workspaces( std::min( numWorkspaces, (unsigned int)numChunks ) );
+		std::atomic< bool > succeeded( true );
+		auto triangulate = [ & ]( size_t begin, size_t end ) {
+			batchWorkspace_t& workspace = workspaces.acquire();
+			LIST( int )& triangles = chunkTriangles[ begin / BATCH_GRAIN_SIZE ];
+			for( size_t i = begin; i < end; i++ ) {
+				bool recovered;
+				const int written = delaunay2DTriangulateBatchItem( vertices, vertexOffsets[ (unsigned int)i ], vertexOffsets[ (unsigned int)i + 1 ],
+																	edges, edgeOffsets[ (unsigned int)i ], edgeOffsets[ (unsigned int)i + 1 ],
+																	removeOutside, workspace, triangles, recovered );
+				if ( written < 0 || !recovered ) {
+					succeeded = false;
+				}
+				triangleOffsets[ (unsigned int)i + 1 ] = std::max( written, 0 );
+			}
+			workspaces.release( workspace );
+		};
+#if DELAUNAY_2D_CONCURRENT_LISTS
+		RenderLib::Parallel::parallelFor( 0, count, BATCH_GRAIN_SIZE, triangulate );
+#else
+		// the lists of every workspace allocate from the same pools
+		for( size_t begin = 0; begin < count; begin += BATCH_GRAIN_SIZE ) {
+			triangulate( begin, std::min( begin + BATCH_GRAIN_SIZE, count ) );
+		}
+#endif
+
+		for( size_t i = 0; i < count; i++ ) {
+			triangleOffsets[ (unsigned int)i + 1 ] += triangleOffsets[ (unsigned int)i ];
+		}
+		outTriangles.resize( triangleOffsets[ (unsigned int)count ], false );
+		auto copy = [ & ]( size_t begin, size_t end ) {
+			for( size_t chunk = begin; chunk < end; chunk++ ) {
+				const LIST( int )& triangles = chunkTriangles[ chunk ];
+				const int offset = triangleOffsets[ (unsigned int)( chunk * BATCH_GRAIN_SIZE ) ];
+				for( size_t i = 0; i < triangles.size(); i++ ) {
+					outTriangles[ (unsigned int)( offset + i ) ] = triangles[ (unsigned int)i ];
+				}
+			}
+		};
+#if DELAUNAY_2D_CONCURRENT_LISTS
+		RenderLib::Parallel::parallelFor( 0, numChunks, 1, copy );
+#else
+		copy( 0, numChunks );
+#endif
+		return succeeded;
 	}
 
 } // namespace Delaunay
@@ -20,14 +20,17 @@
 	================================================================================
 */
 
-#include <math/algebra/matrix/matrix4.h>
-#include <math/algebra/matrix/matrix5.h>
 #include <math/algebra/vector/vector3.h>
 #include <geometry/tessellation/delaunay/delaunay3D.h>
 #include <geometry/bounds/boundingBox.h>
-#include <geometry/intersection/intersection.h>
+#include <geometry/predicates/predicates.h>
+#include <geometry/spatialSort/spatialSort.h>
+#include <dataStructs/pointKdTree/pointKdTree.h>
+#include <parallel/parallelFor.h>
 #include <math.h>
 #include <stack>
+#include <vector>
+#include <algorithm>
 
 namespace RenderLib {
 namespace Geometry {
@@ -38,6 +41,32 @@ namespace Delaunay {
 // Delaunay namespace
 
 namespace internal { 
+
+	// The source points followed by the 4 vertices of the containing tetrahedron, 
+	// so that these need not be appended to a copy of the source list. A persistent 
+	// tessellation keeps every vertex in a single list instead, the containing ones 
+	// being found at firstContaining rather than right after the points.
+	class vertexSet_t {
+	public:
+		vertexSet_t( const Point* points, const size_t numPoints ) : points( points ), numPoints( numPoints ), firstContaining( numPoints ) {}
+		vertexSet_t( const Point* points, const size_t numPoints, const size_t firstContaining ) : 
+			points( points ), numPoints( numPoints ), firstContaining( firstContaining ) {}
+
+		template< typename Index >
+		const Point&	operator[]( const Index i ) const { return (size_t)i - firstContaining < 4 ? containing[ (size_t)i - firstContaining ] : points[ i ]; }
+		size_t			size() const { return std::max( numPoints, firstContaining + 4 ); }
+		size_t			numSourcePoints() const { return numPoints; }
+		const Point*	sourcePoints() const { return points; }
+		size_t			firstContainingVertex() const { return firstContaining; }
+
+		Point			containing[ 4 ];
+
+	private:
+		const Point*	points;
+		size_t			numPoints;
+		size_t			firstContaining;
+	};
+
 	// Foreward declarations /////////////////////////////////////////////////
 
 	// Predicates //////////////////////////////////////////////////////////////////////////
@@ -55,8 +84,17 @@ namespace internal {
 		const Point& d, 
 		const Point& p );
 
+	// As inSphere, but never 0: points on the sphere are decided by a symbolic perturbation 
+	// depending on their coordinates only, so that the tessellation of any set of points is 
+	// unique whatever the insertion order
+	REAL inSpherePerturbed( const Point& a, 
+		const Point& b, 
+		const Point& c, 
+		const Point& d, 
+		const Point& p );
+
 	// Is p inside tetrahedron t?
-	bool inside( const Point& p, const tetrahedron_t& t, const CoreLib::List< Point >& vertices );
+	bool inside( const Point& p, const tetrahedron_t& t, const vertexSet_t& vertices );
 
 	// whether 4 points are coplanar
 	bool coplanar( const Point& a, const Point& b, const Point& c, const Point& d );
@@ -65,46 +103,236 @@ namespace internal {
 
 	void flip14( const unsigned int pointIndex, const unsigned int tetrahedron, 
 		CoreLib::List< tetrahedron_t >& tetrahedra,
-		const CoreLib::List< Point >& vertices,
+		CoreLib::List< unsigned int >& freeSlots,
+		const vertexSet_t& vertices,
 		unsigned int resultingTetrahedra[4] );
 
 	bool flip23( const unsigned int tetrahedron1, const unsigned int tetrahedron2, 							
 		CoreLib::List< tetrahedron_t >& tetrahedra,
-		const CoreLib::List< Point >& vertices,
+		CoreLib::List< unsigned int >& freeSlots,
+		const vertexSet_t& vertices,
 		unsigned int resultingTetrahedra[3] );
 
 	void flip32( const unsigned int tetrahedron1, const unsigned int tetrahedron2, const unsigned int tetrahedron3, 							
 		CoreLib::List< tetrahedron_t >& tetrahedra,
-		const CoreLib::List< Point >& vertices,
+		CoreLib::List< unsigned int >& freeSlots,
+		const vertexSet_t& vertices,
 		unsigned int resultingTetrahedra[2] );
 
 	void flip44( const unsigned int tetrahedron1, const unsigned int tetrahedron2, const unsigned int tetrahedron3, const unsigned int tetrahedron4,							
 		CoreLib::List< tetrahedron_t >& tetrahedra,
-		const CoreLib::List< Point >& vertices,
+		const vertexSet_t& vertices,
 		unsigned int resultingTetrahedra[4] );
 
 	// Auxiliary operations ////////////////////////////////////////////////////////////////
 
+	// Sphere the containing tetrahedron is built around, loosely wrapping the given bounds
+	void containingSphere( const BoundingBox& bounds, const size_t numPoints, RenderLib::Math::Point3f& center, float& radius );
+
+	// Sets up the containing vertices of the vertex set, and t as the tetrahedron they form
 	void containingTetrahedron( const RenderLib::Math::Point3f& center, const float radius, // circumsphere  
-		tetrahedron_t& t, CoreLib::List< Point >& points );
+		tetrahedron_t& t, vertexSet_t& vertices );
+
+	// Tessellates the source points of the vertex set inside a containing tetrahedron, 
+	// into a compact list
+	bool tessellate( vertexSet_t& vertices, const Delaunay3D::InsertionOrder_t insertionOrder, const bool parallel, 
+		const Delaunay3D::InsertionKernel_t kernel, CoreLib::List< tetrahedron_t >& tetrahedra );
+
+	// Streams the tetrahedra not touching the containing tetrahedron into the sink, 
+	// remapping their neighbors to the order they are emitted in
+	void emitTetrahedra( const CoreLib::List< tetrahedron_t >& tetrahedra, const size_t firstContaining, ITetrahedronSink& sink );
 
 	// Given a tetrahedron and a face, ensures the potential adjacent tetrahedron sharing
 	// that face points to the given tetrahedron.
 	void adjustNeighborVicinity( const int iT, const int f, CoreLib::List< tetrahedron_t >& tetrahedra );
 
+	// Removes the destroyed tetrahedra, remapping the neighbors of the remaining ones
+	void compact( CoreLib::List< tetrahedron_t >& tetrahedra );
+
+	// Removes in place the tetrahedra touching the containing tetrahedron
+	void discardContaining( CoreLib::List< tetrahedron_t >& tetrahedra, const size_t numSrcPoints );
+
+	// State kept by the point location walks along the whole tessellation. Rather than 
+	// clearing a visited flag per tetrahedron on every walk, each walk starts a new epoch 
+	// and a tetrahedron counts as visited when its stamp matches the current epoch.
+	struct walkState_t {
+		walkState_t() : epoch( 0 ), lastTetrahedron( 0 ), jumpSamples( 0 ), seed( 1 ) {}
+
+		void newEpoch( const size_t numTetrahedra );
+		bool visited( const int t ) const { return visitedEpoch[ t ] == epoch; }
+		unsigned int random() { seed = seed * 1664525u + 1013904223u; return seed >> 8; }
+
+		CoreLib::List< unsigned int >	visitedEpoch;		// epoch of the last walk visiting each tetrahedron
+		unsigned int					epoch;
+		int								lastTetrahedron;	// walks start from the tetrahedron created by the last insertion...
+		int								jumpSamples;		// ...or from the closest of these many randomly picked ones
+		unsigned int					seed;				// stochastic walk random generator state
+	};
+
 	// returns the index of the tetrahedron containing p, or -1 if not found. 
-	// It retrieves the result by searching from a given sourceT tetrahedron index. 
-	int walk( const Point& p, const int sourceT, const CoreLib::List< Point >& vertices, const CoreLib::List< tetrahedron_t >& tetrahedra );
+	// It retrieves the result walking from the last tetrahedron created, in a remembering stochastic walk
+	int walk( const Point& p, walkState_t& state, const vertexSet_t& vertices, const CoreLib::List< tetrahedron_t >& tetrahedra );
 
 	// Flips two given tetrahedra: T and Ta, which are non-Delaunay, 
 	// into a Delaunay configuration using bistellar flips
 	void flip(  const int T, const int Ta, const int p,
-		const CoreLib::List< Point >& vertices,
+		const vertexSet_t& vertices,
 		CoreLib::List< tetrahedron_t >& tetrahedra,
+		CoreLib::List< unsigned int >& freeSlots,
 		std::stack< unsigned int >& needTesting );
 
-	void insertOnePoint( const CoreLib::List< Point >& vertices, const int pointIndex, 
-		CoreLib::List< tetrahedron_t >& tetrahedra );
+	// Cavity insertion ////////////////////////////////////////////////////////////////////
+
+	struct cavityFace_t {
+		int		v[ 3 ];		// vertices, wound outwards from the cavity
+		int		neighbor;	// packed reference to the face on the outer side, or -1
+	};
+
+	struct cavityEdge_t {
+		int		a, b;		// sorted vertex indices
+		int		face;		// packed reference to the face of a new tetrahedron holding the edge and the point
+
+		bool operator<( const cavityEdge_t& other ) const {
+			return a < other.a || ( a == other.a && b < other.b );
+		}
+	};
+
+	// Buffers kept along the whole tessellation, so that the cavity insertions don't allocate
+	struct cavityState_t {
+		CoreLib::List< int >			cavity;		// tetrahedra whose circumsphere contains the point, in breadth-first order
+		CoreLib::List< int >			outside;	// tetrahedra tested and found not to be in conflict
+		CoreLib::List< cavityFace_t >	boundary;	// faces of the cavity
+		CoreLib::List< cavityEdge_t >	edges;		// boundary edges, twice each, to connect the new tetrahedra
+		CoreLib::List< char >			status;		// per tetrahedron: 0 untested, 1 in conflict, 2 not in conflict
+		CoreLib::List< int >			created;	// tetrahedra filling the cavity
+	};
+
+	// Grows the status list, cleared, to cover every tetrahedron
+	void growStatus( CoreLib::List< char >& status, const size_t numTetrahedra );
+
+	// Replaces the tetrahedra in the cavity, flagged 1 in the status list, with new ones joining 
+	// every boundary face to the point. Resets the status of the cavity
+	void fillCavity( const int pointIndex, CoreLib::List< tetrahedron_t >& tetrahedra, 
+		CoreLib::List< unsigned int >& freeSlots, walkState_t& walkState, cavityState_t& cavityState );
+
+	// Bowyer-Watson insertion: removes the tetrahedra whose circumsphere contains the point 
+	// and fills the resulting cavity with new tetrahedra joining its boundary to the point.
+	// Returns false if the point duplicates a vertex of the tessellation.
+	bool insertOnePointCavity( const vertexSet_t& vertices, const int pointIndex, 
+		CoreLib::List< tetrahedron_t >& tetrahedra, CoreLib::List< unsigned int >& freeSlots, 
+		walkState_t& walkState, cavityState_t& cavityState );
+
+	// Inserts a point into the tessellation, splitting the tetrahedra whose closure contains it
+	// and restoring the Delaunay condition through flips. The slots of the tetrahedra destroyed 
+	// are listed in freeSlots, to be reused by the next tetrahedra created.
+	// Returns false if the point duplicates a vertex of the tessellation.
+	bool insertOnePoint( const vertexSet_t& vertices, const int pointIndex, 
+		CoreLib::List< tetrahedron_t >& tetrahedra, CoreLib::List< unsigned int >& freeSlots, 
+		walkState_t& walkState, cavityState_t& cavityState );
+
+	// Parallel tessellation /////////////////////////////////////////////////////////////////
+
+	typedef RenderLib::DataStructures::PointKdTree< 3, REAL > PointTree;
+
+	// below this number of points, a set is tessellated sequentially
+	const size_t PARALLEL_MIN_POINTS = 16384;
+
+	// Tessellates the given subset of vertices, in BRIO order, inside a copy of the containing tetrahedron
+	void tetrahedralizeSubset( const vertexSet_t& vertices, const std::vector< unsigned int >& subset, 
+		const tetrahedron_t& containingT, const Delaunay3D::InsertionKernel_t kernel, CoreLib::List< tetrahedron_t >& tetrahedra );
+
+	struct cell_t {
+		std::vector< unsigned int >	points;
+		Point						boundsMin, boundsMax;	// region of space owned by the cell
+	};
+
+	// Recursively splits the vertex indices in [begin, end), owning the given region, at the median 
+	// of the longest axis, 'levels' times
+	void splitCells( const vertexSet_t& vertices, unsigned int* begin, unsigned int* end, 
+		const Point& boundsMin, const Point& boundsMax, const int levels, std::vector< cell_t >& cells );
+
+	// Whether no vertex lies strictly inside the circumsphere of t. If cell is given, t is known to be 
+	// empty of the vertices the cell owns, so spheres contained in its region are accepted right away.
+	bool emptyCircumsphere( const tetrahedron_t& t, const vertexSet_t& vertices, 
+		const PointTree& tree, std::vector< PointTree::Index_t >& candidates, const cell_t* cell = NULL );
+
+	// Rebuilds the adjacency between tetrahedra by matching their faces. Returns false if a face 
+	// is shared by more than two tetrahedra, that is, if the tetrahedra overlap
+	bool connectNeighbors( CoreLib::List< tetrahedron_t >& tetrahedra );
+
+	void gatherGlobalTetrahedra_r( const vertexSet_t& vertices, const size_t numSrcPoints, 
+		const std::vector< unsigned int >& subset, const bool ownsAllPoints, const tetrahedron_t& containingT, 
+		const Delaunay3D::InsertionKernel_t kernel, const PointTree& tree, CoreLib::List< tetrahedron_t >& result );
+
+	// Returns false if the partial tessellations don't stitch into a valid one
+	bool tetrahedralizeParallel( const vertexSet_t& vertices, const size_t numSrcPoints, 
+		const tetrahedron_t& containingT, const Delaunay3D::InsertionKernel_t kernel, CoreLib::List< tetrahedron_t >& tetrahedra );
+
+	// Persistent tessellation ///////////////////////////////////////////////////////////////
+
+	// face of a tessellation of the link vertices, keyed by its sorted vertices
+	struct linkFace_t {
+		int		v[ 3 ];
+		int		face;		// packed
+
+		bool operator<( const linkFace_t& other ) const {
+			return v[ 0 ] < other.v[ 0 ] || ( v[ 0 ] == other.v[ 0 ] && ( v[ 1 ] < other.v[ 1 ] || ( v[ 1 ] == other.v[ 1 ] && v[ 2 ] < other.v[ 2 ] ) ) );
+		}
+	};
+
+	// Tessellation kept by Delaunay3D between local updates. Every vertex lives in the 
+	// points list, the 4 containing ones included, so that their indices stay stable.
+	struct persistentState_t {
+		persistentState_t() : firstContaining( 0 ) {}
+
+		vertexSet_t	vertexSet() const;
+		bool		isContaining( const int v ) const { return (unsigned int)( v - firstContaining ) < 4; }
+
+		CoreLib::List< Point >			points;
+		CoreLib::List< int >			vertexTetrahedron;	// per vertex, a tetrahedron incident to it, or -1 if not in the tessellation
+		CoreLib::List< int >			freeVertices;		// indices of the removed vertices, handed out again by insertions
+		int								firstContaining;	// index of the first containing vertex
+		tetrahedron_t					containingT;
+		CoreLib::List< tetrahedron_t >	tetrahedra;			// destroyed ones included, their slots being in freeSlots
+		CoreLib::List< unsigned int >	freeSlots;
+		walkState_t						walkState;
+		cavityState_t					cavityState;
+
+		// removal buffers
+		CoreLib::List< int >			star;				// tetrahedra incident to the removed vertex
+		CoreLib::List< cavityFace_t >	hole;				// faces bounding the star
+		CoreLib::List< int >			link;				// vertices of those faces, followed by the containing ones
+		CoreLib::List< int >			localIndex;			// per vertex, its index in link, or -1
+		CoreLib::List< Point >			linkPoints;
+		CoreLib::List< tetrahedron_t >	linkTetrahedra;		// tessellation of the link vertices
+		CoreLib::List< unsigned int >	linkFreeSlots;
+		walkState_t						linkWalkState;
+		CoreLib::List< linkFace_t >		linkFaces;
+		CoreLib::List< int >			walls;				// per face of linkTetrahedra, the packed face across the hole boundary
+		CoreLib::List< int >			fill;				// tetrahedra of linkTetrahedra filling the hole
+		CoreLib::List< int >			fillIndex;			// per tetrahedron of linkTetrahedra, its index once filling the hole, or -1
+	};
+
+	// Tessellates again the vertices of the state, inside a containing tetrahedron wrapping them all
+	void rebuild( persistentState_t& state );
+
+	// Whether p lies inside the containing tetrahedron of the state
+	bool insideContaining( const persistentState_t& state, const Point& p );
+
+	// Inserts a vertex lying inside the containing tetrahedron. Returns false if it duplicates another one.
+	bool insertVertex( persistentState_t& state, const int vertex );
+
+	// Inserts a vertex, tessellating everything again if it lies outside the containing tetrahedron
+	void placeVertex( persistentState_t& state, const int vertex );
+
+	// Returns a tetrahedron incident to the vertex, or -1 if it isn't in the tessellation
+	int incidentTetrahedron( persistentState_t& state, const int vertex );
+
+	// Removes the vertex, filling the hole left by its incident tetrahedra with those of the 
+	// tessellation of its link (the vertices around it) lying inside. Returns false, leaving 
+	// the state untouched, if that tessellation doesn't fit the hole, which only happens when 
+	// the link vertices are cospherical and the tessellation is not unique.
+	bool removeVertex( persistentState_t& state, const int vertex );
 
 	//////////////////////////////////////////////////////////////////////////
 	//////////////////////////////////////////////////////////////////////////
@@ -119,58 +347,39 @@ namespace internal {
 		//////////////////////////////////////////////////////////////////////
 
 		void markInvalid( tetrahedron_t& t );
-		REAL getFaceArea( const tetrahedron_t& t, const int f, const CoreLib::List< Point >& vertices );
+		int pack( const int iT, const int f );
+		unsigned int allocate( CoreLib::List< tetrahedron_t >& tetrahedra, CoreLib::List< unsigned int >& freeSlots );
+		void link( CoreLib::List< tetrahedron_t >& tetrahedra, const int iT, const int f, const int iOther, const int otherFace );
+		REAL getFaceArea( const tetrahedron_t& t, const int f, const vertexSet_t& vertices );
 		int getFaceFromVertices( const tetrahedron_t& t, const int a, const int b, const int c );
 		int getVertexOutsideFace( const tetrahedron_t& t, int f );
 		bool sameWinding( const int v1[3], const int v2[3] );
 		int sharedFace( const tetrahedron_t& t, const tetrahedron_t& other, bool reversed );
 		bool adjacentTo( const tetrahedron_t& t, const tetrahedron_t& other );
-		bool checkNeighbors( const tetrahedron_t& t, const int thisIndex, const CoreLib::List< tetrahedron_t >& tetrahedra, const CoreLib::List< Point >& vertices );
+		bool checkNeighbors( const tetrahedron_t& t, const int thisIndex, const CoreLib::List< tetrahedron_t >& tetrahedra, const vertexSet_t& vertices );
 		void destroy( tetrahedron_t& t, CoreLib::List< tetrahedron_t >& tetrahedra );
-		bool sameOrientation( const tetrahedron_t& t, const int face, const tetrahedron_t& other, const int otherFace, const CoreLib::List< Point >& vertices );
-		void reverseFace( tetrahedron_t& t, const int f );
-		bool isFlat( const tetrahedron_t& t, const CoreLib::List< Point >& vertices );
-		void fixFaceOrientations( tetrahedron_t& t, const CoreLib::List< Point >& vertices );
-		bool checkFaceOrientations( const tetrahedron_t& t, const CoreLib::List< Point >& vertices );	
+		bool sameOrientation( const tetrahedron_t& t, const int face, const tetrahedron_t& other, const int otherFace, const vertexSet_t& vertices );
+		bool isFlat( const tetrahedron_t& t, const vertexSet_t& vertices );
+		void fixFaceOrientations( tetrahedron_t& t, const vertexSet_t& vertices );
+		bool checkFaceOrientations( const tetrahedron_t& t, const vertexSet_t& vertices );	
 
 		//////////////////////////////////////////////////////////////////////
 
+		// vertices of each face, wound outwards
+		const int faceVertices[ 4 ][ 3 ] = { { 0, 1, 2 }, { 0, 3, 1 }, { 1, 3, 2 }, { 2, 3, 0 } };
+		// vertex opposed to each face, and face opposed to each vertex
+		const int vertexOutsideFace[ 4 ] = { 3, 2, 0, 1 };
+		const int faceOutsideVertex[ 4 ] = { 2, 3, 1, 0 };
+
 		bool checkFaceOrientations( const tetrahedron_t& T, 
-									const CoreLib::List< Point >& vertices ) {
+									const vertexSet_t& vertices ) {
 				
 			// check whether the tetrahedron centroid lies behind every face
 
-			const Point& vo = vertices[ T.v[ 0 ] ];
-			const Point& va = vertices[ T.v[ 1 ] ];
-			const Point& vb = vertices[ T.v[ 2 ] ];
-			const Point& vc = vertices[ T.v[ 3 ] ];
-#if 0 // using centroid
-			const Vector3<REAL> a = va - vo;
-			const Vector3<REAL> b = vb - vo;
-			const Vector3<REAL> c = vc - vo;
-			Point C = vo + ( a + b + c ) / 4;
-#elif 1 // using incenter
-			const REAL a = getFaceArea( T, 2, vertices );
-			const REAL b = getFaceArea( T, 3, vertices );
-			const REAL c = getFaceArea( T, 1, vertices );
-			const REAL d = getFaceArea( T, 0, vertices );
-			const REAL t = a + b + c + d;
-			Point C = vo * ( a / t ) + va * ( b / t ) + vb * ( c / t ) + vc * ( d / t);
-#else // monge point
-			const Vector3<REAL> a = va - vo;
-			const Vector3<REAL> b = vb - vo;
-			const Vector3<REAL> c = vc - vo;
-			const Vector3<REAL> bCrossC = Vector3<REAL>::cross( b, c );
-			const Vector3<REAL> cCrossA = Vector3<REAL>::cross( c, a );
-			const Vector3<REAL> aCrossB = Vector3<REAL>::cross( a, b );
-
-			Point C = vo + ( a * ( ( b + c ) * bCrossC ) + b * ( ( c + a ) * cCrossA ) + c * ( ( a + b ) * aCrossB ) ) / ( a * bCrossC * 2 );
-
-#endif
 			int v2[3];
 			for( int i = 0; i < 4; i++ ) {
 				T.getFaceVertices( i, v2[0], v2[1], v2[2] );	
-				if( orient( vertices[ v2[0] ], vertices[ v2[1] ], vertices[ v2[2] ], C ) > 0 ) {
+				if( orient( vertices[ v2[0] ], vertices[ v2[1] ], vertices[ v2[2] ], vertices[ getVertexOutsideFace( T, i ) ] ) > 0 ) {
 					return false;
 				}
 			}
@@ -182,62 +391,27 @@ namespace internal {
 		// A tetrahedron is flat if its 4 vertices lie in the same plane
 		// A flat tetrahedron has no circumsphere
 		//////////////////////////////////////////////////////////////////////////
-		bool isFlat( const tetrahedron_t& t, const CoreLib::List< Point >& vertices ) {
+		bool isFlat( const tetrahedron_t& t, const vertexSet_t& vertices ) {
 			return coplanar( vertices[ t.v[ 0 ] ], vertices[ t.v[ 1 ] ], vertices[ t.v[ 2 ] ], vertices[ t.v[ 3 ] ] );
 		}
 
 		//////////////////////////////////////////////////////////////////////////
 		// fixFaceOrientations:
-		// ensure the tetrahedron centroid lies behind every face
+		// ensure the tetrahedron centroid lies behind every face. Since the faces
+		// are wound consistently, swapping two vertices reverses all of them. 
+		// This renumbers faces 2 and 3, so it must happen before t gets linked
 		//////////////////////////////////////////////////////////////////////////
-		void fixFaceOrientations( tetrahedron_t& t, const CoreLib::List< Point >& vertices ) {
-			using namespace RenderLib::Math;
-
-			// check whether the tetrahedron centroid lies behind every face
-
-			const Point& vo = vertices[ t.v[ 0 ] ];
-			const Point& va = vertices[ t.v[ 1 ] ];
-			const Point& vb = vertices[ t.v[ 2 ] ];
-			const Point& vc = vertices[ t.v[ 3 ] ];
-
+		void fixFaceOrientations( tetrahedron_t& t, const vertexSet_t& vertices ) {
 			if ( isFlat( t, vertices ) ) {
 				// the test makes no sense on flat tetrahedra as the centroid is neither inside nor outside the tetrahedron
 				return;
 			}
-#if 1 // using centroid
-			const Vector3<REAL> a = va - vo;
-			const Vector3<REAL> b = vb - vo;
-			const Vector3<REAL> c = vc - vo;
-			Point C = vo + ( a + b + c ) / 4;
-#elif 1 // using incenter
-			const REAL a = getFaceArea( t, 2, vertices );
-			const REAL b = getFaceArea( t, 3, vertices );
-			const REAL c = getFaceArea( t, 1, vertices );
-			const REAL d = getFaceArea( t, 0, vertices );
-			const REAL t = a + b + c + d;
-			Point C = vo * ( a / t ) + va * ( b / t ) + vb * ( c / t ) + vc * ( d / t);
-#else // monge point
-			const Vector3<REAL> a = va - vo;
-			const Vector3<REAL> b = vb - vo;
-			const Vector3<REAL> c = vc - vo;
-			const Vector3<REAL> bCrossC = Vector3<REAL>::cross( b, c );
-			const Vector3<REAL> cCrossA = Vector3<REAL>::cross( c, a );
-			const Vector3<REAL> aCrossB = Vector3<REAL>::cross( a, b );
-
-			Point C = vo + ( a * ( ( b + c ) * bCrossC ) + b * ( ( c + a ) * cCrossA ) + c * ( ( a + b ) * aCrossB ) ) / ( a * bCrossC * 2 );
-
-#endif
-			int v2[3];
-			for( int i = 0; i < 4; i++ ) {
-				t.getFaceVertices( i, v2[0], v2[1], v2[2] );
-				const Vector3<REAL> faceNormal = Vector3<REAL>::normalize( Vector3<REAL>::cross( vertices[ v2[2] ] - vertices[ v2[0] ], vertices[ v2[1] ] - vertices[ v2[0] ] ) ); // we can get away not normalizing it, since we're just interested in the distance sign
-				const REAL d = Vector3<REAL>::dot(faceNormal, vertices[ v2[0] ].fromOrigin());
-				const REAL distToPlane = Vector3<REAL>::dot(faceNormal, C.fromOrigin()) - d;
-				const REAL epsilon = 1e-1;
-				if ( distToPlane > epsilon ) { // the centroid should be behind the plane
-					reverseFace( t, i ); 
-				}
-			}				
+			// the tetrahedron is convex, so its centroid lies behind a face 
+			// exactly when the vertex opposite to that face does
+			if ( orient( vertices[ t.v[ 0 ] ], vertices[ t.v[ 1 ] ], vertices[ t.v[ 2 ] ], vertices[ t.v[ 3 ] ] ) > 0 ) {
+				std::swap( t.v[ 0 ], t.v[ 1 ] );
+				std::swap( t.neighbors[ 2 ], t.neighbors[ 3 ] );
+			}
 		}
 
 		void markInvalid( tetrahedron_t& t ) {
@@ -245,13 +419,34 @@ namespace internal {
 				t.v[ i ] = -1;
 				t.neighbors[ i ] = -1;
 			}
-			t.face[ 0 ][ 0 ] = 0; t.face[ 0 ][ 1 ] = 1; t.face[ 0 ][ 2 ] = 2;
-			t.face[ 1 ][ 0 ] = 0; t.face[ 1 ][ 1 ] = 3; t.face[ 1 ][ 2 ] = 1;
-			t.face[ 2 ][ 0 ] = 1; t.face[ 2 ][ 1 ] = 3; t.face[ 2 ][ 2 ] = 2;
-			t.face[ 3 ][ 0 ] = 2; t.face[ 3 ][ 1 ] = 3; t.face[ 3 ][ 2 ] = 0;
 		}
 
-		REAL getFaceArea( const tetrahedron_t& t, const int f, const CoreLib::List< Point >& vertices ) {
+		// encodes a reference to face f of tetrahedron iT, as stored in tetrahedron_t::neighbors
+		int pack( const int iT, const int f ) {
+			assert( iT >= 0 && f >= 0 && f < 4 );
+			return ( iT << 2 ) | f;
+		}
+
+		// returns the slot for a new tetrahedron, reusing a destroyed one if any
+		unsigned int allocate( CoreLib::List< tetrahedron_t >& tetrahedra, CoreLib::List< unsigned int >& freeSlots ) {
+			if ( freeSlots.size() > 0 ) {
+				const unsigned int slot = freeSlots[ freeSlots.size() - 1 ];
+				freeSlots.resize( freeSlots.size() - 1 );
+				assert( !tetrahedra[ slot ].isValid() );
+				return slot;
+			}
+			tetrahedra.append();
+			return (unsigned int)tetrahedra.size() - 1;
+		}
+
+		// makes face f of iT and face otherFace of iOther adjacent to each other
+		void link( CoreLib::List< tetrahedron_t >& tetrahedra, const int iT, const int f, const int iOther, const int otherFace ) {
+			assert( f >= 0 && otherFace >= 0 );
+			tetrahedra[ iT ].neighbors[ f ] = pack( iOther, otherFace );
+			tetrahedra[ iOther ].neighbors[ otherFace ] = pack( iT, f );
+		}
+
+		REAL getFaceArea( const tetrahedron_t& t, const int f, const vertexSet_t& vertices ) {
 			using namespace RenderLib::Geometry;
 			switch( f ) {
 					case 0:
@@ -269,42 +464,22 @@ namespace internal {
 		}
 
 		int getFaceFromVertices( const tetrahedron_t& t, const int a, const int b, const int c ) {
+			// the face is the one opposed to the only vertex not in a, b, c
+			int outside = -1;
 			for( int i = 0; i < 4; i++ ) {
-				int check = 0;
-				for( int j = 0; j < 3; j++ ) {
-					if ( t.v[ t.face[ i ][ j ] ] == a || 
-						 t.v[ t.face[ i ][ j ] ] == b || 
-						 t.v[ t.face[ i ][ j ] ] == c ) {
-						check |= ( 1 << j );						
+				if ( t.v[ i ] != a && t.v[ i ] != b && t.v[ i ] != c ) {
+					if ( outside >= 0 ) {
+						return -1;
 					}
-				}
-				if ( check == 7 /* 111 */ ) {
-					return i;
+					outside = i;
 				}
 			}
-
-			return -1;
+			return outside >= 0 ? faceOutsideVertex[ outside ] : -1;
 		}
 
 		int getVertexOutsideFace( const tetrahedron_t& t, int f ) {
 			assert( f >= 0 && f < 4 );
-			int check = 0;
-			for( int i = 0; i < 3; i++ ) {
-				check |= ( 1 << t.face[ f ][ i ] );
-			}
-			switch( check ) {
-					case 14: // 1110
-						return t.v[0];
-					case 13: // 1101
-						return t.v[1];
-					case 11: // 1011
-						return t.v[2];
-					case 7: // 0111
-						return t.v[3];
-					default:
-						assert( false );
-						return -1;
-			}
+			return t.v[ vertexOutsideFace[ f ] ];
 		}
 
 		////////////////////////////////////////////////////////////////////////
@@ -362,10 +537,10 @@ namespace internal {
 			return sharedFace( t, other, true ) >= 0;
 		}
 
-		bool checkNeighbors( const tetrahedron_t& t, const int thisIndex, const CoreLib::List< tetrahedron_t >& tetrahedra, const CoreLib::List< Point >& vertices ) {
+		bool checkNeighbors( const tetrahedron_t& t, const int thisIndex, const CoreLib::List< tetrahedron_t >& tetrahedra, const vertexSet_t& vertices ) {
 			for( int i = 0; i < 4; i++ ) {
 				if ( t.neighbors[ i ] >= 0 ) {
-					const tetrahedron_t& neighbor = tetrahedra[ t.neighbors[ i ] ];
+					const tetrahedron_t& neighbor = tetrahedra[ t.neighbor( i ) ];
 					if ( !neighbor.isValid() ) {
 						return false;
 					}
@@ -379,7 +554,7 @@ namespace internal {
 						return false;
 					}
 
-					if ( neighbor.neighbors[ sf ] != thisIndex ) {
+					if ( sf != t.neighborFace( i ) || neighbor.neighbor( sf ) != thisIndex || neighbor.neighborFace( sf ) != i ) {
 						return false;
 					}
 				}
@@ -391,12 +566,11 @@ namespace internal {
 			// unlink neighbors
 			for( int i = 0; i < 4; i++ ) {
 				if ( t.neighbors[ i ] >= 0 ) {
-					tetrahedron_t& n = tetrahedra[ t.neighbors[ i ] ];
+					tetrahedron_t& n = tetrahedra[ t.neighbor( i ) ];
 					if ( !n.isValid() ) {
 						continue;
 					}
-					const int sf = sharedFace( n, t, true );
-					n.neighbors[ sf ] = -1;
+					n.neighbors[ t.neighborFace( i ) ] = -1;
 				}
 			}
 
@@ -408,7 +582,7 @@ namespace internal {
 		// checks whether 'face' has the same orientation than 'otherFace' 
 		// (normals point toward the same direction)
 		////////////////////////////////////////////////////////////////////////
-		bool sameOrientation( const tetrahedron_t& t, const int face, const tetrahedron_t& other, const int otherFace, const CoreLib::List< Point >& vertices ) {
+		bool sameOrientation( const tetrahedron_t& t, const int face, const tetrahedron_t& other, const int otherFace, const vertexSet_t& vertices ) {
 			using namespace RenderLib::Math;
 			int vi1[3], vi2[3];
 			t.getFaceVertices( face, vi1[0], vi1[1], vi1[2] );
@@ -418,12 +592,6 @@ namespace internal {
 			return Vector3<REAL>::dot(n1, n2) > (REAL)0;
 		}
 
-		void reverseFace( tetrahedron_t& t, const int f ) {
-			const int v0 = t.face[ f ][ 0 ];
-			t.face[ f ][ 0 ] = t.face[ f ][ 2 ];
-			t.face[ f ][ 2 ] = v0;
-		}
-
 	} // namespace Tetrahedron
 
 	
@@ -448,35 +616,7 @@ namespace internal {
 	================
 	*/
 	REAL orient( const Point& a, const Point& b, const Point& c, const Point& p ) {
-		using namespace RenderLib::Math;
-		Matrix4<REAL> M( a.x, a.y, a.z, 1,
-						 b.x, b.y, b.z, 1, 
-						 c.x, c.y, c.z, 1, 
-						 p.x, p.y, p.z, 1 );
-		
-		const REAL epsilon = (REAL)0.001;
-		const REAL det = M.determinant();
-
-#if _DEBUG
-		{
-			Vector3<REAL> n = Vector3<REAL>::cross( c - a , b - a );
-			if ( n.lengthSquared() > 1e-4 ) {
-				n.normalize();
-				const REAL d = Vector3<REAL>::dot(n, a.fromOrigin());
-				const REAL distToPlane = Vector3<REAL>::dot(n, p.fromOrigin()) - d;
-				if ( det > epsilon ) {
-					assert( distToPlane > 0 );
-				} else if ( det < -epsilon ) {
-					assert( distToPlane < 0 );
-				}
-			}
-		}
-#endif
-
-		if( det < -epsilon || det > epsilon ) {
-			return det;
-		} 
-		return 0;
+		return RenderLib::Geometry::orient3D( a, b, c, p );
 	}
 
 	/*
@@ -488,36 +628,55 @@ namespace internal {
 	================
 	*/
 	REAL inSphere( const Point& a, const Point& b, const Point& c, const Point& d, const Point& p ) {
-		using namespace RenderLib::Math;
-		Matrix5<REAL> M( a.x, a.y, a.z, a.x * a.x + a.y * a.y + a.z * a.z, 1, 
-						 b.x, b.y, b.z, b.x * b.x + b.y * b.y + b.z * b.z, 1, 
-						 c.x, c.y, c.z, c.x * c.x + c.y * c.y + c.z * c.z, 1, 
-						 d.x, d.y, d.z, d.x * d.x + d.y * d.y + d.z * d.z, 1, 
-						 p.x, p.y, p.z, p.x * p.x + p.y * p.y + p.z * p.z, 1 );
-
-		const REAL epsilon = (REAL)0.0001;
-		const REAL det = M.determinant();
-
 		assert( orient( a, b, c, d ) >= 0 );
-#if _DEBUG
-		{
-			Point center; 
-			REAL radius = 0;
-			SphereFrom4Points<REAL>( a, b, c, d, center, radius );
-			const REAL dist = center.distanceTo( p );
+		return RenderLib::Geometry::inSphere( a, b, c, d, p );
+	}
 
-			if( det < -epsilon ) { 
-				assert( dist > radius - epsilon );
-			} else if ( det > epsilon ) {
-				assert( dist < radius + epsilon );
-			} 			
-		}
-#endif
+	bool lexicographicLess( const Point* p, const Point* q ) {
+		return p->x < q->x || ( p->x == q->x && ( p->y < q->y || ( p->y == q->y && p->z < q->z ) ) );
+	}
 
-		if( det < -epsilon || det > epsilon ) {
+	/*
+	================
+	Delaunay3D::InSpherePerturbed
+
+	Perturbation from "Perturbations for Delaunay and weighted Delaunay 3D 
+	Triangulations" (Devillers, Teillaud): the points are given infinitesimal 
+	weights, decreasing along the lexicographic order, which turns the 
+	tessellation into a regular one with no 5 points on a power sphere. The 
+	perturbed determinant is a polynomial whose monomials, by decreasing 
+	order of magnitude, have as coefficients the orientation of the 
+	tetrahedron with each point replaced by p, from the lexicographically 
+	greatest point down. Its two leading ones are enough to decide.
+	================
+	*/
+	REAL inSpherePerturbed( const Point& a, const Point& b, const Point& c, const Point& d, const Point& p ) {
+		const REAL det = inSphere( a, b, c, d, p );
+		if ( det != 0 ) {
 			return det;
-		} 
-		return 0;
+		}
+
+		const Point* points[ 5 ] = { &a, &b, &c, &d, &p };
+		std::sort( points, points + 5, lexicographicLess );
+		for( int i = 4; i > 2; i-- ) {
+			REAL o = 0;
+			if ( points[ i ] == &p ) {
+				return -1; // a, b, c and d are not coplanar
+			} else if ( points[ i ] == &a ) {
+				o = orient( p, b, c, d );
+			} else if ( points[ i ] == &b ) {
+				o = orient( a, p, c, d );
+			} else if ( points[ i ] == &c ) {
+				o = orient( a, b, p, d );
+			} else {
+				o = orient( a, b, c, p );
+			}
+			if ( o != 0 ) {
+				return o;
+			}
+		}
+		assert( false );
+		return -1;
 	}
 
 	/*
@@ -527,7 +686,7 @@ namespace internal {
 	Whether the point p is inside the tetrahedron t
 	================
 	*/
-	bool inside( const Point& p, const tetrahedron_t& t, const CoreLib::List< Point >& vertices ) {
+	bool inside( const Point& p, const tetrahedron_t& t, const vertexSet_t& vertices ) {
 		
 		using namespace RenderLib::Math;
 
@@ -538,13 +697,7 @@ namespace internal {
 
 		for( int i = 0; i < 4; i++ ) {
 			t.getFaceVertices( i, a, b, c );
-			//if ( Orient( vertices[ a ], vertices[ b ], vertices[ c ], p ) > 0 ) {
-			//	return false;
-			//}
-			const Vector3<REAL> n = Vector3<REAL>::normalize( Vector3<REAL>::cross( vertices[ c ] - vertices[ a ], vertices[ b ] - vertices[ a ] ) );
-			const REAL d = Vector3<REAL>::dot(n, vertices[ a ].fromOrigin());
-			const REAL distToPlane = Vector3<REAL>::dot(n, p.fromOrigin()) - d;
-			if ( distToPlane > 1e-4 ) {
+			if ( orient( vertices[ a ], vertices[ b ], vertices[ c ], p ) > 0 ) {
 				return false;
 			}
 		}
@@ -576,7 +729,8 @@ namespace internal {
 	*/
 	void flip14( const unsigned int pointIndex, const unsigned int tetrahedron, 
 		CoreLib::List< tetrahedron_t >& tetrahedra,
-		const CoreLib::List< Point >& vertices,
+		CoreLib::List< unsigned int >& freeSlots,
+		const vertexSet_t& vertices,
 		unsigned int resultingTetrahedra[4] ) {
 
 		tetrahedron_t srcT = tetrahedra[ (int)tetrahedron ];
@@ -597,12 +751,12 @@ namespace internal {
 		const unsigned int iResT1 = tetrahedron; // reuse the source tetrahedron slot
 		tetrahedron_t& resT1 = tetrahedra[ iResT1 ];
 		Tetrahedron::destroy( resT1, tetrahedra );
-		const unsigned int iResT2 = (unsigned int)tetrahedra.size(); 
-		tetrahedron_t& resT2 = tetrahedra.append();
-		const unsigned int iResT3 = (unsigned int)tetrahedra.size(); 
-		tetrahedron_t& resT3 = tetrahedra.append();
-		const unsigned int iResT4 = (unsigned int)tetrahedra.size(); 
-		tetrahedron_t& resT4 = tetrahedra.append();
+		const unsigned int iResT2 = Tetrahedron::allocate( tetrahedra, freeSlots ); 
+		tetrahedron_t& resT2 = tetrahedra[ iResT2 ];
+		const unsigned int iResT3 = Tetrahedron::allocate( tetrahedra, freeSlots ); 
+		tetrahedron_t& resT3 = tetrahedra[ iResT3 ];
+		const unsigned int iResT4 = Tetrahedron::allocate( tetrahedra, freeSlots ); 
+		tetrahedron_t& resT4 = tetrahedra[ iResT4 ];
 
 		assert( !resT1.isValid() );
 		assert( !resT2.isValid() );
@@ -641,25 +795,20 @@ namespace internal {
 		// Adjust neighbors 
 
 		resT1.neighbors[ 0 ] = srcT.neighbors[ 0 ];
-		resT1.neighbors[ Tetrahedron::sharedFace( resT1, resT2, true ) ] = iResT2;
-		resT1.neighbors[ Tetrahedron::sharedFace( resT1, resT3, true ) ] = iResT3;
-		resT1.neighbors[ Tetrahedron::sharedFace( resT1, resT4, true ) ] = iResT4;
-
 		resT2.neighbors[ 0 ] = srcT.neighbors[ 1 ];
-		resT2.neighbors[ Tetrahedron::sharedFace( resT2, resT4, true ) ] = iResT4;
-		resT2.neighbors[ Tetrahedron::sharedFace( resT2, resT3, true ) ] = iResT3;
-		resT2.neighbors[ Tetrahedron::sharedFace( resT2, resT1, true ) ] = iResT1;
-
 		resT3.neighbors[ 0 ] = srcT.neighbors[ 2 ];
-		resT3.neighbors[ Tetrahedron::sharedFace( resT3, resT2, true ) ] = iResT2;
-		resT3.neighbors[ Tetrahedron::sharedFace( resT3, resT4, true ) ] = iResT4;
-		resT3.neighbors[ Tetrahedron::sharedFace( resT3, resT1, true ) ] = iResT1;
-
 		resT4.neighbors[ 0 ] = srcT.neighbors[ 3 ];
-		resT4.neighbors[ Tetrahedron::sharedFace( resT4, resT3, true ) ] = iResT3;
-		resT4.neighbors[ Tetrahedron::sharedFace( resT4, resT2, true ) ] = iResT2;
-		resT4.neighbors[ Tetrahedron::sharedFace( resT4, resT1, true ) ] = iResT1;
-		
+
+		for( int i = 0; i < 4; i++ ) {
+			for( int j = i + 1; j < 4; j++ ) {
+				const tetrahedron_t& ti = tetrahedra[ resultingTetrahedra[ i ] ];
+				const tetrahedron_t& tj = tetrahedra[ resultingTetrahedra[ j ] ];
+				Tetrahedron::link( tetrahedra, resultingTetrahedra[ i ], Tetrahedron::sharedFace( ti, tj, true ), 
+											   resultingTetrahedra[ j ], Tetrahedron::sharedFace( tj, ti, true ) );
+			}
+		}
+
+
 		for( int i = 0; i < 4; i++ ) {
 			adjustNeighborVicinity( resultingTetrahedra[ i ], 0, tetrahedra );
 		}
@@ -680,7 +829,8 @@ namespace internal {
 	*/
 	bool flip23( const unsigned int tetrahedron1, const unsigned int tetrahedron2, 
 				 CoreLib::List< tetrahedron_t >& tetrahedra,
-				 const CoreLib::List< Point >& vertices,
+				 CoreLib::List< unsigned int >& freeSlots,
+				 const vertexSet_t& vertices,
 				 unsigned int resultingTetrahedra[3] ) {
 
 		tetrahedron_t srcT1 = tetrahedra[ tetrahedron1 ];
@@ -748,8 +898,8 @@ namespace internal {
 		const unsigned int iResT2 = tetrahedron2; // reuse the source tetrahedron2 slot
 		tetrahedron_t& resT2 = tetrahedra[ iResT2 ];
 		Tetrahedron::destroy( resT2, tetrahedra );
-		const unsigned int iResT3 = (unsigned int)tetrahedra.size(); 
-		tetrahedron_t& resT3 = tetrahedra.append();
+		const unsigned int iResT3 = Tetrahedron::allocate( tetrahedra, freeSlots ); 
+		tetrahedron_t& resT3 = tetrahedra[ iResT3 ];
 
 		assert( !resT1.isValid() );
 		assert( !resT2.isValid() );
@@ -855,12 +1005,9 @@ namespace internal {
 		}
 
 		// adjust internal neighborhood
-		resT1.neighbors[ Tetrahedron::sharedFace( resT1, resT2, true ) ] = iResT2;
-		resT1.neighbors[ Tetrahedron::sharedFace( resT1, resT3, true ) ] = iResT3;
-		resT2.neighbors[ Tetrahedron::sharedFace( resT2, resT1, true ) ] = iResT1;
-		resT2.neighbors[ Tetrahedron::sharedFace( resT2, resT3, true ) ] = iResT3;
-		resT3.neighbors[ Tetrahedron::sharedFace( resT3, resT1, true ) ] = iResT1;
-		resT3.neighbors[ Tetrahedron::sharedFace( resT3, resT2, true ) ] = iResT2;
+		Tetrahedron::link( tetrahedra, iResT1, Tetrahedron::sharedFace( resT1, resT2, true ), iResT2, Tetrahedron::sharedFace( resT2, resT1, true ) );
+		Tetrahedron::link( tetrahedra, iResT1, Tetrahedron::sharedFace( resT1, resT3, true ), iResT3, Tetrahedron::sharedFace( resT3, resT1, true ) );
+		Tetrahedron::link( tetrahedra, iResT2, Tetrahedron::sharedFace( resT2, resT3, true ), iResT3, Tetrahedron::sharedFace( resT3, resT2, true ) );
 
 		
 #if _DEBUG
@@ -884,7 +1031,8 @@ namespace internal {
 	*/
 	void flip32( const unsigned int tetrahedron1, const unsigned int tetrahedron2, const unsigned int tetrahedron3, 
 				 CoreLib::List< tetrahedron_t >& tetrahedra,
-				 const CoreLib::List< Point >& vertices,
+				 CoreLib::List< unsigned int >& freeSlots,
+				 const vertexSet_t& vertices,
 				 unsigned int resultingTetrahedra[2] ) {
 
 		using namespace RenderLib::Math;
@@ -977,23 +1125,22 @@ namespace internal {
 			a = abc[ 0 ];
 			b = abc[ 1 ];
 			c = abc[ 2 ];
-			const Vector3<REAL> facePlaneNormal = Vector3<REAL>::normalize( Vector3<REAL>::cross( vertices[ c ] - vertices[ a ], vertices[ b ] - vertices[ a ] ) );
-			const REAL facePlaneDist = Vector3<REAL>::dot(facePlaneNormal, vertices[ a ].fromOrigin());
-			if ( Vector3<REAL>::dot(facePlaneNormal, vertices[ dp[ 0 ] ].fromOrigin()) - facePlaneDist > -1e-4 ) { // sort it so p falls below ABC and d above
+			if ( orient( vertices[ a ], vertices[ b ], vertices[ c ], vertices[ dp[ 0 ] ] ) >= 0 ) { // sort it so p falls below ABC and d above
 				d = dp[ 0 ];
 				p = dp[ 1 ];
 			} else {
 				d = dp[ 1 ];
 				p = dp[ 0 ];
 			}
-			assert( Vector3<REAL>::dot(facePlaneNormal, vertices[ d ].fromOrigin()) - facePlaneDist > -1e-4 );
-			assert( Vector3<REAL>::dot(facePlaneNormal, vertices[ p ].fromOrigin()) - facePlaneDist < 1e-4 );
+			assert( orient( vertices[ a ], vertices[ b ], vertices[ c ], vertices[ d ] ) >= 0 );
+			assert( orient( vertices[ a ], vertices[ b ], vertices[ c ], vertices[ p ] ) <= 0 );
 		}
 		
 		assert( a >= 0 && b >= 0 && c >= 0 && d >= 0 && p >= 0 );
 
-		// destroy the unused tetrahedron
+		// destroy the unused tetrahedron, its slot will be reused
 		Tetrahedron::destroy( tetrahedra[ tetrahedron3 ], tetrahedra );
+		freeSlots.append( tetrahedron3 );
 
 		// Result 1
 
@@ -1007,8 +1154,7 @@ namespace internal {
 			const int sf1 = Tetrahedron::sharedFace( srcT1, resT1, false );
 			const int sf2 = Tetrahedron::sharedFace( srcT2, resT1, false );
 			const int sf3 = Tetrahedron::sharedFace( srcT3, resT1, false );
-			const int sf4 = Tetrahedron::getFaceFromVertices( resT1, a, c, b );
-			assert( sf1 >= 0 && sf2 >= 0 && sf3 >= 0 && sf4 >= 0 );
+			assert( sf1 >= 0 && sf2 >= 0 && sf3 >= 0 );
 
 			int v[3];
 
@@ -1027,8 +1173,6 @@ namespace internal {
 			adjustNeighborVicinity( iResT1, r1sf, tetrahedra );
 			adjustNeighborVicinity( iResT1, r2sf, tetrahedra );
 			adjustNeighborVicinity( iResT1, r3sf, tetrahedra );
-
-			resT1.neighbors[ sf4 ] = iResT2;
 		}		
 
 		// Result 2
@@ -1064,7 +1208,7 @@ namespace internal {
 			adjustNeighborVicinity( iResT2, r2sf, tetrahedra );
 			adjustNeighborVicinity( iResT2, r3sf, tetrahedra );
 
-			resT2.neighbors[ sf4 ] = iResT1;
+			Tetrahedron::link( tetrahedra, iResT2, sf4, iResT1, Tetrahedron::getFaceFromVertices( resT1, a, c, b ) );
 		}		
 		
 #if _DEBUG
@@ -1084,7 +1228,7 @@ namespace internal {
 	*/
 	void flip44( const unsigned int tetrahedron1, const unsigned int tetrahedron2, const unsigned int tetrahedron3, const unsigned int tetrahedron4,
 				 CoreLib::List< tetrahedron_t >& tetrahedra,
-				 const CoreLib::List< Point >& vertices,
+				 const vertexSet_t& vertices,
 				 unsigned int resultingTetrahedra[4] ) {
 
 		
@@ -1205,6 +1349,10 @@ namespace internal {
 			if ( resT3.v[ i ] == c ) resT3.v[ i ] = b;
 			if ( resT4.v[ i ] == c ) resT4.v[ i ] = b;
 		}
+		Tetrahedron::fixFaceOrientations( resT1, vertices );
+		Tetrahedron::fixFaceOrientations( resT2, vertices );
+		Tetrahedron::fixFaceOrientations( resT3, vertices );
+		Tetrahedron::fixFaceOrientations( resT4, vertices );
 
 		// Result 1
 		
@@ -1278,14 +1426,10 @@ namespace internal {
 
 		{
 			// Fix adjacency between resulting tetrahedra
-			resT1.neighbors[ Tetrahedron::getFaceFromVertices( resT1, b, c, e ) ] = iResT2;
-			resT1.neighbors[ Tetrahedron::getFaceFromVertices( resT1, a, b, e ) ] = iResT3;
-			resT2.neighbors[ Tetrahedron::getFaceFromVertices( resT2, b, c, e ) ] = iResT1;
-			resT2.neighbors[ Tetrahedron::getFaceFromVertices( resT2, b, e, f ) ] = iResT4;
-			resT3.neighbors[ Tetrahedron::getFaceFromVertices( resT3, a, b, e ) ] = iResT1;
-			resT3.neighbors[ Tetrahedron::getFaceFromVertices( resT3, b, d, e ) ] = iResT4;
-			resT4.neighbors[ Tetrahedron::getFaceFromVertices( resT4, b, d, e ) ] = iResT3;
-			resT4.neighbors[ Tetrahedron::getFaceFromVertices( resT4, b, e, f ) ] = iResT2;
+			Tetrahedron::link( tetrahedra, iResT1, Tetrahedron::getFaceFromVertices( resT1, b, c, e ), iResT2, Tetrahedron::getFaceFromVertices( resT2, b, c, e ) );
+			Tetrahedron::link( tetrahedra, iResT1, Tetrahedron::getFaceFromVertices( resT1, a, b, e ), iResT3, Tetrahedron::getFaceFromVertices( resT3, a, b, e ) );
+			Tetrahedron::link( tetrahedra, iResT2, Tetrahedron::getFaceFromVertices( resT2, b, e, f ), iResT4, Tetrahedron::getFaceFromVertices( resT4, b, e, f ) );
+			Tetrahedron::link( tetrahedra, iResT3, Tetrahedron::getFaceFromVertices( resT3, b, d, e ), iResT4, Tetrahedron::getFaceFromVertices( resT4, b, d, e ) );
 		}
 
 #if _DEBUG
@@ -1293,16 +1437,27 @@ namespace internal {
 			assert( Tetrahedron::checkNeighbors( tetrahedra[ resultingTetrahedra[ i ] ], resultingTetrahedra[ i ], tetrahedra, vertices ) );	
 		}
 #endif
-		Tetrahedron::fixFaceOrientations( resT1, vertices );
-		Tetrahedron::fixFaceOrientations( resT2, vertices );
-		Tetrahedron::fixFaceOrientations( resT3, vertices );
-		Tetrahedron::fixFaceOrientations( resT4, vertices );
 	}
 
 	//////////////////////////////////////////////////////////////////////////
 	// Auxiliary functions
 	//////////////////////////////////////////////////////////////////////////
 
+	/*
+	================
+	Delaunay3D::ContainingSphere
+	================
+	*/
+	void containingSphere( const BoundingBox& bounds, const size_t numPoints, RenderLib::Math::Point3f& center, float& radius ) {
+		bounds.boundingSphere( center, radius );
+		radius *= 2; // avoid a too tight bound since we want the containing tetrahedron's faces to wrap all the points
+		if ( numPoints < 2 ) {
+			// we don't have enough points to define a volume
+			// so give it a fixed extra radius
+			radius = 1.0;
+		}
+	}
+
 	/*
 	================
 	Delaunay3D::Containingtetrahedron
@@ -1315,7 +1470,7 @@ namespace internal {
 	*/
 	void containingTetrahedron( const RenderLib::Math::Point3f& center, const float radius, // circumsphere
 								tetrahedron_t& t,
-								CoreLib::List< Point >& pointSet ) {
+								vertexSet_t& vertices ) {
 
 		// from the Wikipedia: 
 		// For a regular tetrahedron of edge length L: radius = L / sqrt( 24 )
@@ -1366,10 +1521,13 @@ namespace internal {
 		const Point p3( (float)( center.x ), (float)( center.y + radius + margin ), (float)( center.z + h2 + margin ) );
 		const Point p4( (float)( center.x ), (float)( center.y + radius - h1 - h2 + margin ), (float)( center.z ) );
 
-		t.v[ 0 ] = pointSet.append( p1 );
-		t.v[ 1 ] = pointSet.append( p2 );
-		t.v[ 2 ] = pointSet.append( p3 );
-		t.v[ 3 ] = pointSet.append( p4 );
+		vertices.containing[ 0 ] = p1;
+		vertices.containing[ 1 ] = p2;
+		vertices.containing[ 2 ] = p3;
+		vertices.containing[ 3 ] = p4;
+		for( int i = 0; i < 4; i++ ) {
+			t.v[ i ] = (int)vertices.firstContainingVertex() + i;
+		}
 	}
 	/*
 	================
@@ -1383,14 +1541,90 @@ namespace internal {
 		const tetrahedron_t& T = tetrahedra[ iT ];
 		assert( T.isValid() && "IsValid(T)" );
 		if( T.neighbors[ f ] >= 0 ) { // adjust our neighbor's vicinity
-			tetrahedron_t& n = tetrahedra[ T.neighbors[ f ] ];
+			tetrahedron_t& n = tetrahedra[ T.neighbor( f ) ];
 			if ( n.isValid() ) {
+#if _DEBUG
 				int v[3];
 				T.getFaceVertices( f, v[0], v[1], v[2] );
-				const int sharedFace = Tetrahedron::getFaceFromVertices( n, v[0], v[2], v[1] ); // reverse face
-				assert( sharedFace >= 0 && "sharedFace >= 0" );
-				n.neighbors[ sharedFace ] = iT;
+				assert( Tetrahedron::getFaceFromVertices( n, v[0], v[2], v[1] ) == T.neighborFace( f ) && "sharedFace == neighborFace" );
+#endif
+				n.neighbors[ T.neighborFace( f ) ] = Tetrahedron::pack( iT, f );
+			}
+		}
+	}
+
+	/*
+	================
+	Delaunay3D::Compact
+
+	Moves the valid tetrahedra down over the destroyed ones, keeping their 
+	relative order, and remaps the neighbor references accordingly. Faces
+	facing a destroyed tetrahedron are left open.
+	================
+	*/
+	void compact( CoreLib::List< tetrahedron_t >& tetrahedra ) {
+		CoreLib::List< int > remap;
+		remap.resize( tetrahedra.size() );
+		int numValid = 0;
+		for( size_t i = 0; i < tetrahedra.size(); i++ ) {
+			remap[ (unsigned int)i ] = tetrahedra[ (unsigned int)i ].isValid() ? numValid++ : -1;
+		}
+
+		for( size_t i = 0; i < tetrahedra.size(); i++ ) {
+			if ( remap[ (unsigned int)i ] < 0 ) {
+				continue;
+			}
+			tetrahedron_t& t = tetrahedra[ remap[ (unsigned int)i ] ];
+			t = tetrahedra[ (unsigned int)i ];
+			for( int f = 0; f < 4; f++ ) {
+				if ( t.neighbors[ f ] >= 0 ) {
+					const int n = remap[ t.neighbor( f ) ];
+					t.neighbors[ f ] = n >= 0 ? Tetrahedron::pack( n, t.neighborFace( f ) ) : -1;
+				}
+			}
+		}
+		tetrahedra.resize( numValid );
+	}
+
+	/*
+	================
+	Delaunay3D::DiscardContaining
+	================
+	*/
+	void discardContaining( CoreLib::List< tetrahedron_t >& tetrahedra, const size_t numSrcPoints ) {
+		for( size_t i = 0; i < tetrahedra.size(); i++ ) {
+			tetrahedron_t& t = tetrahedra[ (unsigned int)i ];
+			for( int j = 0; j < 4; j++ ) {
+				if ( t.v[ j ] >= (int)numSrcPoints ) {
+					Tetrahedron::markInvalid( t );
+					break;
+				}
+			}
+		}
+		compact( tetrahedra );
+	}
+
+	/*
+	================
+	walkState_t::newEpoch
+	================
+	*/
+	void walkState_t::newEpoch( const size_t numTetrahedra ) {
+		if ( visitedEpoch.size() < numTetrahedra ) {
+			// grow geometrically, so that the stamps are not reallocated on every insertion
+			const size_t prevSize = visitedEpoch.size();
+			visitedEpoch.resize( std::max( numTetrahedra, 2 * prevSize ), true );
+			for( size_t i = prevSize; i < visitedEpoch.size(); i++ ) {
+				visitedEpoch[ (unsigned int)i ] = 0;
+			}
+		}
+		epoch++;
+		if ( epoch == 0 ) {
+			// wrapped around, clear the old stamps
+			for( size_t i = 0; i < visitedEpoch.size(); i++ ) {
+				visitedEpoch[ (unsigned int)i ] = 0;
 			}
+			epoch = 1;
 		}
 	}
 
@@ -1399,76 +1633,91 @@ namespace internal {
 	Delaunay3D::Walk
 
 	Returns the index of the tetrahedron containing p, or -1 if not found. 
-	It retrieves the result by searching from a given sourceT tetrahedron index. 
+	Remembering stochastic walk: starting from the tetrahedron created by the 
+	last insertion (or a closer one among a few random samples), step through 
+	any face p lies in front of, testing the faces in random order so that the 
+	walk can't cycle.
 	================
 	*/
-	int walk( const Point& p, const int sourceT, 
-			  const CoreLib::List< Point >& vertices,
+	int walk( const Point& p, walkState_t& state,
+			  const vertexSet_t& vertices,
 			  const CoreLib::List< tetrahedron_t >& tetrahedra ) {
-		if ( sourceT < 0 || (size_t)sourceT >= tetrahedra.size() ) {
+		if ( tetrahedra.size() == 0 ) {
 			assert( false );
 			return -1;
 		}
 
-		CoreLib::List< bool > visited;
-		visited.resize( tetrahedra.size(), true );
-		for( size_t i = 0; i < tetrahedra.size(); i++ ) {
-			visited[ (unsigned int)i ] = false;
+		// pick the starting tetrahedron. The last one created may have been destroyed 
+		// by further flips, in which case we'll start from the latest valid one
+		int t = state.lastTetrahedron;
+		if ( t < 0 || (size_t)t >= tetrahedra.size() || !tetrahedra[ t ].isValid() ) {
+			t = (int)tetrahedra.size() - 1;
+			while( t > 0 && !tetrahedra[ t ].isValid() ) {
+				t--;
+			}
+		}
+		if ( state.jumpSamples > 0 ) {
+			REAL closest = vertices[ tetrahedra[ t ].v[ 0 ] ].distanceSquaredTo( p );
+			for( int i = 0; i < state.jumpSamples; i++ ) {
+				const int sample = (int)( state.random() % tetrahedra.size() );
+				const tetrahedron_t& T = tetrahedra[ sample ];
+				if ( T.isValid() ) {
+					const REAL dist = vertices[ T.v[ 0 ] ].distanceSquaredTo( p );
+					if ( dist < closest ) {
+						closest = dist;
+						t = sample;
+					}
+				}
+			}
 		}
-		CoreLib::List< int > traversal( 64 );
-		
-		int t = sourceT;
+
+		state.newEpoch( tetrahedra.size() );
 
 		while( true ) {
 			
 			const tetrahedron_t& tetrahedron = tetrahedra[ t ];
-			visited[ t ] = true;
-			traversal.append( t );
-			bool step = false;
-
-			if ( tetrahedron.isValid() ) {
-
-				if ( inside( p, tetrahedron, vertices ) ) {
-					return t;
-				}
-
-				// pick adjacent neighbor such as p lies on the positive side
-				// of their shared face
-				int a, b, c;
-				for( int i = 0; i < 4; i++ ) {
-					if ( tetrahedron.neighbors[ i ] >= 0 ) {
-						if ( visited[ tetrahedron.neighbors[ i ] ] ) {
-							continue;
-						}
-						tetrahedron.getFaceVertices( i, a, b, c );
-						if ( orient( vertices[ a ], vertices[ b ], vertices[ c ], p ) > 0 ) {
-							t = tetrahedron.neighbors[ i ];
-							step = true;
-							break;
-						}
-					}
-				}
+			state.visitedEpoch[ t ] = state.epoch;
+			
+			if ( !tetrahedron.isValid() ) {
+				break;
+			}
+			if ( inside( p, tetrahedron, vertices ) ) {
+				return t;
 			}
 
-			if ( !step ) {
-				// we reached a dead end. Retry from another source tetrahedron
-
-				bool found = false;
-				for( size_t i = 0; i < visited.size(); i++ ) {
-					if ( !visited[ (unsigned int)i ] ) {
-						t = (int)i;
-						found = true;
+			// pick adjacent neighbor such as p lies on the positive side
+			// of their shared face
+			int next = -1;
+			int a, b, c;
+			const int firstFace = (int)( state.random() & 3 );
+			for( int j = 0; j < 4; j++ ) {
+				const int i = ( firstFace + j ) & 3;
+				const int neighbor = tetrahedron.neighbor( i );
+				if ( neighbor >= 0 ) {
+					if ( state.visited( neighbor ) ) {
+						continue;
+					}
+					tetrahedron.getFaceVertices( i, a, b, c );
+					if ( orient( vertices[ a ], vertices[ b ], vertices[ c ], p ) > 0 ) {
+						next = neighbor;
 						break;
 					}
 				}
+			}
+			if ( next < 0 ) {
+				break;
+			}
+			t = next;
+		}
 
-				traversal.resize( 0, false );
-
-				if ( !found ) {
-					assert( false );
-					return -1;
-				}
-			}			
+		// We reached a dead end, which may only happen on degenerate configurations 
+		// (flat tetrahedra, or p right upon a face). Test the tetrahedra we haven't 
+		// visited yet one by one.
+		for( size_t i = 0; i < tetrahedra.size(); i++ ) {
+			if ( !state.visited( (int)i ) && tetrahedra[ (unsigned int)i ].isValid() && 
+				 inside( p, tetrahedra[ (unsigned int)i ], vertices ) ) {
+				return (int)i;
+			}
 		}
 		
 		assert( false );
@@ -1487,8 +1736,9 @@ namespace internal {
 	*/
 	
 	void flip( const int iT, const int iTa, const int p,
-			   const CoreLib::List< Point >& vertices, 
+			   const vertexSet_t& vertices, 
 			   CoreLib::List< tetrahedron_t >& tetrahedra,
+			   CoreLib::List< unsigned int >& freeSlots,
 			   std::stack< unsigned int >& needTesting ) {
 		
 		using namespace RenderLib::Geometry;
@@ -1520,20 +1770,25 @@ namespace internal {
 			// case 4 = a, b, c, p are coplanar. T is flat.
 			Case = 4;
 			assert( Tetrahedron::isFlat( T, vertices ) );
-		} else if ( coplanar( pA, pB, pD, pP ) ) {
-			Case = 31;
-		} else if ( coplanar( pA, pC, pD, pP ) ) {
-			Case = 32;
-		} else if ( coplanar( pB, pC, pD, pP ) ) {
-			Case = 33;
 		} else {
-			REAL t,v,w;
-			if ( segmentTriangleIntersect_DoubleSided( pP, pD, pA, pB, pC, t, v, w ) ) {
+			// p and d lie on opposite sides of abc, so the segment p-d crosses the face 
+			// iff a, b and c all turn the same way around it, and crosses an edge iff 
+			// the edge lies in the plane through p and d and the other two turn the same way
+			const REAL ab = orient( pA, pB, pP, pD );
+			const REAL bc = orient( pB, pC, pP, pD );
+			const REAL ca = orient( pC, pA, pP, pD );
+			if ( ( ab > 0 && bc > 0 && ca > 0 ) || ( ab < 0 && bc < 0 && ca < 0 ) ) {
 				// the segment p-d crosses the shared face. Therefore the union between T and Ta
 				// is convex
 				Case = 1;
+			} else if ( ab == 0 && ( ( bc > 0 && ca > 0 ) || ( bc < 0 && ca < 0 ) ) ) {
+				Case = 31;
+			} else if ( ca == 0 && ( ( ab > 0 && bc > 0 ) || ( ab < 0 && bc < 0 ) ) ) {
+				Case = 32;
+			} else if ( bc == 0 && ( ( ab > 0 && ca > 0 ) || ( ab < 0 && ca < 0 ) ) ) {
+				Case = 33;
 			} else {
-				// the segment p-d does not cross the shared face
+				// the segment p-d misses the shared face, or goes through one of its vertices
 				Case = 2;
 			}
 		}
@@ -1552,7 +1807,7 @@ namespace internal {
 					// polyhedron. In this case, a flip23 is performed.
 
 					unsigned int result[3];
-					if ( flip23( iT, iTa, tetrahedra, vertices, result ) ) {
+					if ( flip23( iT, iTa, tetrahedra, freeSlots, vertices, result ) ) {
 						for( int i = 0; i < 3; i++ ) {
 							needTesting.push( result[ i ] );
 						} 
@@ -1614,8 +1869,8 @@ namespace internal {
 						}
 #endif
 						if ( abp >= 0 && bap >= 0 ) {
-							const int iTb1 = T.neighbors[ abp ];
-							const int iTb2 = Ta.neighbors[ bap ];
+							const int iTb1 = T.neighbor( abp );
+							const int iTb2 = Ta.neighbor( bap );
 							if ( iTb1 >= 0 && iTb1 == iTb2 ) {
 #if _DEBUG
 								tetrahedron_t& Tb = tetrahedra[ iTb1 ];								
@@ -1623,7 +1878,7 @@ namespace internal {
 #endif
 								fixed = true;
 								unsigned int result[2];
-								flip32( iT, iTa, iTb1, tetrahedra, vertices, result );
+								flip32( iT, iTa, iTb1, tetrahedra, freeSlots, vertices, result );
 								needTesting.push( result[ 0 ] );
 								needTesting.push( result[ 1 ] );
 							}
@@ -1632,7 +1887,7 @@ namespace internal {
 
 					if ( !fixed ) {
 						unsigned int result[3];
-						if ( flip23( iT, iTa, tetrahedra, vertices, result ) ) {
+						if ( flip23( iT, iTa, tetrahedra, freeSlots, vertices, result ) ) {
 							for( int i = 0; i < 3; i++ ) {
 								needTesting.push( result[ i ] );
 							} 
@@ -1674,8 +1929,8 @@ namespace internal {
 						}
 #endif
 						if ( abp >= 0 && bap >= 0 ) {
-							const int iTb1 = T.neighbors[ abp ];
-							const int iTb2 = Ta.neighbors[ bap ];
+							const int iTb1 = T.neighbor( abp );
+							const int iTb2 = Ta.neighbor( bap );
 							if ( iTb1 >= 0 && iTb1 == iTb2 ) {
 #if _DEBUG
 								tetrahedron_t& Tb = tetrahedra[ iTb1 ];								
@@ -1683,7 +1938,7 @@ namespace internal {
 #endif
 								fixed = true;
 								unsigned int result[2];
-								flip32( iT, iTa, iTb1, tetrahedra, vertices, result );
+								flip32( iT, iTa, iTb1, tetrahedra, freeSlots, vertices, result );
 								needTesting.push( result[ 0 ] );
 								needTesting.push( result[ 1 ] );
 								assert( tetrahedra[ result[ 0 ] ].containsVertex( a ) || tetrahedra[ result[ 1 ] ].containsVertex( a ) );
@@ -1740,8 +1995,8 @@ namespace internal {
 					int faceTa = Tetrahedron::getFaceFromVertices( Ta, sharedSegmentB, sharedSegmentA, d );
 					assert( faceT >= 0 && faceTa >= 0 );
 
-					int iNeighborT = T.neighbors[ faceT ];
-					int iNeighborTa = Ta.neighbors[ faceTa ];
+					int iNeighborT = T.neighbor( faceT );
+					int iNeighborTa = Ta.neighbor( faceTa );
 					if ( iNeighborT >= 0 && iNeighborTa >= 0 ) {
 						tetrahedron_t& Tb = tetrahedra[ iNeighborT ];
 						tetrahedron_t& Tc = tetrahedra[ iNeighborTa ];
@@ -1763,16 +2018,19 @@ namespace internal {
 							}
 #endif
 							// Flip44 can be symmetrical around the edge sharedSegmentA <-> sharedSegmentB, so the flat plane
-							// can be [ ssA, ssB, c, d ] or it's 90deg rotation [ ssA, ssB, pD, pP ]
-							if ( coplanar( vertices[ sharedSegmentA ], vertices[ sharedSegmentB ], vertices[ c ], vertices[ d ] ) ) {
+							// can be [ ssA, ssB, pD, pP ] or it's 90deg rotation [ ssA, ssB, c, d ]. The former always holds 
+							// here and must win when both do (an octahedron, common on lattices): only the edge p-d removes 
+							// the face abc, while swapping to the edge c-d just trades the diagonal of the other plane and 
+							// the next test swaps it back
+							if ( coplanar( vertices[ sharedSegmentA ], vertices[ sharedSegmentB ], pD, pP ) ) {
 								unsigned int result[4];
-								flip44( iT, iTa, iNeighborT, iNeighborTa, tetrahedra, vertices, result );
+								flip44( iT, iNeighborT, iTa, iNeighborTa, tetrahedra, vertices, result );
 								for( int i = 0; i < 4; i++ ) {
 									needTesting.push( result[ i ] );
 								}
-							} else if ( coplanar( vertices[ sharedSegmentA ], vertices[ sharedSegmentB ], pD, pP ) ) {
+							} else if ( coplanar( vertices[ sharedSegmentA ], vertices[ sharedSegmentB ], vertices[ c ], vertices[ d ] ) ) {
 								unsigned int result[4];
-								flip44( iT, iNeighborT, iTa, iNeighborTa, tetrahedra, vertices, result );
+								flip44( iT, iTa, iNeighborT, iNeighborTa, tetrahedra, vertices, result );
 								for( int i = 0; i < 4; i++ ) {
 									needTesting.push( result[ i ] );
 								}
@@ -1789,40 +2047,145 @@ namespace internal {
 		}
 	}
 
+	/*
+	================
+	Delaunay3D::GrowStatus
+	================
+	*/
+	void growStatus( CoreLib::List< char >& status, const size_t numTetrahedra ) {
+		if ( status.size() < numTetrahedra ) {
+			const size_t prevSize = status.size();
+			status.resize( std::max( numTetrahedra, 2 * prevSize ), true );
+			for( size_t i = prevSize; i < status.size(); i++ ) {
+				status[ (unsigned int)i ] = 0;
+			}
+		}
+	}
+
+	/*
+	================
+	Delaunay3D::FillCavity
+	================
+	*/
+	void fillCavity( const int pointIndex, CoreLib::List< tetrahedron_t >& tetrahedra, 
+					 CoreLib::List< unsigned int >& freeSlots, walkState_t& walkState, cavityState_t& cavityState ) {
+
+		CoreLib::List< char >& status = cavityState.status;
+		const CoreLib::List< int >& cavity = cavityState.cavity;
+		CoreLib::List< cavityFace_t >& boundary = cavityState.boundary;
+		boundary.clear();
+		for( size_t i = 0; i < cavity.size(); i++ ) {
+			const tetrahedron_t& T = tetrahedra[ cavity[ (unsigned int)i ] ];
+			for( int f = 0; f < 4; f++ ) {
+				const int n = T.neighbor( f );
+				if ( n < 0 || status[ n ] != 1 ) {
+					cavityFace_t& face = boundary.append();
+					T.getFaceVertices( f, face.v[ 0 ], face.v[ 1 ], face.v[ 2 ] );
+					face.neighbor = T.neighbors[ f ];
+				}
+			}
+		}
+
+		for( size_t i = 0; i < cavity.size(); i++ ) {
+			const int iT = cavity[ (unsigned int)i ];
+			status[ iT ] = 0;
+			Tetrahedron::markInvalid( tetrahedra[ iT ] );
+			freeSlots.append( iT );
+		}
+
+		// join every boundary face to p. The face winds outwards from the cavity and p lies 
+		// behind it, so face 0 of the new tetrahedron is correctly oriented as is
+		CoreLib::List< cavityEdge_t >& edges = cavityState.edges;
+		edges.clear();
+		cavityState.created.clear();
+		for( size_t i = 0; i < boundary.size(); i++ ) {
+			const cavityFace_t& face = boundary[ (unsigned int)i ];
+			const int iT = (int)Tetrahedron::allocate( tetrahedra, freeSlots );
+			cavityState.created.append( iT );
+			tetrahedron_t& T = tetrahedra[ iT ];
+			memcpy( T.v, face.v, 3 * sizeof( int ) );
+			T.v[ 3 ] = pointIndex;
+			T.neighbors[ 0 ] = face.neighbor;
+			if ( face.neighbor >= 0 ) {
+				tetrahedra[ face.neighbor >> 2 ].neighbors[ face.neighbor & 3 ] = Tetrahedron::pack( iT, 0 );
+			}
+			// faces 1, 2 and 3 hold p and the edges v0-v1, v1-v2 and v2-v0 respectively
+			for( int e = 0; e < 3; e++ ) {
+				cavityEdge_t& edge = edges.append();
+				edge.a = std::min( face.v[ e ], face.v[ ( e + 1 ) % 3 ] );
+				edge.b = std::max( face.v[ e ], face.v[ ( e + 1 ) % 3 ] );
+				edge.face = Tetrahedron::pack( iT, e + 1 );
+			}
+			if ( i == 0 ) {
+				walkState.lastTetrahedron = iT; // the next point will likely be found nearby
+			}
+		}
+
+		// the boundary is a closed surface, so each edge is shared by exactly two new tetrahedra
+		std::sort( &edges[ 0 ], &edges[ 0 ] + edges.size() );
+		for( size_t i = 0; i + 1 < edges.size(); i += 2 ) {
+			const cavityEdge_t& e0 = edges[ (unsigned int)i ];
+			const cavityEdge_t& e1 = edges[ (unsigned int)i + 1 ];
+			assert( e0.a == e1.a && e0.b == e1.b );
+			Tetrahedron::link( tetrahedra, e0.face >> 2, e0.face & 3, e1.face >> 2, e1.face & 3 );
+		}
+	}
+
 	/*
 	================
 	Delaunay3D::InsertOnePoint
 	================
 	*/
-	void insertOnePoint( const CoreLib::List< Point >& vertices, const int pointIndex, 
-						 CoreLib::List< tetrahedron_t >& tetrahedra ) {
+	bool insertOnePoint( const vertexSet_t& vertices, const int pointIndex, 
+						 CoreLib::List< tetrahedron_t >& tetrahedra, CoreLib::List< unsigned int >& freeSlots, 
+						 walkState_t& walkState, cavityState_t& cavityState ) {
 		
+		const Point& p = vertices[ pointIndex ];
+
 		// Find the tetrahedron containing pointIndex
-		int t = walk( vertices[ pointIndex ], 0, vertices, tetrahedra );
+		const int t = walk( p, walkState, vertices, tetrahedra );
 		if ( t < 0 ) {
 			assert( false );
-			return;
+			return false;
 		}
-		
-		// Insert pointIndex into t using a flip14
-		unsigned int result[4];
-		flip14( pointIndex, t, tetrahedra, vertices, result );
-
-		std::stack< unsigned int > stack;
 		for( int i = 0; i < 4; i++ ) {
-			stack.push( result[ i ] );
+			if ( vertices[ tetrahedra[ t ].v[ i ] ] == p ) {
+				return false; // duplicated point, already in the tessellation
+			}
 		}
 
-		while( !stack.empty() ) {
-#if _DEBUG && 0
-			{
-				for( int i  = 0; i < (int)stack.size() - 1; i++ ) {
-					for( unsigned int j = i + 1 ; j < stack.size(); j++ ) {
-						assert( stack._Get_container()[ i ] != stack._Get_container()[ j ] );		
+		// Split every tetrahedron whose closure contains p: t alone if p lies strictly inside 
+		// it (flip14), t and its neighbor if p lies on a face (flip26), or all the tetrahedra 
+		// around the edge p lies on (flip n-2n). Splitting t alone in the degenerate cases 
+		// would leave flat tetrahedra behind, and flipping them out can cycle forever
+		CoreLib::List< char >& status = cavityState.status;
+		growStatus( status, tetrahedra.size() );
+		CoreLib::List< int >& star = cavityState.cavity;
+		star.clear();
+		star.append( t );
+		status[ t ] = 1;
+		int a, b, c;
+		for( size_t i = 0; i < star.size(); i++ ) {
+			const tetrahedron_t& T = tetrahedra[ star[ (unsigned int)i ] ];
+			for( int f = 0; f < 4; f++ ) {
+				const int n = T.neighbor( f );
+				if ( n >= 0 && status[ n ] == 0 ) {
+					T.getFaceVertices( f, a, b, c );
+					if ( orient( vertices[ a ], vertices[ b ], vertices[ c ], p ) == 0 ) {
+						status[ n ] = 1;
+						star.append( n );
 					}
 				}
 			}
-#endif
+		}
+		fillCavity( pointIndex, tetrahedra, freeSlots, walkState, cavityState );
+
+		std::stack< unsigned int > stack;
+		for( size_t i = 0; i < cavityState.created.size(); i++ ) {
+			stack.push( cavityState.created[ (unsigned int)i ] );
+		}
+
+		while( !stack.empty() ) {
 			// T = { a, b, c, p }
 			const int iT = stack.top();
 			stack.pop();
@@ -1846,54 +2209,957 @@ namespace internal {
 
 			// Get adjacent tetrahedron Ta having a,b,c as a facet
 			if ( T.neighbors[ face ] >= 0 ) {
-				const int iTa = T.neighbors[ face ];
+				const int iTa = T.neighbor( face );
 				tetrahedron_t& Ta = tetrahedra[ iTa ];			
 				assert( Ta.isValid() );
 
-				int a,b,c;
-				T.getFaceVertices( face, a, b, c );
-				const int sharedFace = Tetrahedron::getFaceFromVertices( Ta, a, c, b ); // reverse face
+				const int sharedFace = T.neighborFace( face );
 				const int opposedVertex = Tetrahedron::getVertexOutsideFace( Ta, sharedFace );
-
-				// OpposedVertex CAN be pointIndex in a degenerate Case 1, where two adjacent tetrahedra also share
-				// the vertex opposed to their shared face (that is, they're effectively the same tetrahedron with the 
-				// faces declared in a different order). This can happen after inserting a vertex in the face of an existing
-				// tetrahedron and causing N chained Case 4 till we close the cycle and reach the original point again.
-				// This degenerate Case1 will generate 3 new (smaller) flat tetrahedra, that should eventually go away
-				// with further flips
-				// ! don't --> assert( opposedVertex != pointIndex );
+				assert( opposedVertex != pointIndex );
 
 				const Point& d = vertices[ opposedVertex ];
 				
-				// If d is inside the circumference of T then flip 
-				const Point& T0 = vertices[ T.v[ 0 ] ];
-				const Point& T1 = vertices[ T.v[ 2 ] ];
-				const Point& T2 = vertices[ T.v[ 1 ] ];
-				const Point& T3 = vertices[ T.v[ 3 ] ];							
-
+				// If d is inside the circumsphere of T then flip. The faces wind outwards, so 
+				// v0 v2 v1 v3 lies in the positive orientation inSphere expects. The perturbed
+				// predicate breaks the ties of cospherical points the same way every time, 
+				// so that lattices can't make the flips cycle
 				const bool doFlip =	Tetrahedron::isFlat( T, vertices ) || // if our tetrahedron is flat, it is not valid and we must flip it
-									( orient( T0, T1, T2, T3 ) >= 0 && inSphere( T0, T1, T2, T3, d ) > 0 ) || 
-									( orient( T0, T2, T1, T3 ) >= 0 && inSphere( T0, T2, T1, T3, d ) > 0 );				
+									inSpherePerturbed( vertices[ T.v[ 0 ] ], vertices[ T.v[ 2 ] ], vertices[ T.v[ 1 ] ], vertices[ T.v[ 3 ] ], d ) > 0;
 				if ( doFlip ) {
-					flip( iT, iTa, pointIndex, vertices, tetrahedra, stack );
+					flip( iT, iTa, pointIndex, vertices, tetrahedra, freeSlots, stack );
 				}
 			}
 		}
+		return true;
 	}
 
-	int intCompare( const void* p0, const void* p1 ) {
-		return *(static_cast< const int* >(p0)) - *(static_cast< const int* >(p1));  
-	}
-
-
-} // namespace internal
+	/*
+	================
+	Delaunay3D::InsertOnePointCavity
+	================
+	*/
+	bool insertOnePointCavity( const vertexSet_t& vertices, const int pointIndex, 
+							   CoreLib::List< tetrahedron_t >& tetrahedra, CoreLib::List< unsigned int >& freeSlots, 
+							   walkState_t& walkState, cavityState_t& cavityState ) {
+
+		const Point& p = vertices[ pointIndex ];
+
+		// Find the tetrahedron containing pointIndex
+		const int t = walk( p, walkState, vertices, tetrahedra );
+		if ( t < 0 ) {
+			assert( false );
+			return false;
+		}
+		for( int i = 0; i < 4; i++ ) {
+			if ( vertices[ tetrahedra[ t ].v[ i ] ] == p ) {
+				return false; // duplicated point, already in the tessellation
+			}
+		}
+
+		CoreLib::List< char >& status = cavityState.status;
+		growStatus( status, tetrahedra.size() );
+
+		// grow the cavity breadth-first from t. Since the tessellation is Delaunay, the 
+		// tetrahedra in conflict form a connected region, star-shaped from p, and p lies
+		// strictly in front of every one of its boundary faces
+		CoreLib::List< int >& cavity = cavityState.cavity;
+		CoreLib::List< int >& outside = cavityState.outside;
+		cavity.clear();
+		outside.clear();
+
+		cavity.append( t );
+		status[ t ] = 1;
+		for( size_t i = 0; i < cavity.size(); i++ ) {
+			const tetrahedron_t& T = tetrahedra[ cavity[ (unsigned int)i ] ];
+			for( int f = 0; f < 4; f++ ) {
+				const int n = T.neighbor( f );
+				if ( n >= 0 && status[ n ] == 0 ) {
+					const tetrahedron_t& N = tetrahedra[ n ];
+					// faces wind outwards, so v0 v2 v1 v3 lies in the positive orientation inSphere expects
+					if ( inSpherePerturbed( vertices[ N.v[ 0 ] ], vertices[ N.v[ 2 ] ], vertices[ N.v[ 1 ] ], vertices[ N.v[ 3 ] ], p ) > 0 ) {
+						status[ n ] = 1;
+						cavity.append( n );
+					} else {
+						status[ n ] = 2;
+						outside.append( n );
+					}
+				}
+			}
+		}
+
+		for( size_t i = 0; i < outside.size(); i++ ) {
+			status[ outside[ (unsigned int)i ] ] = 0;
+		}
+		fillCavity( pointIndex, tetrahedra, freeSlots, walkState, cavityState );
+		return true;
+	}
+
+	int intCompare( const void* p0, const void* p1 ) {
+		return *(static_cast< const int* >(p0)) - *(static_cast< const int* >(p1));  
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Parallel tessellation
+	//
+	// The points are split into cells which are tessellated concurrently, 
+	// all of them inside the same containing tetrahedron. A tetrahedron of 
+	// a cell whose circumsphere is empty of every point, not only those of 
+	// its cell, belongs to the global tessellation as is. Every missing 
+	// tetrahedron has its 4 vertices among those of the remaining, 
+	// unconfirmed ones: given such a missing tetrahedron and its vertices 
+	// within a cell, the empty spheres through those vertices in the cell 
+	// tessellation are blends of the circumspheres of the cell tetrahedra 
+	// incident to them, so at least one of these has to reach the vertices
+	// lying in other cells. The unconfirmed vertices, a thin layer along the
+	// cell borders, are then tessellated together and the missing 
+	// tetrahedra picked by the same empty sphere test.
+	//////////////////////////////////////////////////////////////////////////
+
+	/*
+	================
+	Delaunay3D::TetrahedralizeSubset
+	================
+	*/
+	void tetrahedralizeSubset( const vertexSet_t& vertices, const std::vector< unsigned int >& subset, 
+							   const tetrahedron_t& containingT, const Delaunay3D::InsertionKernel_t kernel, 
+							   CoreLib::List< tetrahedron_t >& tetrahedra ) {
+		tetrahedra.clear();
+		tetrahedra.setGranularity( 8 * subset.size() + 1 );
+		tetrahedra.append( containingT );
+		if ( subset.empty() ) {
+			return;
+		}
+
+		std::vector< Point > points( subset.size() );
+		for( size_t i = 0; i < subset.size(); i++ ) {
+			points[ i ] = vertices[ subset[ i ] ];
+		}
+		CoreLib::List< unsigned int > order;
+		brioSort( &points[ 0 ], points.size(), order );
+
+		walkState_t walkState;
+		cavityState_t cavityState;
+		CoreLib::List< unsigned int > freeSlots;
+		for( size_t i = 0; i < subset.size(); i++ ) {
+			const int pointIndex = (int)subset[ order[ (unsigned int)i ] ];
+			if ( kernel == Delaunay3D::INSERTION_KERNEL_CAVITY ) {
+				insertOnePointCavity( vertices, pointIndex, tetrahedra, freeSlots, walkState, cavityState );
+			} else {
+				insertOnePoint( vertices, pointIndex, tetrahedra, freeSlots, walkState, cavityState );
+			}
+		}
+	}
+
+	/*
+	================
+	Delaunay3D::SplitCells
+	================
+	*/
+	void splitCells( const vertexSet_t& vertices, unsigned int* begin, unsigned int* end, 
+					 const Point& boundsMin, const Point& boundsMax, const int levels, std::vector< cell_t >& cells ) {
+		if ( levels == 0 || end - begin < 2 ) {
+			cells.push_back( cell_t() );
+			cells.back().points.assign( begin, end );
+			cells.back().boundsMin = boundsMin;
+			cells.back().boundsMax = boundsMax;
+			return;
+		}
+
+		int axis = 0;
+		for( int i = 1; i < 3; i++ ) {
+			if ( boundsMax[ i ] - boundsMin[ i ] > boundsMax[ axis ] - boundsMin[ axis ] ) {
+				axis = i;
+			}
+		}
+
+		unsigned int* median = begin + ( end - begin ) / 2;
+		std::nth_element( begin, median, end, [ & ]( const unsigned int a, const unsigned int b ) { 
+			return vertices[ a ][ axis ] < vertices[ b ][ axis ]; 
+		} );
+		// points on the splitting plane may end up on both sides, but never strictly inside the other region
+		Point splitMax = boundsMax;
+		Point splitMin = boundsMin;
+		splitMax[ axis ] = splitMin[ axis ] = vertices[ *median ][ axis ];
+		splitCells( vertices, begin, median, boundsMin, splitMax, levels - 1, cells );
+		splitCells( vertices, median, end, splitMin, boundsMax, levels - 1, cells );
+	}
+
+	/*
+	================
+	Delaunay3D::EmptyCircumsphere
+
+	The sphere is only used to gather candidates from the tree, so its 
+	radius is padded according to how ill-conditioned the tetrahedron is. 
+	The candidates are then tested exactly.
+	================
+	*/
+	bool emptyCircumsphere( const tetrahedron_t& t, const vertexSet_t& vertices, 
+							const PointTree& tree, std::vector< PointTree::Index_t >& candidates, const cell_t* cell ) {
+		using namespace RenderLib::Math;
+
+		const Point& a = vertices[ t.v[ 0 ] ];
+		const Point* b = &vertices[ t.v[ 1 ] ];
+		const Point* c = &vertices[ t.v[ 2 ] ];
+		const Point& d = vertices[ t.v[ 3 ] ];
+		const REAL orientation = orient( a, *b, *c, d );
+		if ( orientation == 0 ) {
+			return false; // flat, no circumsphere
+		} else if ( orientation < 0 ) {
+			std::swap( b, c );
+		}
+
+		const Vector3< REAL > ba = *b - a;
+		const Vector3< REAL > ca = *c - a;
+		const Vector3< REAL > da = d - a;
+		const REAL det = Vector3< REAL >::dot( ba, Vector3< REAL >::cross( ca, da ) );
+		const Vector3< REAL > offset = ( Vector3< REAL >::cross( ca, da ) * ba.lengthSquared() + 
+										 Vector3< REAL >::cross( da, ba ) * ca.lengthSquared() + 
+										 Vector3< REAL >::cross( ba, ca ) * da.lengthSquared() ) / ( 2 * det );
+		const REAL condition = ba.length() * ca.length() * da.length() / fabs( det );
+
+		// the points on the sphere are decided by the same perturbation as the insertion kernels, 
+		// otherwise every tetrahedron of a cospherical set would be accepted, overlapping each other
+		candidates.clear();
+		if ( det != 0 && condition < 1e8 ) {
+			const Point center = a + offset;
+			const REAL radius = offset.length() * ( 1 + 1e-10 * condition );
+			if ( cell != NULL ) {
+				bool inside = true;
+				for( int axis = 0; axis < 3; axis++ ) {
+					inside &= center[ axis ] - radius > cell->boundsMin[ axis ] && center[ axis ] + radius < cell->boundsMax[ axis ];
+				}
+				if ( inside ) {
+					return true;
+				}
+			}
+			tree.withinRadius( center, radius, candidates );
+			for( size_t i = 0; i < candidates.size(); i++ ) {
+				// the vertices of t lie on the sphere, skip them to avoid the exact evaluation
+				if ( !t.containsVertex( (int)candidates[ i ] ) && inSpherePerturbed( a, *b, *c, d, vertices[ candidates[ i ] ] ) > 0 ) {
+					return false;
+				}
+			}
+		} else {
+			// too close to flat to trust the sphere, test every vertex
+			for( size_t i = 0; i < vertices.size(); i++ ) {
+				if ( !t.containsVertex( (int)i ) && inSpherePerturbed( a, *b, *c, d, vertices[ (unsigned int)i ] ) > 0 ) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	/*
+	================
+	Delaunay3D::ConnectNeighbors
+	================
+	*/
+	struct faceKey_t {
+		int		v[ 3 ];	// sorted vertex indices
+		int		face;	// reference to the face, packed as in tetrahedron_t::neighbors
+
+		bool operator<( const faceKey_t& other ) const {
+			if ( v[ 0 ] != other.v[ 0 ] ) return v[ 0 ] < other.v[ 0 ];
+			if ( v[ 1 ] != other.v[ 1 ] ) return v[ 1 ] < other.v[ 1 ];
+			return v[ 2 ] < other.v[ 2 ];
+		}
+		bool sameFace( const faceKey_t& other ) const {
+			return v[ 0 ] == other.v[ 0 ] && v[ 1 ] == other.v[ 1 ] && v[ 2 ] == other.v[ 2 ];
+		}
+	};
+
+	bool connectNeighbors( CoreLib::List< tetrahedron_t >& tetrahedra ) {
+		std::vector< faceKey_t > faces( 4 * tetrahedra.size() );
+		for( size_t i = 0; i < tetrahedra.size(); i++ ) {
+			tetrahedron_t& t = tetrahedra[ (unsigned int)i ];
+			for( int f = 0; f < 4; f++ ) {
+				faceKey_t& key = faces[ 4 * i + f ];
+				t.getFaceVertices( f, key.v[ 0 ], key.v[ 1 ], key.v[ 2 ] );
+				std::sort( key.v, key.v + 3 );
+				key.face = Tetrahedron::pack( (int)i, f );
+				t.neighbors[ f ] = -1;
+			}
+		}
+		std::sort( faces.begin(), faces.end() );
+		for( size_t i = 0; i + 1 < faces.size(); i++ ) {
+			if ( faces[ i ].sameFace( faces[ i + 1 ] ) ) {
+				if ( i + 2 < faces.size() && faces[ i ].sameFace( faces[ i + 2 ] ) ) {
+					return false;
+				}
+				const int a = faces[ i ].face;
+				const int b = faces[ i + 1 ].face;
+				Tetrahedron::link( tetrahedra, a >> 2, a & 3, b >> 2, b & 3 );
+				i++;
+			}
+		}
+		return true;
+	}
+
+	/*
+	================
+	Delaunay3D::GatherGlobalTetrahedra_r
+
+	Appends to result the tetrahedra of the whole tessellation whose 
+	vertices all belong to subset (possibly more than once). Only when 
+	subset holds every point do the cells own their regions of space.
+	================
+	*/
+	void gatherGlobalTetrahedra_r( const vertexSet_t& vertices, const size_t numSrcPoints, 
+								   const std::vector< unsigned int >& subset, const bool ownsAllPoints,
+								   const tetrahedron_t& containingT, const Delaunay3D::InsertionKernel_t kernel, 
+								   const PointTree& tree, CoreLib::List< tetrahedron_t >& result ) {
+		using namespace RenderLib::Parallel;
+
+		const size_t grainSize = 4096;
+
+		if ( subset.size() < PARALLEL_MIN_POINTS ) {
+			// small enough, tessellate it as a whole and keep the tetrahedra with an empty circumsphere
+			CoreLib::List< tetrahedron_t > tetrahedra;
+			tetrahedralizeSubset( vertices, subset, containingT, kernel, tetrahedra );
+			std::vector< char > empty( tetrahedra.size(), 0 );
+			parallelFor( 0, tetrahedra.size(), grainSize, [ & ]( size_t begin, size_t end ) {
+				std::vector< PointTree::Index_t > candidates;
+				for( size_t i = begin; i < end; i++ ) {
+					const tetrahedron_t& t = tetrahedra[ (unsigned int)i ];
+					empty[ i ] = t.isValid() && emptyCircumsphere( t, vertices, tree, candidates );
+				}
+			} );
+			for( size_t i = 0; i < tetrahedra.size(); i++ ) {
+				if ( empty[ i ] ) {
+					result.append( tetrahedra[ (unsigned int)i ] );
+				}
+			}
+			return;
+		}
+
+		// split the points into a power of 2 of cells, at least one per thread
+		int levels = 0;
+		while( ( 1u << levels ) < numThreads() ) {
+			levels++;
+		}
+		Point boundsMin = vertices[ subset[ 0 ] ];
+		Point boundsMax = boundsMin;
+		for( size_t i = 1; i < subset.size(); i++ ) {
+			const Point& p = vertices[ subset[ i ] ];
+			for( int axis = 0; axis < 3; axis++ ) {
+				boundsMin[ axis ] = std::min( boundsMin[ axis ], p[ axis ] );
+				boundsMax[ axis ] = std::max( boundsMax[ axis ], p[ axis ] );
+			}
+		}
+		std::vector< unsigned int > indices( subset );
+		std::vector< cell_t > cells;
+		splitCells( vertices, &indices[ 0 ], &indices[ 0 ] + indices.size(), boundsMin, boundsMax, levels, cells );
+
+		std::vector< CoreLib::List< tetrahedron_t > > cellTetrahedra( cells.size() );
+		parallelFor( 0, cells.size(), 1, [ & ]( size_t begin, size_t end ) {
+			for( size_t c = begin; c < end; c++ ) {
+				tetrahedralizeSubset( vertices, cells[ c ].points, containingT, kernel, cellTetrahedra[ c ] );
+			}
+		} );
+
+		// keep the cell tetrahedra whose circumsphere is empty. Those touching the containing 
+		// tetrahedron have huge circumspheres, so leave them to the border tessellation
+		std::vector< std::vector< char > > confirmed( cells.size() );
+		for( size_t c = 0; c < cells.size(); c++ ) {
+			const CoreLib::List< tetrahedron_t >& cellT = cellTetrahedra[ c ];
+			const cell_t* cell = ownsAllPoints ? &cells[ c ] : NULL;
+			confirmed[ c ].resize( cellT.size(), 0 );
+			parallelFor( 0, cellT.size(), grainSize, [ & ]( size_t begin, size_t end ) {
+				std::vector< PointTree::Index_t > candidates;
+				for( size_t i = begin; i < end; i++ ) {
+					const tetrahedron_t& t = cellT[ (unsigned int)i ];
+					if ( !t.isValid() ) {
+						continue;
+					}
+					bool containingVertex = false;
+					for( int j = 0; j < 4; j++ ) {
+						containingVertex |= t.v[ j ] >= (int)numSrcPoints;
+					}
+					confirmed[ c ][ i ] = !containingVertex && emptyCircumsphere( t, vertices, tree, candidates, cell );
+				}
+			} );
+		}
+
+		std::vector< char > inBorder( numSrcPoints, 0 );
+		for( size_t c = 0; c < cells.size(); c++ ) {
+			const CoreLib::List< tetrahedron_t >& cellT = cellTetrahedra[ c ];
+			for( size_t i = 0; i < cellT.size(); i++ ) {
+				const tetrahedron_t& t = cellT[ (unsigned int)i ];
+				if ( !t.isValid() ) {
+					continue;
+				}
+				if ( confirmed[ c ][ i ] ) {
+					result.append( t );
+				} else {
+					for( int j = 0; j < 4; j++ ) {
+						if ( t.v[ j ] < (int)numSrcPoints ) {
+							inBorder[ t.v[ j ] ] = 1;
+						}
+					}
+				}
+			}
+			cellTetrahedra[ c ].clear();
+		}
+
+		// the missing tetrahedra have all their vertices in the border, which is split again as 
+		// long as it keeps shrinking
+		std::vector< unsigned int > border;
+		for( size_t i = 0; i < subset.size(); i++ ) {
+			if ( inBorder[ subset[ i ] ] ) {
+				border.push_back( subset[ i ] );
+			}
+		}
+		if ( 2 * border.size() > subset.size() ) {
+			std::vector< unsigned int > whole( border );
+			CoreLib::List< tetrahedron_t > tetrahedra;
+			tetrahedralizeSubset( vertices, whole, containingT, kernel, tetrahedra );
+			std::vector< char > empty( tetrahedra.size(), 0 );
+			parallelFor( 0, tetrahedra.size(), grainSize, [ & ]( size_t begin, size_t end ) {
+				std::vector< PointTree::Index_t > candidates;
+				for( size_t i = begin; i < end; i++ ) {
+					const tetrahedron_t& t = tetrahedra[ (unsigned int)i ];
+					empty[ i ] = t.isValid() && emptyCircumsphere( t, vertices, tree, candidates );
+				}
+			} );
+			for( size_t i = 0; i < tetrahedra.size(); i++ ) {
+				if ( empty[ i ] ) {
+					result.append( tetrahedra[ (unsigned int)i ] );
+				}
+			}
+		} else {
+			gatherGlobalTetrahedra_r( vertices, numSrcPoints, border, false, containingT, kernel, tree, result );
+		}
+	}
+
+	/*
+	================
+	Delaunay3D::TetrahedralizeParallel
+	================
+	*/
+	struct tetrahedronKey_t {
+		int		v[ 4 ];	// sorted vertex indices
+		int		index;
+
+		bool operator<( const tetrahedronKey_t& other ) const {
+			return std::lexicographical_compare( v, v + 4, other.v, other.v + 4 );
+		}
+		bool sameVertices( const tetrahedronKey_t& other ) const {
+			return memcmp( v, other.v, 4 * sizeof( int ) ) == 0;
+		}
+	};
+
+	bool tetrahedralizeParallel( const vertexSet_t& vertices, const size_t numSrcPoints, 
+								 const tetrahedron_t& containingT, const Delaunay3D::InsertionKernel_t kernel, 
+								 CoreLib::List< tetrahedron_t >& tetrahedra ) {
+		PointTree tree;
+		// the containing vertices can't lie in any circumsphere tested, as all the partial
+		// tessellations include them
+		tree.build( vertices.sourcePoints(), numSrcPoints );
+
+		std::vector< unsigned int > indices( numSrcPoints );
+		for( size_t i = 0; i < numSrcPoints; i++ ) {
+			indices[ i ] = (unsigned int)i;
+		}
+		CoreLib::List< tetrahedron_t > gathered;
+		gathered.setGranularity( 8 * numSrcPoints );
+		gatherGlobalTetrahedra_r( vertices, numSrcPoints, indices, true, containingT, kernel, tree, gathered );
+
+		// a tetrahedron may have been found at several levels of the recursion
+		std::vector< tetrahedronKey_t > keys( gathered.size() );
+		for( size_t i = 0; i < gathered.size(); i++ ) {
+			memcpy( keys[ i ].v, gathered[ (unsigned int)i ].v, 4 * sizeof( int ) );
+			std::sort( keys[ i ].v, keys[ i ].v + 4 );
+			keys[ i ].index = (int)i;
+		}
+		std::sort( keys.begin(), keys.end() );
+
+		tetrahedra.clear();
+		tetrahedra.setGranularity( keys.size() );
+		for( size_t i = 0; i < keys.size(); i++ ) {
+			if ( i == 0 || !keys[ i ].sameVertices( keys[ i - 1 ] ) ) {
+				tetrahedra.append( gathered[ keys[ i ].index ] );
+			}
+		}
+		return connectNeighbors( tetrahedra );
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Tessellation
+	//////////////////////////////////////////////////////////////////////////
+
+	/*
+	================
+	Delaunay3D::Tessellate
+	================
+	*/
+	bool tessellate( vertexSet_t& vertices, const Delaunay3D::InsertionOrder_t insertionOrder, const bool parallel, 
+					 const Delaunay3D::InsertionKernel_t kernel, CoreLib::List< tetrahedron_t >& tetrahedra ) {
+		using namespace RenderLib::Math;
+		using namespace RenderLib::Geometry;
+
+		const size_t numSrcPoints = vertices.numSourcePoints();
+		if ( numSrcPoints == 0 ) { 
+			return false;
+		}
+
+		BoundingBox bounds;
+		for( size_t i = 0; i < numSrcPoints; i++ ) {
+			bounds.expand( vertices[ i ] );
+		}
+
+		Point3f center;
+		float radius;
+		containingSphere( bounds, numSrcPoints, center, radius );
+
+		// generate the tetrahedron from the sphere it contains (circumsphere)
+		tetrahedra.clear();
+		tetrahedron_t& bigT = tetrahedra.append();
+		containingTetrahedron( center, radius, bigT, vertices );
+		Tetrahedron::fixFaceOrientations( bigT, vertices );
+
+		tetrahedra.setGranularity( 4 * numSrcPoints );
+
+		walkState_t walkState;
+		cavityState_t cavityState;
+		CoreLib::List< unsigned int > freeSlots;
+		bool inserted = false;
+		if ( parallel && RenderLib::Parallel::numThreads() > 1 && numSrcPoints >= PARALLEL_MIN_POINTS ) {
+			// each cell is inserted in BRIO order regardless of insertionOrder
+			const tetrahedron_t containingT = bigT;
+			inserted = tetrahedralizeParallel( vertices, numSrcPoints, containingT, kernel, tetrahedra );
+			if ( !inserted ) {
+				// the partial tessellations overlap, start over sequentially
+				tetrahedra.clear();
+				tetrahedra.append( containingT );
+			}
+		}
+		if ( !inserted && insertionOrder == Delaunay3D::INSERTION_ORDER_BRIO ) {
+			// consecutive points are close to each other, so the walks simply 
+			// start from the last tetrahedron created
+			CoreLib::List< unsigned int > order;
+			brioSort( vertices.sourcePoints(), numSrcPoints, order );
+			for( size_t i = 0; i < numSrcPoints; i++ ) {
+				if ( kernel == Delaunay3D::INSERTION_KERNEL_CAVITY ) {
+					insertOnePointCavity( vertices, (int)order[ (unsigned int)i ], tetrahedra, freeSlots, walkState, cavityState );
+				} else {
+					insertOnePoint( vertices, (int)order[ (unsigned int)i ], tetrahedra, freeSlots, walkState, cavityState );
+				}
+			}
+		} else if ( !inserted ) {
+			// points are inserted in no particular order, so the walks start from 
+			// the closest of the last tetrahedron created and ~n^(1/4) random ones
+			walkState.jumpSamples = (int)pow( (double)numSrcPoints, 0.25 );
+			for( size_t i = 0; i < numSrcPoints; i++ ) {
+				if ( kernel == Delaunay3D::INSERTION_KERNEL_CAVITY ) {
+					insertOnePointCavity( vertices, (int)i, tetrahedra, freeSlots, walkState, cavityState );
+				} else {
+					insertOnePoint( vertices, (int)i, tetrahedra, freeSlots, walkState, cavityState );
+				}
+			}
+		}
+#if _DEBUG
+		// verify Delaunay condition (empty spheres) for all tetrahedra
+		for( size_t i = 0; i < tetrahedra.size(); i++ ) {
+			const tetrahedron_t& T = tetrahedra[ (unsigned int)i ];
+			if ( !T.isValid() ) {
+				continue;
+			}
+			const Point& T0 = vertices[ T.v[ 0 ] ];
+			const Point& T1 = vertices[ T.v[ 2 ] ];
+			const Point& T2 = vertices[ T.v[ 1 ] ];
+			const Point& T3 = vertices[ T.v[ 3 ] ];
+			for( size_t j = 0; j < vertices.size(); j++ ) {
+				assert( inSphere( T0, T1, T2, T3, vertices[ j ] ) <= 0 );
+			}
+		}
+#endif
+		// drop the slots left by the flips
+		compact( tetrahedra );
+		return true;
+	}
+
+	/*
+	================
+	Delaunay3D::EmitTetrahedra
+	================
+	*/
+	void emitTetrahedra( const CoreLib::List< tetrahedron_t >& tetrahedra, const size_t firstContaining, ITetrahedronSink& sink ) {
+		CoreLib::List< int > remap;
+		remap.resize( tetrahedra.size() );
+		int numEmitted = 0;
+		for( size_t i = 0; i < tetrahedra.size(); i++ ) {
+			const tetrahedron_t& t = tetrahedra[ (unsigned int)i ];
+			bool containingVertex = !t.isValid();
+			for( int j = 0; j < 4; j++ ) {
+				containingVertex |= (unsigned int)( t.v[ j ] - (int)firstContaining ) < 4;
+			}
+			remap[ (unsigned int)i ] = containingVertex ? -1 : numEmitted++;
+		}
+
+		sink.begin( numEmitted );
+		for( size_t i = 0; i < tetrahedra.size(); i++ ) {
+			if ( remap[ (unsigned int)i ] < 0 ) {
+				continue;
+			}
+			tetrahedron_t t( tetrahedra[ (unsigned int)i ] );
+			for( int f = 0; f < 4; f++ ) {
+				const int n = t.neighbor( f );
+				t.neighbors[ f ] = n >= 0 && remap[ n ] >= 0 ? Tetrahedron::pack( remap[ n ], t.neighborFace( f ) ) : -1;
+			}
+			sink.add( t );
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Persistent tessellation
+	//
+	// Insertions use the cavity kernel. A removal takes out the star of the 
+	// vertex, its incident tetrahedra: the faces bounding the star are faces 
+	// of the resulting tessellation, whose tetrahedra inside the hole have 
+	// circumspheres empty of every remaining vertex, so in particular of the 
+	// link vertices. The hole is thus filled by the tetrahedra of the 
+	// tessellation of the link vertices alone which lie inside it, found by 
+	// flooding from its boundary faces. Both operations only touch the 
+	// tetrahedra around the vertex.
+	//////////////////////////////////////////////////////////////////////////
+
+	/*
+	================
+	persistentState_t::VertexSet
+	================
+	*/
+	vertexSet_t persistentState_t::vertexSet() const {
+		vertexSet_t vertices( &points[ 0 ], points.size(), firstContaining );
+		for( int i = 0; i < 4; i++ ) {
+			vertices.containing[ i ] = points[ firstContaining + i ];
+		}
+		return vertices;
+	}
+
+	/*
+	================
+	Delaunay3D::Rebuild
+	================
+	*/
+	void rebuild( persistentState_t& state ) {
+		using namespace RenderLib::Math;
+
+		CoreLib::List< int > live;
+		CoreLib::List< Point > livePoints;
+		BoundingBox bounds;
+		for( int v = 0; v < (int)state.points.size(); v++ ) {
+			if ( !state.isContaining( v ) && state.vertexTetrahedron[ v ] >= 0 ) {
+				live.append( v );
+				livePoints.append( state.points[ v ] );
+				bounds.expand( state.points[ v ] );
+				state.vertexTetrahedron[ v ] = -1;
+			}
+		}
+
+		Point3f center;
+		float radius;
+		containingSphere( bounds, live.size(), center, radius );
+
+		state.tetrahedra.clear();
+		state.freeSlots.clear();
+		vertexSet_t vertices( state.vertexSet() );
+		tetrahedron_t& bigT = state.tetrahedra.append();
+		containingTetrahedron( center, radius, bigT, vertices );
+		Tetrahedron::fixFaceOrientations( bigT, vertices );
+		state.containingT = bigT;
+		for( int i = 0; i < 4; i++ ) {
+			state.points[ state.firstContaining + i ] = vertices.containing[ i ];
+			state.vertexTetrahedron[ state.firstContaining + i ] = 0;
+		}
+
+		state.walkState.lastTetrahedron = 0;
+		state.walkState.jumpSamples = 0;
+		if ( live.size() > 0 ) {
+			CoreLib::List< unsigned int > order;
+			brioSort( &livePoints[ 0 ], livePoints.size(), order );
+			for( size_t i = 0; i < live.size(); i++ ) {
+				insertVertex( state, live[ order[ (unsigned int)i ] ] );
+			}
+		}
+		// further insertions come in no particular order
+		state.walkState.jumpSamples = (int)pow( (double)live.size(), 0.25 );
+	}
+
+	/*
+	================
+	Delaunay3D::InsideContaining
+	================
+	*/
+	bool insideContaining( const persistentState_t& state, const Point& p ) {
+		return inside( p, state.containingT, state.vertexSet() );
+	}
+
+	/*
+	================
+	Delaunay3D::InsertVertex
+	================
+	*/
+	bool insertVertex( persistentState_t& state, const int vertex ) {
+		if ( !insertOnePointCavity( state.vertexSet(), vertex, state.tetrahedra, state.freeSlots, state.walkState, state.cavityState ) ) {
+			state.vertexTetrahedron[ vertex ] = -1;
+			return false;
+		}
+		// every vertex of a destroyed tetrahedron lies on the cavity boundary, hence on a new one
+		const CoreLib::List< int >& created = state.cavityState.created;
+		for( size_t i = 0; i < created.size(); i++ ) {
+			const int iT = created[ (unsigned int)i ];
+			for( int j = 0; j < 4; j++ ) {
+				state.vertexTetrahedron[ state.tetrahedra[ iT ].v[ j ] ] = iT;
+			}
+		}
+		return true;
+	}
+
+	/*
+	================
+	Delaunay3D::PlaceVertex
+	================
+	*/
+	void placeVertex( persistentState_t& state, const int vertex ) {
+		if ( insideContaining( state, state.points[ vertex ] ) ) {
+			insertVertex( state, vertex );
+		} else {
+			// the vertex can't duplicate any other, all of them lying inside
+			state.vertexTetrahedron[ vertex ] = 0;
+			rebuild( state );
+		}
+	}
+
+	/*
+	================
+	Delaunay3D::IncidentTetrahedron
+	================
+	*/
+	int incidentTetrahedron( persistentState_t& state, const int vertex ) {
+		const int hint = state.vertexTetrahedron[ vertex ];
+		if ( hint < 0 ) {
+			return -1;
+		}
+		if ( (size_t)hint < state.tetrahedra.size() && state.tetrahedra[ hint ].containsVertex( vertex ) ) {
+			return hint;
+		}
+		// stale hint, the vertex lies on the tetrahedra containing its position
+		const int t = walk( state.points[ vertex ], state.walkState, state.vertexSet(), state.tetrahedra );
+		return t >= 0 && state.tetrahedra[ t ].containsVertex( vertex ) ? t : -1;
+	}
+
+	/*
+	================
+	Delaunay3D::RemoveVertex
+	================
+	*/
+	bool removeVertex( persistentState_t& state, const int vertex ) {
+		CoreLib::List< tetrahedron_t >& tetrahedra = state.tetrahedra;
+		const int t0 = incidentTetrahedron( state, vertex );
+		if ( t0 < 0 ) {
+			return false;
+		}
+
+		// gather the star breadth-first through the faces holding the vertex. The faces 
+		// opposite to it bound the hole, wound outwards
+		CoreLib::List< char >& status = state.cavityState.status;
+		CoreLib::List< int >& star = state.star;
+		CoreLib::List< cavityFace_t >& hole = state.hole;
+		growStatus( status, tetrahedra.size() );
+		star.clear();
+		hole.clear();
+		star.append( t0 );
+		status[ t0 ] = 1;
+		for( size_t i = 0; i < star.size(); i++ ) {
+			const tetrahedron_t& T = tetrahedra[ star[ (unsigned int)i ] ];
+			for( int f = 0; f < 4; f++ ) {
+				if ( Tetrahedron::getVertexOutsideFace( T, f ) == vertex ) {
+					cavityFace_t& face = hole.append();
+					T.getFaceVertices( f, face.v[ 0 ], face.v[ 1 ], face.v[ 2 ] );
+					face.neighbor = T.neighbors[ f ];
+				} else {
+					const int n = T.neighbor( f );
+					if ( n >= 0 && status[ n ] == 0 ) {
+						status[ n ] = 1;
+						star.append( n );
+					}
+				}
+			}
+		}
+		for( size_t i = 0; i < star.size(); i++ ) {
+			status[ star[ (unsigned int)i ] ] = 0;
+		}
+
+		// tessellate the link vertices on their own, inside the same containing tetrahedron 
+		// since the tetrahedra filling the hole have circumspheres empty of its vertices too. 
+		// The containing vertices take the last local indices, whether in the link or not.
+		CoreLib::List< int >& link = state.link;
+		CoreLib::List< int >& localIndex = state.localIndex;
+		CoreLib::List< Point >& linkPoints = state.linkPoints;
+		link.clear();
+		linkPoints.clear();
+		for( size_t i = 0; i < hole.size(); i++ ) {
+			for( int j = 0; j < 3; j++ ) {
+				const int v = hole[ (unsigned int)i ].v[ j ];
+				if ( localIndex[ v ] < 0 && !state.isContaining( v ) ) {
+					localIndex[ v ] = (int)link.size();
+					link.append( v );
+					linkPoints.append( state.points[ v ] );
+				}
+			}
+		}
+		const int numLinkPoints = (int)link.size();
+		for( int i = 0; i < 4; i++ ) {
+			localIndex[ state.firstContaining + i ] = numLinkPoints + i;
+			link.append( state.firstContaining + i );
+		}
+
+		vertexSet_t linkVertices( numLinkPoints > 0 ? &linkPoints[ 0 ] : NULL, numLinkPoints );
+		CoreLib::List< tetrahedron_t >& linkTetrahedra = state.linkTetrahedra;
+		linkTetrahedra.clear();
+		tetrahedron_t& linkContainingT = linkTetrahedra.append();
+		for( int i = 0; i < 4; i++ ) {
+			linkVertices.containing[ i ] = state.points[ state.firstContaining + i ];
+			linkContainingT.v[ i ] = localIndex[ state.containingT.v[ i ] ];
+		}
+		state.linkWalkState.lastTetrahedron = 0;
+		state.linkFreeSlots.clear();
+		for( int i = 0; i < numLinkPoints; i++ ) {
+			insertOnePointCavity( linkVertices, i, linkTetrahedra, state.linkFreeSlots, state.linkWalkState, state.cavityState );
+		}
+
+		CoreLib::List< linkFace_t >& linkFaces = state.linkFaces;
+		linkFaces.clear();
+		for( size_t i = 0; i < linkTetrahedra.size(); i++ ) {
+			if ( !linkTetrahedra[ (unsigned int)i ].isValid() ) {
+				continue;
+			}
+			for( int f = 0; f < 4; f++ ) {
+				linkFace_t& face = linkFaces.append();
+				linkTetrahedra[ (unsigned int)i ].getFaceVertices( f, face.v[ 0 ], face.v[ 1 ], face.v[ 2 ] );
+				std::sort( face.v, face.v + 3 );
+				face.face = Tetrahedron::pack( (int)i, f );
+			}
+		}
+		std::sort( &linkFaces[ 0 ], &linkFaces[ 0 ] + linkFaces.size() );
+
+		// the tetrahedra inside the hole are those behind its boundary faces, and those 
+		// reached from them without crossing the boundary
+		const int NOT_A_WALL = -2;
+		CoreLib::List< int >& walls = state.walls;
+		CoreLib::List< int >& fill = state.fill;
+		CoreLib::List< int >& fillIndex = state.fillIndex;
+		walls.resize( 4 * linkTetrahedra.size() );
+		fillIndex.resize( linkTetrahedra.size() );
+		for( size_t i = 0; i < walls.size(); i++ ) {
+			walls[ (unsigned int)i ] = NOT_A_WALL;
+		}
+		for( size_t i = 0; i < fillIndex.size(); i++ ) {
+			fillIndex[ (unsigned int)i ] = -1;
+		}
+		fill.clear();
+
+		bool fits = true;
+		for( size_t i = 0; i < hole.size() && fits; i++ ) {
+			const cavityFace_t& face = hole[ (unsigned int)i ];
+			int local[ 3 ];
+			linkFace_t key;
+			for( int j = 0; j < 3; j++ ) {
+				local[ j ] = key.v[ j ] = localIndex[ face.v[ j ] ];
+			}
+			std::sort( key.v, key.v + 3 );
+			// the tetrahedron inside winds the shared face the same way as the hole does
+			int inner = -1;
+			for( const linkFace_t* candidate = std::lower_bound( &linkFaces[ 0 ], &linkFaces[ 0 ] + linkFaces.size(), key ); 
+				 candidate != &linkFaces[ 0 ] + linkFaces.size() && !( key < *candidate ); candidate++ ) {
+				int other[ 3 ];
+				linkTetrahedra[ candidate->face >> 2 ].getFaceVertices( candidate->face & 3, other[ 0 ], other[ 1 ], other[ 2 ] );
+				if ( Tetrahedron::sameWinding( local, other ) ) {
+					inner = candidate->face;
+					break;
+				}
+			}
+			if ( inner < 0 ) {
+				fits = false;
+				break;
+			}
+			walls[ inner ] = face.neighbor;
+			if ( fillIndex[ inner >> 2 ] < 0 ) {
+				fillIndex[ inner >> 2 ] = (int)fill.size();
+				fill.append( inner >> 2 );
+			}
+		}
+		for( size_t i = 0; i < fill.size() && fits; i++ ) {
+			const tetrahedron_t& T = linkTetrahedra[ fill[ (unsigned int)i ] ];
+			for( int f = 0; f < 4; f++ ) {
+				if ( walls[ 4 * fill[ (unsigned int)i ] + f ] != NOT_A_WALL ) {
+					continue;
+				}
+				const int n = T.neighbor( f );
+				if ( n < 0 ) {
+					fits = false; // leaked out of the hole
+					break;
+				}
+				if ( fillIndex[ n ] < 0 ) {
+					fillIndex[ n ] = (int)fill.size();
+					fill.append( n );
+				}
+			}
+		}
+
+		for( size_t i = 0; i < link.size(); i++ ) {
+			localIndex[ link[ (unsigned int)i ] ] = -1;
+		}
+		if ( !fits ) {
+			return false;
+		}
+
+		// replace the star with the filling tetrahedra
+		for( size_t i = 0; i < star.size(); i++ ) {
+			Tetrahedron::markInvalid( tetrahedra[ star[ (unsigned int)i ] ] );
+			state.freeSlots.append( star[ (unsigned int)i ] );
+		}
+		// from now on, fill holds the index each filling tetrahedron takes in the tessellation
+		for( size_t i = 0; i < fill.size(); i++ ) {
+			fill[ (unsigned int)i ] = (int)Tetrahedron::allocate( tetrahedra, state.freeSlots );
+		}
+		for( size_t i = 0; i < linkTetrahedra.size(); i++ ) {
+			if ( fillIndex[ (unsigned int)i ] < 0 ) {
+				continue;
+			}
+			const tetrahedron_t& L = linkTetrahedra[ (unsigned int)i ];
+			const int iT = fill[ fillIndex[ (unsigned int)i ] ];
+			tetrahedron_t& T = tetrahedra[ iT ];
+			for( int j = 0; j < 4; j++ ) {
+				T.v[ j ] = link[ L.v[ j ] ];
+				state.vertexTetrahedron[ T.v[ j ] ] = iT;
+			}
+			for( int f = 0; f < 4; f++ ) {
+				const int wall = walls[ 4 * (unsigned int)i + f ];
+				if ( wall == NOT_A_WALL ) {
+					T.neighbors[ f ] = Tetrahedron::pack( fill[ fillIndex[ L.neighbor( f ) ] ], L.neighborFace( f ) );
+				} else {
+					T.neighbors[ f ] = wall;
+					if ( wall >= 0 ) {
+						tetrahedra[ wall >> 2 ].neighbors[ wall & 3 ] = Tetrahedron::pack( iT, f );
+					}
+				}
+			}
+		}
+		state.vertexTetrahedron[ vertex ] = -1;
+		state.walkState.lastTetrahedron = fill[ 0 ];
+		return true;
+	}
+
+} // namespace internal
 
 
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
-// tetrahedron_t public interface
-//////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////
+// tetrahedron_t public interface
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
 tetrahedron_t::tetrahedron_t()
 {
 	internal::Tetrahedron::markInvalid(*this);
@@ -1903,7 +3169,6 @@ tetrahedron_t::tetrahedron_t( const tetrahedron_t& other )
 {
 	memcpy( v, other.v, 4 * sizeof( int ) );
 	memcpy( neighbors, other.neighbors, 4 * sizeof( int ) );
-	memcpy( face, other.face, 3 * 4 * sizeof( int ) );
 }
 
 bool tetrahedron_t::isValid() const {
@@ -1920,13 +3185,11 @@ bool tetrahedron_t::containsVertex( const int vert ) const {
 }
 
 void tetrahedron_t::getFaceVertices( const int f, int& a, int& b, int& c ) const {
+	using internal::Tetrahedron::faceVertices;
 	assert( f >= 0 && f < 4 );
-	assert( face[f][0] >= 0 && face[f][0] < 4 );
-	assert( face[f][1] >= 0 && face[f][1] < 4 );
-	assert( face[f][2] >= 0 && face[f][2] < 4 );
-	a = v[ face[f][0] ]; 
-	b = v[ face[f][1] ]; 
-	c = v[ face[f][2] ];
+	a = v[ faceVertices[f][0] ]; 
+	b = v[ faceVertices[f][1] ]; 
+	c = v[ faceVertices[f][2] ];
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -1937,84 +3200,179 @@ void tetrahedron_t::getFaceVertices( const int f, int& a, int& b, int& c ) const
 
 #if LEAVE_CONTAINING_TETRAHEDRON 
 bool Delaunay3D::tetrahedralize( CoreLib::List< Point >& srcPoints,
-								CoreLib::List< tetrahedron_t >& tetrahedra ) {
-#else
-bool Delaunay3D::tetrahedralize( const CoreLib::List< Point >& srcPoints,
-								CoreLib::List< tetrahedron_t >& tetrahedra ) {
-#endif
-									using namespace RenderLib::Math;
-									using namespace RenderLib::Geometry;
-
+								CoreLib::List< tetrahedron_t >& tetrahedra,
+								InsertionOrder_t insertionOrder,
+								bool parallel,
+								InsertionKernel_t kernel ) {
 									if ( srcPoints.size() == 0 ) { 
 										return false;
 									}
 
-									BoundingBox bounds;
-									for( size_t i = 0; i < srcPoints.size(); i++ ) {
-										bounds.expand( srcPoints[ (unsigned int)i ] );
+									internal::vertexSet_t vertices( &srcPoints[ 0 ], srcPoints.size() );
+									if ( !internal::tessellate( vertices, insertionOrder, parallel, kernel, tetrahedra ) ) {
+										return false;
 									}
-
-									Point3f center;
-									float radius;
-									bounds.boundingSphere( center, radius );
-									radius *= 2; // avoid a too tight bound since we want the containing tetrahedron's faces to wrap all the points
-									if ( srcPoints.size() < 2 ) {
-										// we don't have enough points to define a volume
-										// so give it a fixed extra radius
-										radius = 1.0;
+									// the resulting tetrahedra reference the containing vertices right after the source points
+									for( int i = 0; i < 4; i++ ) {
+										srcPoints.append( vertices.containing[ i ] );
 									}
-
-									// copy the source points list, we will need to add some extra
-									// points while building the tessellation, but then we'll restrict
-									// the resulting tetrahedra to the initial point set.
-#if	LEAVE_CONTAINING_TETRAHEDRON
-									CoreLib::List< Point >& pointSet = srcPoints;
+									return true;
+}
 #else
-									CoreLib::List< Point > pointSet = srcPoints;
+bool Delaunay3D::tetrahedralize( const CoreLib::List< Point >& srcPoints,
+								CoreLib::List< tetrahedron_t >& tetrahedra,
+								InsertionOrder_t insertionOrder,
+								bool parallel,
+								InsertionKernel_t kernel ) {
+									if ( srcPoints.size() == 0 ) { 
+										return false;
+									}
+
+									// filtering in place rather than through a sink avoids holding two lists
+									internal::vertexSet_t vertices( &srcPoints[ 0 ], srcPoints.size() );
+									if ( !internal::tessellate( vertices, insertionOrder, parallel, kernel, tetrahedra ) ) {
+										return false;
+									}
+									internal::discardContaining( tetrahedra, srcPoints.size() );
+									return true;
+}
 #endif
-									const size_t numSrcPoints = srcPoints.size();
 
-									// generate the tetrahedron from the sphere it contains (circumsphere)
-									tetrahedron_t& bigT = tetrahedra.append();
-									internal::containingTetrahedron( center, radius, bigT, pointSet );
-									internal::Tetrahedron::fixFaceOrientations( bigT, pointSet );
+Delaunay3D::Delaunay3D() : state( new internal::persistentState_t ) {
+}
 
-									tetrahedra.setGranularity( 4 * numSrcPoints );
-									for( size_t i = 0; i < numSrcPoints; i++ ) {
-										internal::insertOnePoint( pointSet, (int)i, tetrahedra );
-									}
-#if _DEBUG
-									// verify Delaunay condition (empty spheres) for all tetrahedra
-									for( size_t i = 0; i < tetrahedra.size(); i++ ) {
-										const tetrahedron_t& T = tetrahedra[ (unsigned int)i ];
-										if ( !T.isValid() ) {
-											continue;
-										}
-										const Point& T0 = pointSet[ T.v[ 0 ] ];
-										const Point& T1 = pointSet[ T.v[ 2 ] ];
-										const Point& T2 = pointSet[ T.v[ 1 ] ];
-										const Point& T3 = pointSet[ T.v[ 3 ] ];
-										for( size_t j = 0; j < pointSet.size(); j++ ) {
-											assert( internal::inSphere( T0, T1, T2, T3, pointSet[ (unsigned int)j ] ) <= 0 );
-										}
+Delaunay3D::~Delaunay3D() {
+	delete state;
+}
+
+bool Delaunay3D::tetrahedralize( const CoreLib::List< Point >& srcPoints,
+								ITetrahedronSink& sink,
+								InsertionOrder_t insertionOrder,
+								bool parallel,
+								InsertionKernel_t kernel ) {
+									if ( srcPoints.size() == 0 ) { 
+										return false;
 									}
-#endif
-#if !LEAVE_CONTAINING_TETRAHEDRON
-									// Delete all tetrahedra containing one of the additional vertices
-									// inserted for the containing tetrahedron
-									for( size_t i = 0; i < tetrahedra.size(); i++ ) {
-										tetrahedron_t& t = tetrahedra[ i ];
-										for( size_t j = 0; j < 4; j++ ) {
-											if( t.v[ j ] >= srcPoints.size() ) {
-												Tetrahedron::destroy( t, tetrahedra );
-												break;
-											}
-										}			
+
+									internal::vertexSet_t vertices( &srcPoints[ 0 ], srcPoints.size() );
+									CoreLib::List< tetrahedron_t > tetrahedra;
+									if ( !internal::tessellate( vertices, insertionOrder, parallel, kernel, tetrahedra ) ) {
+										return false;
 									}
-#endif
+									internal::emitTetrahedra( tetrahedra, srcPoints.size(), sink );
 									return true;
 }
 
+bool Delaunay3D::build( const CoreLib::List< Point >& points ) {
+	if ( points.size() == 0 ) {
+		return false;
+	}
+
+	internal::persistentState_t& s = *state;
+	s.points.clear();
+	s.points.setGranularity( points.size() + 4 );
+	for( size_t i = 0; i < points.size(); i++ ) {
+		s.points.append( points[ (unsigned int)i ] );
+	}
+	s.firstContaining = (int)points.size();
+	for( int i = 0; i < 4; i++ ) {
+		s.points.append();
+	}
+	s.vertexTetrahedron.resize( s.points.size() );
+	s.localIndex.resize( s.points.size() );
+	for( size_t i = 0; i < s.points.size(); i++ ) {
+		s.vertexTetrahedron[ (unsigned int)i ] = 0; // pending insertion
+		s.localIndex[ (unsigned int)i ] = -1;
+	}
+	s.freeVertices.clear();
+	s.tetrahedra.setGranularity( 8 * points.size() );
+
+	internal::rebuild( s );
+	return true;
+}
+
+int Delaunay3D::insert( const Point& p ) {
+	internal::persistentState_t& s = *state;
+	if ( s.points.size() == 0 ) {
+		CoreLib::List< Point > points;
+		points.append( p );
+		build( points );
+		return 0;
+	}
+
+	int vertex;
+	if ( s.freeVertices.size() > 0 ) {
+		vertex = s.freeVertices[ (unsigned int)s.freeVertices.size() - 1 ];
+		s.freeVertices.resize( s.freeVertices.size() - 1 );
+		s.points[ vertex ] = p;
+	} else {
+		vertex = (int)s.points.size();
+		s.points.append( p );
+		s.vertexTetrahedron.append( -1 );
+		s.localIndex.append( -1 );
+	}
+
+	internal::placeVertex( s, vertex );
+	if ( s.vertexTetrahedron[ vertex ] < 0 ) {
+		s.freeVertices.append( vertex );
+		return -1;
+	}
+	return vertex;
+}
+
+bool Delaunay3D::remove( const int vertex ) {
+	if ( !isVertex( vertex ) ) {
+		return false;
+	}
+	internal::persistentState_t& s = *state;
+	if ( !internal::removeVertex( s, vertex ) ) {
+		// the tessellation of the link doesn't fit the hole, tessellate everything again instead
+		s.vertexTetrahedron[ vertex ] = -1;
+		internal::rebuild( s );
+	}
+	s.freeVertices.append( vertex );
+	return true;
+}
+
+bool Delaunay3D::move( const int vertex, const Point& p ) {
+	if ( !isVertex( vertex ) ) {
+		return false;
+	}
+	internal::persistentState_t& s = *state;
+	if ( s.points[ vertex ] == p ) {
+		return true;
+	}
+	if ( !internal::insideContaining( s, p ) ) {
+		s.points[ vertex ] = p;
+		internal::rebuild( s );
+		return true;
+	}
+	if ( !internal::removeVertex( s, vertex ) ) {
+		s.vertexTetrahedron[ vertex ] = -1;
+		internal::rebuild( s );
+	}
+	// inserted last, so that it is the one left out if it duplicates another vertex
+	s.points[ vertex ] = p;
+	internal::placeVertex( s, vertex );
+	if ( s.vertexTetrahedron[ vertex ] < 0 ) {
+		s.freeVertices.append( vertex );
+		return false;
+	}
+	return true;
+}
+
+bool Delaunay3D::isVertex( const int vertex ) const {
+	return vertex >= 0 && (size_t)vertex < state->points.size() && !state->isContaining( vertex ) && state->vertexTetrahedron[ vertex ] >= 0;
+}
+
+const CoreLib::List< Point >& Delaunay3D::getVertices() const {
+	return state->points;
+}
+
+void Delaunay3D::getTetrahedra( ITetrahedronSink& sink ) const {
+	internal::emitTetrahedra( state->tetrahedra, state->firstContaining, sink );
+}
+
 
 } // namespace Delaunay3D
 } // namespace Geometry
@@ -0,0 +1,310 @@
+/*
+	================================================================================
+	This software is released under the LGPL-3.0 license: http://www.opensource.org/licenses/lgpl-3.0.html
+
+	Copyright (c) 2012, Jose Esteve. http://www.joesfer.com
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Lesser General Public
+	License as published by the Free Software Foundation; either
+	version 3.0 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public
+	License along with this library; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+	================================================================================
+*/
+
+#include <geometry/tessellation/delaunay/tetrahedronLocator.h>
+#include <geometry/predicates/predicates.h>
+#include <parallel/parallelFor.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace RenderLib {
+namespace Geometry {
+namespace Delaunay {
+
+namespace internal { 
+
+	// vertex opposed to each face, following the face table of tetrahedron_t
+	const int vertexOppositeFace[ 4 ] = { 3, 2, 0, 1 };
+
+	// tetrahedra per grid cell, on average
+	const size_t LOCATOR_TETRAHEDRA_PER_CELL = 2;
+
+	// below this number of queries, a range is not split any further among threads
+	const size_t LOCATOR_GRAIN_SIZE = 1024;
+
+	/*
+	================
+	TetrahedronLocator::Barycentric
+
+	Weights of p relative to the vertices of t: the volume of the tetrahedron 
+	formed by p and the face opposed to each vertex, over their sum. Plain 
+	arithmetic is enough here, since p is known to be inside t already.
+	================
+	*/
+	void barycentric( const Point& p, const tetrahedron_t& t, const CoreLib::List< Point >& points, REAL weights[ 4 ] ) {
+		REAL sum = 0;
+		for( int f = 0; f < 4; f++ ) {
+			int a, b, c;
+			t.getFaceVertices( f, a, b, c );
+			const Point& pa = points[ a ];
+			const Point& pb = points[ b ];
+			const Point& pc = points[ c ];
+			const REAL ax = pa.x - p.x, ay = pa.y - p.y, az = pa.z - p.z;
+			const REAL bx = pb.x - p.x, by = pb.y - p.y, bz = pb.z - p.z;
+			const REAL cx = pc.x - p.x, cy = pc.y - p.y, cz = pc.z - p.z;
+			// orient3D( a, b, c, p ), negative as p is behind every face
+			const REAL volume = std::max( (REAL)0, -( ax * ( by * cz - bz * cy ) + ay * ( bz * cx - bx * cz ) + az * ( bx * cy - by * cx ) ) );
+			weights[ vertexOppositeFace[ f ] ] = volume;
+			sum += volume;
+		}
+		if ( sum > 0 ) {
+			for( int i = 0; i < 4; i++ ) {
+				weights[ i ] /= sum;
+			}
+		} else {
+			for( int i = 0; i < 4; i++ ) {
+				weights[ i ] = (REAL)0.25;
+			}
+		}
+	}
+
+} // namespace internal
+
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+// TetrahedronLocator public interface
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+
+TetrahedronLocator::TetrahedronLocator() : points( NULL ), tetrahedra( NULL ), invCellSize( 0 ) {
+	resolution[ 0 ] = resolution[ 1 ] = resolution[ 2 ] = 0;
+}
+
+/*
+================
+TetrahedronLocator::Build
+
+Sizes the grid to hold a few tetrahedra per cell, with cubic cells. Each 
+cell takes the first tetrahedron whose centroid falls in it, and the cells 
+left empty take the tetrahedron of the closest filled one, spreading them 
+breadth-first, so that every walk starts close to its point.
+================
+*/
+bool TetrahedronLocator::build( const CoreLib::List< Point >& srcPoints, const CoreLib::List< tetrahedron_t >& srcTetrahedra, const BoundingBox* region ) {
+	using namespace internal;
+
+	points = &srcPoints;
+	tetrahedra = &srcTetrahedra;
+	grid.clear();
+
+	size_t numValid = 0;
+	for( size_t i = 0; i < srcTetrahedra.size(); i++ ) {
+		if ( srcTetrahedra[ (unsigned int)i ].isValid() ) {
+			numValid++;
+		}
+	}
+	if ( numValid == 0 ) {
+		return false;
+	}
+
+	Point pMin, pMax;
+	if ( region != NULL ) {
+		pMin = Point( region->min().x, region->min().y, region->min().z );
+		pMax = Point( region->max().x, region->max().y, region->max().z );
+	} else {
+		pMin = pMax = srcPoints[ 0 ];
+		for( size_t i = 1; i < srcPoints.size(); i++ ) {
+			const Point& p = srcPoints[ (unsigned int)i ];
+			pMin = Point( std::min( pMin.x, p.x ), std::min( pMin.y, p.y ), std::min( pMin.z, p.z ) );
+			pMax = Point( std::max( pMax.x, p.x ), std::max( pMax.y, p.y ), std::max( pMax.z, p.z ) );
+		}
+	}
+
+	const REAL extents[ 3 ] = { std::max( pMax.x - pMin.x, (REAL)0 ), std::max( pMax.y - pMin.y, (REAL)0 ), std::max( pMax.z - pMin.z, (REAL)0 ) };
+	const REAL numCells = (REAL)std::max( (size_t)1, numValid / LOCATOR_TETRAHEDRA_PER_CELL );
+	const REAL longest = std::max( extents[ 0 ], std::max( extents[ 1 ], extents[ 2 ] ) );
+	REAL volume = 1;
+	int numAxes = 0;
+	for( int i = 0; i < 3; i++ ) {
+		// flat axes take a single cell
+		if ( extents[ i ] > longest * 1e-6 ) {
+			volume *= extents[ i ];
+			numAxes++;
+		}
+	}
+	const REAL cellSize = numAxes > 0 ? pow( volume / numCells, (REAL)1 / numAxes ) : 1;
+	gridMin = pMin;
+	invCellSize = 1 / cellSize;
+	for( int i = 0; i < 3; i++ ) {
+		resolution[ i ] = std::max( 1, std::min( 1 << 10, (int)ceil( extents[ i ] * invCellSize ) ) );
+	}
+
+	const size_t numGridCells = (size_t)resolution[ 0 ] * resolution[ 1 ] * resolution[ 2 ];
+	grid.resize( numGridCells );
+	for( size_t i = 0; i < numGridCells; i++ ) {
+		grid[ (unsigned int)i ] = -1;
+	}
+
+	CoreLib::List< int > queue;
+	queue.setGranularity( numGridCells );
+	for( size_t i = 0; i < srcTetrahedra.size(); i++ ) {
+		const tetrahedron_t& t = srcTetrahedra[ (unsigned int)i ];
+		if ( !t.isValid() ) {
+			continue;
+		}
+		const Point& p0 = srcPoints[ t.v[ 0 ] ];
+		const Point& p1 = srcPoints[ t.v[ 1 ] ];
+		const Point& p2 = srcPoints[ t.v[ 2 ] ];
+		const Point& p3 = srcPoints[ t.v[ 3 ] ];
+		const Point centroid( ( p0.x + p1.x + p2.x + p3.x ) * (REAL)0.25, 
+							  ( p0.y + p1.y + p2.y + p3.y ) * (REAL)0.25, 
+							  ( p0.z + p1.z + p2.z + p3.z ) * (REAL)0.25 );
+		const int cell = gridCell( centroid );
+		if ( grid[ cell ] < 0 ) {
+			grid[ cell ] = (int)i;
+			queue.append( cell );
+		}
+	}
+
+	// spread the tetrahedra to the empty cells
+	for( size_t head = 0; head < queue.size(); head++ ) {
+		const int cell = queue[ (unsigned int)head ];
+		const int coords[ 3 ] = { cell % resolution[ 0 ], ( cell / resolution[ 0 ] ) % resolution[ 1 ], cell / ( resolution[ 0 ] * resolution[ 1 ] ) };
+		const int strides[ 3 ] = { 1, resolution[ 0 ], resolution[ 0 ] * resolution[ 1 ] };
+		for( int axis = 0; axis < 3; axis++ ) {
+			for( int dir = -1; dir <= 1; dir += 2 ) {
+				const int c = coords[ axis ] + dir;
+				if ( c < 0 || c >= resolution[ axis ] ) {
+					continue;
+				}
+				const int next = cell + dir * strides[ axis ];
+				if ( grid[ next ] < 0 ) {
+					grid[ next ] = grid[ cell ];
+					queue.append( next );
+				}
+			}
+		}
+	}
+	return true;
+}
+
+/*
+================
+TetrahedronLocator::GridCell
+
+Grid cell holding p, points outside of the grid falling in the closest one
+================
+*/
+int TetrahedronLocator::gridCell( const Point& p ) const {
+	const REAL coords[ 3 ] = { ( p.x - gridMin.x ) * invCellSize, ( p.y - gridMin.y ) * invCellSize, ( p.z - gridMin.z ) * invCellSize };
+	int cell[ 3 ];
+	for( int i = 0; i < 3; i++ ) {
+		// compare as reals first, so that far away points don't overflow the cast
+		cell[ i ] = coords[ i ] <= 0 ? 0 : ( coords[ i ] >= resolution[ i ] ? resolution[ i ] - 1 : std::min( (int)coords[ i ], resolution[ i ] - 1 ) );
+	}
+	return cell[ 0 ] + resolution[ 0 ] * ( cell[ 1 ] + resolution[ 1 ] * cell[ 2 ] );
+}
+
+/*
+================
+TetrahedronLocator::Locate
+
+Visibility walk: moves to the neighbor behind any face p is in front of, 
+until there's none. The faces are tested from a random one on, so that the 
+walk can't cycle; the random sequence depends on p only, so that queries 
+share no state and the result doesn't depend on the thread running them.
+================
+*/
+int TetrahedronLocator::locate( const Point& p, REAL weights[ 4 ] ) const {
+	using namespace internal;
+
+	if ( grid.size() == 0 ) {
+		return -1;
+	}
+
+	const CoreLib::List< Point >& srcPoints = *points;
+	const CoreLib::List< tetrahedron_t >& srcTetrahedra = *tetrahedra;
+
+	unsigned int bits[ sizeof( Point ) / sizeof( unsigned int ) ];
+	memcpy( bits, &p, sizeof( bits ) );
+	unsigned int seed = 2166136261u;
+	for( size_t i = 0; i < sizeof( bits ) / sizeof( unsigned int ); i++ ) {
+		seed = ( seed ^ bits[ i ] ) * 16777619u;
+	}
+
+	int current = grid[ gridCell( p ) ];
+	int previous = -1;
+	for( size_t steps = 0; steps <= srcTetrahedra.size(); steps++ ) {
+		const tetrahedron_t& t = srcTetrahedra[ current ];
+		seed = seed * 1664525u + 1013904223u;
+		const int first = (int)( seed >> 30 );
+		int next = -1;
+		bool outside = false;
+		for( int i = 0; i < 4; i++ ) {
+			const int f = ( first + i ) & 3;
+			const int neighbor = t.neighbor( f );
+			if ( neighbor >= 0 && neighbor == previous ) {
+				continue; // p is behind the face we came through
+			}
+			int a, b, c;
+			t.getFaceVertices( f, a, b, c );
+			if ( orient3D( srcPoints[ a ], srcPoints[ b ], srcPoints[ c ], p ) > 0 ) {
+				if ( neighbor < 0 ) {
+					outside = true;
+					continue; // another face may still lead inside
+				}
+				next = neighbor;
+				break;
+			}
+		}
+		if ( next < 0 ) {
+			if ( outside ) {
+				return -1;
+			}
+			barycentric( p, t, srcPoints, weights );
+			return current;
+		}
+		previous = current;
+		current = next;
+	}
+
+	assert( false );
+	return -1;
+}
+
+void TetrahedronLocator::locate( const CoreLib::List< Point >& queries, CoreLib::List< location_t >& results, bool parallel ) const {
+	using namespace internal;
+
+	const size_t numQueries = queries.size();
+	results.resize( numQueries );
+	if ( numQueries == 0 ) {
+		return;
+	}
+
+	auto func = [ & ]( size_t begin, size_t end ) {
+		for( size_t i = begin; i < end; i++ ) {
+			location_t& result = results[ (unsigned int)i ];
+			result.tetrahedron = locate( queries[ (unsigned int)i ], result.barycentric );
+		}
+	};
+
+	if ( parallel ) {
+		RenderLib::Parallel::parallelFor( 0, numQueries, LOCATOR_GRAIN_SIZE, func );
+	} else {
+		func( 0, numQueries );
+	}
+}
+
+} // namespace Delaunay
+} // namespace Geometry
+} // namespace RenderLib
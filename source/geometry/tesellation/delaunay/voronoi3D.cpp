@@ -0,0 +1,352 @@
+/*
+	================================================================================
+	This software is released under the LGPL-3.0 license: http://www.opensource.org/licenses/lgpl-3.0.html
+
+	Copyright (c) 2012, Jose Esteve. http://www.joesfer.com
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Lesser General Public
+	License as published by the Free Software Foundation; either
+	version 3.0 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public
+	License along with this library; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+	================================================================================
+*/
+
+#include <geometry/tessellation/delaunay/voronoi3D.h>
+#include <parallel/parallelFor.h>
+#include <vector>
+#include <algorithm>
+
+namespace RenderLib {
+namespace Geometry {
+namespace Delaunay {
+
+namespace internal { 
+
+	// face opposed to each vertex, following the face table of tetrahedron_t
+	const int faceOppositeVertex[ 4 ] = { 2, 3, 1, 0 };
+
+	// below this number of cells or tetrahedra, a range is not split any further among threads
+	const size_t VORONOI_GRAIN_SIZE = 4096;
+
+	// Set of non-negative indices with linear probing, cleared in time proportional to 
+	// the number of indices inserted rather than to its capacity, so that a huge star 
+	// (e.g. a containing vertex) doesn't slow down the small ones following it
+	class indexSet_t {
+	public:
+		indexSet_t() : mask( 0 ) {}
+
+		// returns false if the index was in the set already
+		bool insert( const int index ) {
+			if ( 2 * ( used.size() + 1 ) > slots.size() ) {
+				grow();
+			}
+			size_t i = hash( index );
+			while( slots[ i ] >= 0 ) {
+				if ( slots[ i ] == index ) {
+					return false;
+				}
+				i = ( i + 1 ) & mask;
+			}
+			slots[ i ] = index;
+			used.push_back( i );
+			return true;
+		}
+
+		void clear() {
+			for( size_t i = 0; i < used.size(); i++ ) {
+				slots[ used[ i ] ] = -1;
+			}
+			used.clear();
+		}
+
+	private:
+		size_t hash( const int index ) const { return ( (unsigned int)index * 2654435761u ) & mask; }
+
+		void grow() {
+			std::vector< int > indices;
+			for( size_t i = 0; i < used.size(); i++ ) {
+				indices.push_back( slots[ used[ i ] ] );
+			}
+			slots.assign( std::max( (size_t)64, 2 * slots.size() ), -1 );
+			mask = slots.size() - 1;
+			used.clear();
+			for( size_t i = 0; i < indices.size(); i++ ) {
+				insert( indices[ i ] );
+			}
+		}
+
+		std::vector< int >		slots;	// -1 if empty
+		std::vector< size_t >	used;	// occupied slots
+		size_t					mask;
+	};
+
+	// buffers of a thread extracting cells
+	struct cellScratch_t {
+		std::vector< int >	star;		// tetrahedra incident to the site
+		indexSet_t			inStar;
+		indexSet_t			done;		// points across the faces already extracted
+	};
+
+	/*
+	================
+	Voronoi::Circumcentre
+
+	Computed relative to p0 to keep the precision, as 
+	p0 + ( |a|^2 ( b x c ) + |b|^2 ( c x a ) + |c|^2 ( a x b ) ) / ( 2 a . ( b x c ) ), 
+	a, b and c being the edges leaving p0. Straight-line arithmetic with no 
+	branches, so that the compiler is free to vectorize the loops calling it.
+	================
+	*/
+	inline Point circumcentre( const Point& p0, const Point& p1, const Point& p2, const Point& p3 ) {
+		const REAL ax = p1.x - p0.x, ay = p1.y - p0.y, az = p1.z - p0.z;
+		const REAL bx = p2.x - p0.x, by = p2.y - p0.y, bz = p2.z - p0.z;
+		const REAL cx = p3.x - p0.x, cy = p3.y - p0.y, cz = p3.z - p0.z;
+
+		const REAL a2 = ax * ax + ay * ay + az * az;
+		const REAL b2 = bx * bx + by * by + bz * bz;
+		const REAL c2 = cx * cx + cy * cy + cz * cz;
+
+		const REAL bcx = by * cz - bz * cy, bcy = bz * cx - bx * cz, bcz = bx * cy - by * cx;
+		const REAL cax = cy * az - cz * ay, cay = cz * ax - cx * az, caz = cx * ay - cy * ax;
+		const REAL abx = ay * bz - az * by, aby = az * bx - ax * bz, abz = ax * by - ay * bx;
+
+		const REAL inv = (REAL)0.5 / ( ax * bcx + ay * bcy + az * bcz );
+		return Point( p0.x + ( a2 * bcx + b2 * cax + c2 * abx ) * inv, 
+					  p0.y + ( a2 * bcy + b2 * cay + c2 * aby ) * inv, 
+					  p0.z + ( a2 * bcz + b2 * caz + c2 * abz ) * inv );
+	}
+
+	/*
+	================
+	Voronoi::ExtractCell
+
+	Gathers the star of the site breadth-first through the faces holding it. 
+	Each point w sharing an edge with the site is dual to a face of the cell, 
+	whose vertices are the circumcentres found rotating around the edge, from 
+	tetrahedron to tetrahedron through the faces holding it. Counts the faces 
+	and their indices and, when the output pointers are given, writes them 
+	there, the face offsets starting at indexBase. Returns whether the cell is 
+	bounded, the faces reaching infinity being left out otherwise.
+	================
+	*/
+	bool extractCell( const int site, const int start, const CoreLib::List< tetrahedron_t >& tetrahedra, cellScratch_t& scratch,
+					  unsigned int& numFaces, unsigned int& numIndices, 
+					  int* faceSites, unsigned int* faceIndices, int* indices, const unsigned int indexBase ) {
+		bool bounded = true;
+
+		std::vector< int >& star = scratch.star;
+		star.clear();
+		scratch.inStar.clear();
+		star.push_back( start );
+		scratch.inStar.insert( start );
+		for( size_t i = 0; i < star.size(); i++ ) {
+			const tetrahedron_t& T = tetrahedra[ star[ i ] ];
+			for( int j = 0; j < 4; j++ ) {
+				if ( T.v[ j ] == site ) {
+					continue;
+				}
+				const int n = T.neighbor( faceOppositeVertex[ j ] );
+				if ( n < 0 ) {
+					bounded = false;
+				} else if ( scratch.inStar.insert( n ) ) {
+					star.push_back( n );
+				}
+			}
+		}
+
+		indexSet_t& done = scratch.done;
+		done.clear();
+		numFaces = 0;
+		numIndices = 0;
+		for( size_t i = 0; i < star.size(); i++ ) {
+			const int t = star[ i ];
+			const tetrahedron_t& T = tetrahedra[ t ];
+			int order[ 4 ] = { 0, 0, 0, 0 };	// site, w, and the other two vertices a and b
+			for( int j = 0; j < 4; j++ ) {
+				order[ 0 ] = T.v[ j ] == site ? j : order[ 0 ];
+			}
+			for( int j = 0; j < 4; j++ ) {
+				const int w = T.v[ j ];
+				if ( w == site || !done.insert( w ) ) {
+					continue;
+				}
+
+				// pick a and b so that ( site, w, a, b ) is an even permutation of T's vertices, 
+				// hence equally oriented, and rotate from a towards b
+				order[ 1 ] = j;
+				for( int k = 0, m = 2; k < 4; k++ ) {
+					if ( k != order[ 0 ] && k != order[ 1 ] ) {
+						order[ m++ ] = k;
+					}
+				}
+				int inversions = 0;
+				for( int k = 0; k < 4; k++ ) {
+					for( int m = k + 1; m < 4; m++ ) {
+						inversions += order[ k ] > order[ m ];
+					}
+				}
+				int a = T.v[ order[ ( inversions & 1 ) ? 3 : 2 ] ];
+				int b = T.v[ order[ ( inversions & 1 ) ? 2 : 3 ] ];
+
+				const unsigned int firstIndex = numIndices;
+				bool closed = true;
+				int current = t;
+				do {
+					if ( indices != NULL ) {
+						indices[ numIndices ] = current;
+					}
+					numIndices++;
+					// leave through the face opposed to a, which holds the edge and b
+					const tetrahedron_t& C = tetrahedra[ current ];
+					int ka = 0;
+					while( C.v[ ka ] != a ) {
+						ka++;
+					}
+					const int next = C.neighbor( faceOppositeVertex[ ka ] );
+					if ( next < 0 ) {
+						closed = false;
+						break;
+					}
+					const tetrahedron_t& N = tetrahedra[ next ];
+					int c = 0;
+					for( int k = 0; k < 4; k++ ) {
+						if ( N.v[ k ] != site && N.v[ k ] != w && N.v[ k ] != b ) {
+							c = N.v[ k ];
+						}
+					}
+					a = b;
+					b = c;
+					current = next;
+				} while( current != t );
+
+				if ( !closed ) {
+					numIndices = firstIndex; // drop the face
+					continue;
+				}
+				if ( faceSites != NULL ) {
+					faceSites[ numFaces ] = w;
+					faceIndices[ numFaces ] = indexBase + firstIndex;
+				}
+				numFaces++;
+			}
+		}
+		return bounded;
+	}
+
+	// runs func( begin, end ) over [0, count), split among threads if requested
+	template< typename F >
+	void forRange( const size_t count, const bool parallel, const F& func ) {
+		if ( parallel ) {
+			RenderLib::Parallel::parallelFor( 0, count, VORONOI_GRAIN_SIZE, func );
+		} else {
+			func( 0, count );
+		}
+	}
+
+} // namespace internal
+
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+// Voronoi public interface
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+
+bool voronoiCells( const CoreLib::List< Point >& points, 
+				   const CoreLib::List< tetrahedron_t >& tetrahedra, 
+				   voronoiCells_t& cells, 
+				   bool parallel ) {
+	using namespace internal;
+
+	const size_t numCells = points.size();
+	const size_t numTetrahedra = tetrahedra.size();
+	if ( numCells == 0 || numTetrahedra == 0 ) {
+		return false;
+	}
+
+	cells.vertices.resize( numTetrahedra );
+	forRange( numTetrahedra, parallel, [ & ]( size_t begin, size_t end ) {
+		for( size_t i = begin; i < end; i++ ) {
+			const tetrahedron_t& t = tetrahedra[ (unsigned int)i ];
+			if ( t.isValid() ) {
+				cells.vertices[ (unsigned int)i ] = circumcentre( points[ t.v[ 0 ] ], points[ t.v[ 1 ] ], points[ t.v[ 2 ] ], points[ t.v[ 3 ] ] );
+			}
+		}
+	} );
+
+	// a tetrahedron incident to each point to start its cell from
+	CoreLib::List< int > incident;
+	incident.resize( numCells );
+	for( size_t i = 0; i < numCells; i++ ) {
+		incident[ (unsigned int)i ] = -1;
+	}
+	for( size_t i = 0; i < numTetrahedra; i++ ) {
+		const tetrahedron_t& t = tetrahedra[ (unsigned int)i ];
+		if ( t.isValid() ) {
+			for( int j = 0; j < 4; j++ ) {
+				assert( (size_t)t.v[ j ] < numCells );
+				incident[ t.v[ j ] ] = (int)i;
+			}
+		}
+	}
+
+	// count the faces and indices of every cell, then lay them out and extract them 
+	// again, this time writing them. The walks are cheaper than buffering the cells.
+	CoreLib::List< unsigned int > cellIndices;
+	cells.cellFaces.resize( numCells + 1 );
+	cells.bounded.resize( numCells );
+	cellIndices.resize( numCells + 1 );
+	cells.cellFaces[ 0 ] = 0;
+	cellIndices[ 0 ] = 0;
+	forRange( numCells, parallel, [ & ]( size_t begin, size_t end ) {
+		cellScratch_t scratch;
+		for( size_t i = begin; i < end; i++ ) {
+			unsigned int numFaces = 0, numIndices = 0;
+			bool bounded = false;
+			if ( incident[ (unsigned int)i ] >= 0 ) {
+				bounded = extractCell( (int)i, incident[ (unsigned int)i ], tetrahedra, scratch, numFaces, numIndices, NULL, NULL, NULL, 0 );
+			}
+			cells.bounded[ (unsigned int)i ] = bounded;
+			cells.cellFaces[ (unsigned int)i + 1 ] = numFaces;
+			cellIndices[ (unsigned int)i + 1 ] = numIndices;
+		}
+	} );
+	for( size_t i = 0; i < numCells; i++ ) {
+		cells.cellFaces[ (unsigned int)i + 1 ] += cells.cellFaces[ (unsigned int)i ];
+		cellIndices[ (unsigned int)i + 1 ] += cellIndices[ (unsigned int)i ];
+	}
+
+	const unsigned int numFaces = cells.cellFaces[ (unsigned int)numCells ];
+	const unsigned int numIndices = cellIndices[ (unsigned int)numCells ];
+	cells.faceSites.resize( numFaces );
+	cells.faceIndices.resize( numFaces + 1 );
+	cells.indices.resize( numIndices );
+	cells.faceIndices[ numFaces ] = numIndices;
+	forRange( numCells, parallel, [ & ]( size_t begin, size_t end ) {
+		cellScratch_t scratch;
+		for( size_t i = begin; i < end; i++ ) {
+			const unsigned int firstFace = cells.cellFaces[ (unsigned int)i ];
+			if ( cells.cellFaces[ (unsigned int)i + 1 ] == firstFace ) {
+				continue;
+			}
+			const unsigned int firstIndex = cellIndices[ (unsigned int)i ];
+			unsigned int cellFaces, cellNumIndices;
+			extractCell( (int)i, incident[ (unsigned int)i ], tetrahedra, scratch, cellFaces, cellNumIndices, 
+						 &cells.faceSites[ firstFace ], &cells.faceIndices[ firstFace ], &cells.indices[ firstIndex ], firstIndex );
+			assert( cellFaces == cells.cellFaces[ (unsigned int)i + 1 ] - firstFace );
+		}
+	} );
+	return true;
+}
+
+} // namespace Delaunay
+} // namespace Geometry
+} // namespace RenderLib